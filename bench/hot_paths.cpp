@@ -0,0 +1,489 @@
+// Hot-path microbenchmarks: the per-fix work of GPS ingest and of the
+// publish path, in ns/op with the heap bytes and allocations each op makes
+// (the firmware's own paths should show none). The same source and inputs
+// run on the host and on the board, so the numbers can be compared and a
+// regression shows up before it reaches the fleet.
+//
+//   pio run -e bench_hot
+//   .pio/build/bench_hot/program
+//   .pio/build/bench_hot/program json_ gpsb_
+//   pio run -e bench_hot_target -t upload -t monitor
+//
+// Arguments select the benchmarks whose name starts with one of them. The
+// GPSModule benchmarks need the host UART (bytes are injected) and run on
+// the host only.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "fix_batcher.h"
+#include "gps_fix.h"
+#include "json_writer.h"
+#include "nmea_parser.h"
+#include "payload_codec.h"
+#include "ubx.h"
+#include "ubx_parser.h"
+#include <TinyGPSPlus.h>
+
+#if defined(HOST_BUILD)
+#include "gps.h"
+#include <chrono>
+#else
+#include <Arduino.h>
+#include <esp_timer.h>
+#endif
+
+#define BENCH_TARGET_NS 200000000ULL // Measured run length per benchmark
+#define BENCH_REPEATS 3              // Best of, against scheduler noise
+#define BENCH_EPOCHS 64              // Distinct UBX epochs (iTOW changes)
+
+// ============================================
+// HEAP ACCOUNTING
+// ============================================
+
+static volatile size_t allocCount = 0;
+static volatile size_t allocBytes = 0;
+
+static void countAlloc(size_t size) {
+  allocCount = allocCount + 1;
+  allocBytes = allocBytes + size;
+}
+
+#if defined(HOST_BUILD)
+// Everything the benchmarks allocate on the host (HostHAL's String,
+// containers) goes through C++ new; glibc's own malloc use is not ours
+#define BENCH_HEAP_HOOKS "C++ new"
+
+void *operator new(size_t size) {
+  countAlloc(size);
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    abort();
+  return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+#else
+// On the board Arduino's String grows with realloc and libstdc++'s new
+// calls malloc, so the build wraps those two (-Wl,--wrap=malloc,
+// --wrap=realloc) and every call is counted once. Newlib's reentrant
+// _malloc_r (printf of floats, stdio buffers) goes to the heap directly
+// and is not seen.
+#define BENCH_HEAP_HOOKS "malloc, realloc (not newlib _malloc_r)"
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  countAlloc(size);
+  return __real_malloc(size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+  countAlloc(size);
+  return __real_realloc(p, size);
+}
+}
+#endif
+
+// ============================================
+// PLATFORM
+// ============================================
+
+static uint64_t nowNs() {
+#if defined(HOST_BUILD)
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#else
+  return (uint64_t)esp_timer_get_time() * 1000;
+#endif
+}
+
+static void report(const char *format, ...) {
+  char line[160];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+#if defined(HOST_BUILD)
+  fputs(line, stdout);
+#else
+  Serial.print(line);
+#endif
+}
+
+// ============================================
+// INPUTS
+// ============================================
+
+// One 1 Hz NEO-6M epoch with the default message set, as on the UART
+static const char *const epochSentences[] = {
+    "GPRMC,123519.00,A,3648.38330,N,01010.90000,E,22.4,84.4,230324,,,A",
+    "GPVTG,84.4,T,,M,22.4,N,41.5,K,A",
+    "GPGGA,123519.00,3648.38330,N,01010.90000,E,1,08,0.9,45.4,M,32.1,M,,",
+    "GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1",
+    "GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00",
+    "GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00",
+    "GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00",
+    "GPGLL,3648.38330,N,01010.90000,E,123519.00,A,A",
+};
+
+static char nmeaEpoch[640];
+static size_t nmeaEpochLength;
+
+static uint8_t ubxEpochs[BENCH_EPOCHS][200];
+static size_t ubxEpochLength;
+
+static GpsFix sampleFixes[MQTT_BATCH_SIZE];
+
+static void buildNmeaEpoch() {
+  nmeaEpochLength = 0;
+  for (const char *body : epochSentences) {
+    uint8_t sum = 0;
+    for (const char *p = body; *p; p++)
+      sum ^= (uint8_t)*p;
+    nmeaEpochLength += snprintf(nmeaEpoch + nmeaEpochLength,
+                                sizeof(nmeaEpoch) - nmeaEpochLength,
+                                "$%s*%02X\r\n", body, sum);
+  }
+}
+
+static size_t putUbxFrame(uint8_t *out, uint8_t messageClass,
+                          uint8_t messageId, const void *payload,
+                          uint16_t length) {
+  out[0] = UBX_SYNC_1;
+  out[1] = UBX_SYNC_2;
+  out[2] = messageClass;
+  out[3] = messageId;
+  ubxPutU16(out + 4, length);
+  memcpy(out + UBX_HEADER_SIZE, payload, length);
+  ubxChecksum(out + 2, length + 4, out[UBX_HEADER_SIZE + length],
+              out[UBX_HEADER_SIZE + length + 1]);
+  return length + UBX_FRAME_OVERHEAD;
+}
+
+// NAV-POSLLH, SOL, VELNED and TIMEUTC of consecutive epochs
+static void buildUbxEpochs() {
+  for (int i = 0; i < BENCH_EPOCHS; i++) {
+    uint32_t tow = 302119000UL + i * 1000UL;
+
+    UbxNavPosllh position = {};
+    position.iTOW = tow;
+    position.lat = 368063883;
+    position.lon = 101818333 + i * 60;
+    position.hMSL = 45400;
+    position.hAcc = 2500;
+
+    UbxNavSol solution = {};
+    solution.iTOW = tow;
+    solution.gpsFix = 3;
+    solution.flags = 0x01;
+    solution.pDOP = 130;
+    solution.numSV = 8;
+
+    UbxNavVelned velocity = {};
+    velocity.iTOW = tow;
+    velocity.gSpeed = 622;
+    velocity.heading = 8440000;
+
+    UbxNavTimeutc time = {};
+    time.iTOW = tow;
+    time.year = 2024;
+    time.month = 3;
+    time.day = 23;
+    time.hour = 12;
+    time.min = 35;
+    time.sec = (uint8_t)(19 + i) % 60;
+    time.valid = 0x07;
+
+    uint8_t *out = ubxEpochs[i];
+    size_t n = 0;
+    n += putUbxFrame(out + n, UBX_CLASS_NAV, UBX_NAV_POSLLH, &position,
+                     sizeof(position));
+    n += putUbxFrame(out + n, UBX_CLASS_NAV, UBX_NAV_SOL, &solution,
+                     sizeof(solution));
+    n += putUbxFrame(out + n, UBX_CLASS_NAV, UBX_NAV_VELNED, &velocity,
+                     sizeof(velocity));
+    n += putUbxFrame(out + n, UBX_CLASS_NAV, UBX_NAV_TIMEUTC, &time,
+                     sizeof(time));
+    ubxEpochLength = n;
+  }
+}
+
+// A short drive east, one fix per second
+static void buildSampleFixes() {
+  NmeaParser parser;
+  GpsFix fix = {};
+  size_t space;
+  uint8_t *out = parser.writeSpace(space);
+  memcpy(out, nmeaEpoch, nmeaEpochLength);
+  parser.commit(nmeaEpochLength);
+  parser.process(fix, 1);
+
+  for (int i = 0; i < MQTT_BATCH_SIZE; i++) {
+    sampleFixes[i] = fix;
+    sampleFixes[i].longitude += i * 0.00006;
+    sampleFixes[i].setUtcSeconds(fix.utcSeconds() + i);
+  }
+}
+
+// ============================================
+// BENCHMARKS
+// ============================================
+
+// Each op returns the bytes it consumed or produced
+typedef size_t (*BenchOp)(uint32_t iteration);
+
+static size_t benchNmeaIngest(uint32_t iteration) {
+  static NmeaParser parser;
+  static GpsFix fix = {};
+  size_t done = 0;
+  while (done < nmeaEpochLength) {
+    size_t space;
+    uint8_t *out = parser.writeSpace(space);
+    size_t n = nmeaEpochLength - done < space ? nmeaEpochLength - done : space;
+    memcpy(out, nmeaEpoch + done, n);
+    parser.commit(n);
+    parser.process(fix, iteration);
+    done += n;
+  }
+  return done;
+}
+
+static size_t benchTinyGpsIngest(uint32_t iteration) {
+  (void)iteration;
+  static TinyGPSPlus gps;
+  for (size_t i = 0; i < nmeaEpochLength; i++)
+    gps.encode(nmeaEpoch[i]);
+  return nmeaEpochLength;
+}
+
+static size_t benchUbxIngest(uint32_t iteration) {
+  static UbxParser parser;
+  static GpsFix fix = {};
+  const uint8_t *epoch = ubxEpochs[iteration % BENCH_EPOCHS];
+  size_t space;
+  uint8_t *out = parser.writeSpace(space);
+  memcpy(out, epoch, ubxEpochLength);
+  parser.commit(ubxEpochLength);
+  parser.process(fix, iteration);
+  return ubxEpochLength;
+}
+
+// The location payload of the original loop(), for comparison
+static size_t benchSnprintfFix(uint32_t iteration) {
+  const GpsFix &fix = sampleFixes[0];
+  char payload[256];
+  int n = snprintf(payload, sizeof(payload),
+                   "{"
+                   "\"latitude\":%.6f,"
+                   "\"longitude\":%.6f,"
+                   "\"altitude\":%.2f,"
+                   "\"speed\":%.2f,"
+                   "\"satellites\":%d,"
+                   "\"valid\":true,"
+                   "\"timestamp\":%lu"
+                   "}",
+                   fix.latitude, fix.longitude, fix.altitude, fix.speedKmph,
+                   fix.satellites, (unsigned long)iteration);
+  return n > 0 ? (size_t)n : 0;
+}
+
+static size_t benchFormatFixed(uint32_t iteration) {
+  char out[24];
+  return formatFixed(out, sizeof(out),
+                     sampleFixes[iteration % MQTT_BATCH_SIZE].longitude, 7);
+}
+
+static FixBatcher &batchOf(size_t fixes) {
+  static FixBatcher single, full;
+  FixBatcher &batcher = fixes == 1 ? single : full;
+  if (batcher.size() == 0) {
+    for (size_t i = 0; i < fixes; i++)
+      batcher.add(sampleFixes[i], 1000 * i);
+  }
+  return batcher;
+}
+
+static size_t benchJsonSingle(uint32_t iteration) {
+  (void)iteration;
+  char payload[MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS) + 1];
+  size_t included;
+  return batchOf(1).buildPayload(payload, sizeof(payload), included);
+}
+
+static size_t benchJsonBatch(uint32_t iteration) {
+  (void)iteration;
+  char payload[MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS) + 1];
+  size_t included;
+  return batchOf(MQTT_BATCH_SIZE)
+      .buildPayload(payload, sizeof(payload), included);
+}
+
+static size_t benchGpsbBatch(uint32_t iteration) {
+  (void)iteration;
+  uint8_t payload[MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS_BIN)];
+  size_t included;
+  return batchOf(MQTT_BATCH_SIZE)
+      .buildBinaryPayload(payload, sizeof(payload), MQTT_BATCH_SIZE,
+                          included);
+}
+
+// MQTT_PUBLISH_COMPRESSED: the JSON batch through PayloadCompressor
+static size_t benchJsonBatchLz(uint32_t iteration) {
+  (void)iteration;
+  static PayloadCompressor compressor;
+  static char json[MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS) + 1];
+  static size_t jsonLength = 0;
+  if (jsonLength == 0) {
+    size_t included;
+    jsonLength = batchOf(MQTT_BATCH_SIZE)
+                     .buildPayload(json, sizeof(json), included);
+  }
+  uint8_t payload[MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS_Z)];
+  return compressor.compress((const uint8_t *)json, jsonLength, payload,
+                             sizeof(payload));
+}
+
+#if defined(HOST_BUILD)
+static HardwareSerial benchSerial(HOST_UART_COUNT - 1);
+static GPSModule benchGps;
+
+// Ingest through GPSModule::update(), UART driver copy included
+static size_t benchGpsUpdate(uint32_t iteration) {
+  (void)iteration;
+  benchSerial.inject((const uint8_t *)nmeaEpoch, nmeaEpochLength);
+  benchGps.update();
+  return nmeaEpochLength;
+}
+
+static size_t benchLocationJson(uint32_t iteration) {
+  (void)iteration;
+  char payload[256];
+  return benchGps.getLocationJSON(payload, sizeof(payload));
+}
+
+static size_t benchDateTime(uint32_t iteration) {
+  (void)iteration;
+  char text[24];
+  return benchGps.getDateTime(text, sizeof(text));
+}
+#endif
+
+struct Benchmark {
+  const char *name;
+  BenchOp op;
+};
+
+static const Benchmark benchmarks[] = {
+    {"nmea_ingest", benchNmeaIngest},
+    {"tinygps_ingest", benchTinyGpsIngest},
+    {"ubx_ingest", benchUbxIngest},
+#if defined(HOST_BUILD)
+    {"gps_update", benchGpsUpdate},
+    {"gps_location_json", benchLocationJson},
+    {"gps_date_time", benchDateTime},
+#endif
+    {"snprintf_fix", benchSnprintfFix},
+    {"format_fixed", benchFormatFixed},
+    {"json_fix", benchJsonSingle},
+    {"json_batch", benchJsonBatch},
+    {"gpsb_batch", benchGpsbBatch},
+    {"json_batch_lz", benchJsonBatchLz},
+};
+
+// ============================================
+// RUNNER
+// ============================================
+
+static volatile size_t sink; // Keeps results alive
+
+static uint64_t timeOps(BenchOp op, uint32_t count) {
+  size_t total = 0;
+  uint64_t start = nowNs();
+  for (uint32_t i = 0; i < count; i++)
+    total += op(i);
+  uint64_t elapsed = nowNs() - start;
+  sink = total;
+  return elapsed;
+}
+
+static void runBenchmark(const Benchmark &benchmark) {
+  // Grow the op count until a run takes a measurable time, then scale it
+  // to BENCH_TARGET_NS (this also warms caches and static state)
+  uint32_t count = 1;
+  uint64_t elapsed;
+  while ((elapsed = timeOps(benchmark.op, count)) < BENCH_TARGET_NS / 20 &&
+         count < (1u << 28)) {
+    count *= 2;
+  }
+  uint64_t scaled = elapsed ? BENCH_TARGET_NS * count / elapsed : count;
+  count = scaled < 1 ? 1 : (scaled > (1u << 30) ? 1u << 30 : (uint32_t)scaled);
+
+  double best = 0;
+  size_t allocs = 0, bytes = 0;
+  for (int repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+    size_t allocsBefore = allocCount, bytesBefore = allocBytes;
+    double nsPerOp = (double)timeOps(benchmark.op, count) / count;
+    allocs = allocCount - allocsBefore;
+    bytes = allocBytes - bytesBefore;
+    if (repeat == 0 || nsPerOp < best)
+      best = nsPerOp;
+  }
+
+  report("%-18s %10lu %12.1f %8.1f %10.2f %8lu\n", benchmark.name,
+         (unsigned long)count, best, (double)bytes / count,
+         (double)allocs / count, (unsigned long)benchmark.op(0));
+}
+
+static bool selected(const char *name, int filterCount, char **filters) {
+  if (filterCount == 0)
+    return true;
+  for (int i = 0; i < filterCount; i++) {
+    if (strncmp(name, filters[i], strlen(filters[i])) == 0)
+      return true;
+  }
+  return false;
+}
+
+static void runAll(int filterCount, char **filters) {
+  buildNmeaEpoch();
+  buildUbxEpochs();
+  buildSampleFixes();
+#if defined(HOST_BUILD)
+  benchSerial.setRxBufferSize(GPS_UART_RX_BUFFER_SIZE);
+  benchSerial.begin(GPS_BAUD);
+  benchGps.begin(&benchSerial);
+#endif
+
+  report("allocations counted at: %s\n", BENCH_HEAP_HOOKS);
+  report("%-18s %10s %12s %8s %10s %8s\n", "benchmark", "ops", "ns/op",
+         "B/op", "allocs/op", "bytes");
+  for (const Benchmark &benchmark : benchmarks) {
+    if (selected(benchmark.name, filterCount, filters))
+      runBenchmark(benchmark);
+  }
+}
+
+#if defined(HOST_BUILD)
+int main(int argc, char **argv) {
+  runAll(argc - 1, argv + 1);
+  return 0;
+}
+#else
+void setup() {
+  Serial.begin(DEBUG_BAUD);
+  delay(2000); // USB CDC enumeration
+  runAll(0, nullptr);
+}
+
+void loop() { delay(1000); }
+#endif
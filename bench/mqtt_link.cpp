@@ -0,0 +1,250 @@
+// End-to-end MQTT rig: the firmware's GSMModule and MQTTClientModule talk
+// through the simulated SIM800L to an in-process broker behind a shaped
+// GPRS link (lib/HostHAL/src/fake_broker.h). Fixes are offered at a fixed
+// rate and sent the way main.cpp sends them: batched with FixBatcher,
+// published with publishLocation(), reconnect() while the link is down.
+// Reports delivered messages/s, fix-to-PUBACK latency and bytes on the
+// wire per fix.
+//
+//   pio run -e bench_mqtt
+//   .pio/build/bench_mqtt/program
+//   .pio/build/bench_mqtt/program --rate 4 --rtt 1200 --loss 3
+//   .pio/build/bench_mqtt/program --drop-mean 120000 --binary
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "Arduino.h"
+#include "config.h"
+#include "fake_broker.h"
+#include "fake_sim800.h"
+#include "fix_batcher.h"
+#include "gsm.h"
+#include "host_network.h"
+#include "mqtt_client.h"
+
+static_assert(MQTT_QOS >= 1, "the rig times fixes to their PUBACK");
+
+static void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [--duration MS] [--rate FIXES_PER_S] [--binary]\n"
+          "          [--rtt MS] [--up BYTES_PER_S] [--down BYTES_PER_S]\n"
+          "          [--loss PERCENT] [--drop-mean MS] [--seed N]\n"
+          "          [--verbose]\n",
+          program);
+}
+
+// A vehicle heading east at about 50 km/h
+static GpsFix makeFix(unsigned long timestamp) {
+  GpsFix fix = {};
+  fix.latitude = 36.806389;
+  fix.longitude = 10.181667 + timestamp * 1.5e-7;
+  fix.altitude = 45.4;
+  fix.speedKmph = 50.0;
+  fix.satellites = 8;
+  fix.locationValid = true;
+  fix.altitudeValid = true;
+  fix.speedValid = true;
+  fix.locationMillis = timestamp;
+  return fix;
+}
+
+// Nearest rank
+static unsigned long percentile(const std::vector<unsigned long> &sorted,
+                                double q) {
+  if (sorted.empty())
+    return 0;
+  size_t rank = (size_t)(q * sorted.size() + 0.999999);
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+int main(int argc, char **argv) {
+  unsigned long durationMs = 600000;
+  double rate = 1.0;
+  bool binary = false;
+  bool verbose = false;
+  LinkProfile profile;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(arg, "--binary")) {
+      binary = true;
+    } else if (!strcmp(arg, "--verbose")) {
+      verbose = true;
+    } else if (!value) {
+      usage(argv[0]);
+      return 2;
+    } else if (!strcmp(arg, "--duration")) {
+      durationMs = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(arg, "--rate")) {
+      rate = atof(argv[++i]);
+    } else if (!strcmp(arg, "--rtt")) {
+      profile.rttMs = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(arg, "--up")) {
+      profile.upBytesPerS = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(arg, "--down")) {
+      profile.downBytesPerS = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(arg, "--loss")) {
+      profile.lossPercent = (unsigned)atoi(argv[++i]);
+    } else if (!strcmp(arg, "--drop-mean")) {
+      profile.dropMeanMs = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(arg, "--seed")) {
+      profile.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (rate <= 0) {
+    usage(argv[0]);
+    return 2;
+  }
+  Serial.setQuiet(!verbose);
+
+  static FakeBroker broker(profile);
+  hostnet::listen(MQTT_BROKER, MQTT_PORT, &broker);
+  hostclock::addTickHook([](unsigned long) { hostnet::poll(); });
+
+  static HardwareSerial gsmSerial(GSM_UART_NUM);
+  static FakeSim800 modem;
+  gsmSerial.attachPeer(&modem);
+  hostgpio::addWriteHook([](uint8_t pin, uint8_t val) {
+    if (pin == SIM800L_RESET_PIN && val == LOW)
+      modem.reset();
+  });
+  gsmSerial.begin(GSM_BAUD, SERIAL_8N1, GSM_RX_PIN, GSM_TX_PIN);
+
+  GSMModule gsm;
+  if (!gsm.begin(&gsmSerial)) {
+    fprintf(stderr, "GSM bring-up did not start\n");
+    return 1;
+  }
+  MQTTClientModule mqtt(&gsm);
+  mqtt.begin();
+
+  const char *topic = binary ? MQTT_TOPIC_GPS_BIN : MQTT_TOPIC_GPS;
+  FixBatcher batcher;
+  std::deque<unsigned long> backlog; // Offered, not yet in the batcher
+  std::map<uint16_t, std::vector<unsigned long>> awaitingAck;
+  std::vector<unsigned long> fixToAck;
+  unsigned long offered = 0;
+  double nextFixMs = 0; // Fixes are offered from the first connect on
+  unsigned long lastMqttLoop = 0;
+
+  while (millis() < durationMs) {
+    unsigned long now = millis();
+
+    gsm.poll();
+    if (gsm.isReady() && !mqtt.isConnectedToBroker())
+      mqtt.reconnect();
+    if (now - lastMqttLoop >= MQTT_LOOP_INTERVAL_MS) {
+      lastMqttLoop = now;
+      mqtt.loop();
+    }
+
+    if (mqtt.getFirstConnectTime() != 0) {
+      if (nextFixMs == 0)
+        nextFixMs = now;
+      for (; nextFixMs <= now; nextFixMs += 1000.0 / rate) {
+        backlog.push_back((unsigned long)nextFixMs);
+        offered++;
+      }
+    }
+
+    // Sent as flushBatch() does; what the outbox refuses is retried
+    while (true) {
+      while (batcher.size() < MQTT_BATCH_SIZE && !backlog.empty()) {
+        batcher.add(makeFix(backlog.front()), backlog.front());
+        backlog.pop_front();
+      }
+      if (!mqtt.isConnectedToBroker() || !batcher.isDue(now))
+        break;
+
+      uint16_t packetId = mqtt.getNextPacketId();
+      size_t included = 0;
+      bool published = false;
+      if (binary) {
+        uint8_t payload[MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS_BIN)];
+        size_t length = batcher.buildBinaryPayload(
+            payload, sizeof(payload), MQTT_BATCH_SIZE, included);
+        published = length > 0 && mqtt.publishLocationBinary(payload, length);
+      } else {
+        char payload[MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS) + 1];
+        size_t length =
+            batcher.buildPayload(payload, sizeof(payload), included);
+        published = length > 0 && mqtt.publishLocation(payload, length);
+      }
+      if (!published)
+        break;
+
+      std::vector<unsigned long> &fixes = awaitingAck[packetId];
+      for (size_t i = 0; i < included; i++) {
+        fixes.push_back(batcher.at(i).timestamp);
+      }
+      batcher.consume(included);
+    }
+
+    uint16_t packetId;
+    unsigned long ackMs;
+    while (broker.takeDeliveredAck(packetId, ackMs)) {
+      auto waiting = awaitingAck.find(packetId);
+      if (waiting == awaitingAck.end())
+        continue; // Ack for a resend already acknowledged
+      for (unsigned long timestamp : waiting->second) {
+        fixToAck.push_back(ackMs - timestamp);
+      }
+      awaitingAck.erase(waiting);
+    }
+
+    delay(10); // As main.cpp's loop()
+  }
+
+  unsigned long firstConnect = mqtt.getFirstConnectTime();
+  double seconds = firstConnect ? (millis() - firstConnect) / 1000.0 : 0;
+  unsigned long delivered = 0;
+  for (const BrokerMessage &message : broker.getMessages()) {
+    if (message.topic == topic)
+      delivered++;
+  }
+  const BrokerStats stats = broker.getStats();
+  unsigned long mqttBytes = stats.bytesUp + stats.bytesDown;
+  unsigned long wireBytes =
+      mqttBytes + LINK_HEADER_BYTES * (stats.segmentsUp + stats.segmentsDown);
+  std::sort(fixToAck.begin(), fixToAck.end());
+  size_t acked = fixToAck.size();
+
+  printf("link:              rtt %lu ms, up %lu B/s, down %lu B/s, "
+         "loss %u %%, reset every ~%lu s\n",
+         profile.rttMs, profile.upBytesPerS, profile.downBytesPerS,
+         profile.lossPercent, profile.dropMeanMs / 1000);
+  printf("offered:           %.2f fixes/s, %s, batches of %d\n", rate,
+         binary ? "GPSB" : "JSON", MQTT_BATCH_SIZE);
+  printf("measured:          %.1f s from the first connect (at %lu ms)\n",
+         seconds, firstConnect);
+  printf("fixes:             %lu offered, %lu acknowledged, %lu waiting\n",
+         offered, (unsigned long)acked,
+         offered - (unsigned long)acked);
+  printf("delivered:         %lu messages (%.3f/s), %.2f fixes/s\n",
+         delivered, seconds > 0 ? delivered / seconds : 0.0,
+         seconds > 0 ? acked / seconds : 0.0);
+  printf("fix to ack (ms):   p50 %lu, p99 %lu, max %lu\n",
+         percentile(fixToAck, 0.50), percentile(fixToAck, 0.99),
+         acked ? fixToAck.back() : 0);
+  printf("bytes per fix:     %.1f MQTT, %.1f with TCP/IP headers\n",
+         acked ? (double)mqttBytes / acked : 0.0,
+         acked ? (double)wireBytes / acked : 0.0);
+  printf("connections:       %lu connects (%lu resumed), %lu resets, "
+         "%lu keep-alive expiries\n",
+         stats.connects, stats.sessionsResumed, stats.linkDrops,
+         stats.keepAliveExpired);
+  printf("broker:            %lu publishes, %lu duplicates, "
+         "%lu segments lost\n",
+         stats.publishes, stats.duplicates, stats.segmentsLost);
+  return 0;
+}
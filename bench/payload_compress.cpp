@@ -0,0 +1,190 @@
+// Payload compression benchmark: replays recorded NMEA drives into
+// FixBatcher, compresses every location batch with PayloadCompressor at
+// several settings and reports the compression ratio against CPU time.
+// Every payload is decoded again with payloadDecompress() and compared.
+//
+//   pio run -e bench_compress
+//   .pio/build/bench_compress/program drive1.nmea drive2.nmea
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "fix_batcher.h"
+#include "gps_fix.h"
+#include "payload_codec.h"
+#include "track_loader.h"
+
+#define BENCH_TARGET_NS 200000000ULL // Per timed run
+#define BENCH_BOOT_MS 60000          // millis() of the first fix
+
+// Full batches, as flushBatch() publishes them
+static void buildBatches(const std::vector<TrackPoint> &track, bool binary,
+                         std::vector<std::string> &payloads) {
+  FixBatcher batcher;
+  size_t next = 0;
+  while (next < track.size() || batcher.size() > 0) {
+    while (batcher.size() < MQTT_BATCH_SIZE && next < track.size()) {
+      batcher.add(track[next].fix, BENCH_BOOT_MS + track[next].timestamp);
+      next++;
+    }
+
+    size_t included = 0;
+    size_t length;
+    if (binary) {
+      uint8_t payload[MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS_BIN)];
+      length = batcher.buildBinaryPayload(payload, sizeof(payload),
+                                          MQTT_BATCH_SIZE, included);
+      payloads.push_back(std::string((const char *)payload, length));
+    } else {
+      char payload[MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS) + 1];
+      length = batcher.buildPayload(payload, sizeof(payload), included);
+      payloads.push_back(std::string(payload, length));
+    }
+    if (included == 0)
+      break;
+    batcher.consume(included);
+  }
+}
+
+struct Setting {
+  const char *name;
+  bool binary;
+  bool dictionary;
+  uint8_t chain;
+};
+
+struct Result {
+  size_t inputBytes;
+  size_t outputBytes;
+  size_t stored; // Payloads sent as is
+  double compressNs;
+  double decompressNs;
+  bool roundTrip;
+};
+
+static double nsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static volatile size_t sink; // Keeps results alive
+
+// Best of three runs of at least BENCH_TARGET_NS, per payload
+template <typename Op>
+static double timePayloads(const std::vector<std::string> &payloads, Op op) {
+  double best = 0;
+  for (int run = 0; run < 3; run++) {
+    size_t passes = 0;
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed;
+    do {
+      for (const std::string &payload : payloads) {
+        total += op(payload);
+      }
+      passes++;
+    } while ((elapsed = nsSince(start)) < BENCH_TARGET_NS);
+    sink = total;
+    double perPayload = elapsed / (passes * payloads.size());
+    if (run == 0 || perPayload < best)
+      best = perPayload;
+  }
+  return best;
+}
+
+static Result run(const std::vector<std::string> &payloads,
+                  const Setting &setting) {
+  static PayloadCompressor compressor; // Off the stack, as in main.cpp
+  compressor = PayloadCompressor(setting.chain, setting.dictionary);
+
+  Result result = {};
+  result.roundTrip = true;
+  uint8_t out[MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS_Z)];
+  uint8_t back[MQTT_BUFFER_SIZE];
+  std::vector<std::string> compressed;
+  for (const std::string &payload : payloads) {
+    size_t length = compressor.compress((const uint8_t *)payload.data(),
+                                        payload.size(), out, sizeof(out));
+    size_t decoded = payloadDecompress(out, length, back, sizeof(back));
+    if (length == 0 || decoded != payload.size() ||
+        memcmp(back, payload.data(), decoded) != 0)
+      result.roundTrip = false;
+    result.inputBytes += payload.size();
+    result.outputBytes += length;
+    if (length > 0 && out[0] == PAYLOAD_STORED)
+      result.stored++;
+    compressed.push_back(std::string((const char *)out, length));
+  }
+
+  result.compressNs =
+      timePayloads(payloads, [&](const std::string &payload) {
+        return compressor.compress((const uint8_t *)payload.data(),
+                                   payload.size(), out, sizeof(out));
+      });
+  result.decompressNs =
+      timePayloads(compressed, [&](const std::string &payload) {
+        return payloadDecompress((const uint8_t *)payload.data(),
+                                 payload.size(), back, sizeof(back));
+      });
+  return result;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s drive.nmea...\n", argv[0]);
+    return 2;
+  }
+
+  static const Setting settings[] = {
+      {"json lz chain 1", false, false, 1},
+      {"json lz chain 4", false, false, 4},
+      {"json dict chain 1", false, true, 1},
+      {"json dict chain 4", false, true, 4},
+      {"json dict chain 16", false, true, 16},
+      {"json dict chain 64", false, true, 64},
+      {"gpsb lz chain 4", true, false, 4},
+  };
+
+  printf("working memory: %zu bytes, batches of %d fixes\n",
+         sizeof(PayloadCompressor), MQTT_BATCH_SIZE);
+  printf("%-20s %-20s %7s %7s %7s %6s %9s %9s %6s\n", "drive", "setting",
+         "batches", "in_B", "out_B", "ratio", "comp_us", "decomp_us",
+         "stored");
+  for (int i = 1; i < argc; i++) {
+    const char *path = argv[i];
+    std::vector<TrackPoint> track;
+    if (!loadTrack(path, track))
+      return 1;
+    if (track.empty()) {
+      fprintf(stderr, "%s: no fixes\n", path);
+      continue;
+    }
+
+    std::vector<std::string> json;
+    std::vector<std::string> gpsb;
+    buildBatches(track, false, json);
+    buildBatches(track, true, gpsb);
+
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    for (const Setting &setting : settings) {
+      const std::vector<std::string> &payloads = setting.binary ? gpsb : json;
+      Result r = run(payloads, setting);
+      if (!r.roundTrip) {
+        fprintf(stderr, "%s: %s does not round-trip\n", name, setting.name);
+        return 1;
+      }
+      size_t count = payloads.size();
+      printf("%-20s %-20s %7zu %7.1f %7.1f %5.2fx %9.2f %9.2f %6zu\n", name,
+             setting.name, count, (double)r.inputBytes / count,
+             (double)r.outputBytes / count,
+             (double)r.inputBytes / r.outputBytes, r.compressNs / 1000,
+             r.decompressNs / 1000, r.stored);
+    }
+  }
+  return 0;
+}
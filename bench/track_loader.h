@@ -0,0 +1,58 @@
+#ifndef BENCH_TRACK_LOADER_H
+#define BENCH_TRACK_LOADER_H
+
+// Recorded NMEA drives for the host benches: runs the file through
+// NmeaParser and keeps one fix per receiver epoch, as the firmware sees
+// them.
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "gps_fix.h"
+#include "nmea_parser.h"
+
+struct TrackPoint {
+  GpsFix fix;
+  unsigned long timestamp; // ms since the first fix
+};
+
+inline bool loadTrack(const char *path, std::vector<TrackPoint> &track) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+
+  NmeaParser parser;
+  GpsFix fix = {};
+  unsigned long lastLocation = 0;
+  unsigned long clock = 0;
+  uint32_t firstUtc = 0;
+
+  for (;;) {
+    size_t space;
+    uint8_t *out = parser.writeSpace(space);
+    size_t n = fread(out, 1, space > 128 ? 128 : space, file);
+    if (n == 0)
+      break;
+    parser.commit(n);
+    // Every chunk is a new millisecond so each epoch gets a fresh stamp
+    parser.process(fix, ++clock);
+
+    if (!fix.locationValid || fix.locationMillis == lastLocation)
+      continue;
+    lastLocation = fix.locationMillis;
+
+    uint32_t utc = fix.utcSeconds();
+    if (firstUtc == 0)
+      firstUtc = utc;
+    unsigned long timestamp =
+        (unsigned long)(utc - firstUtc) * 1000 + fix.centisecond * 10;
+    track.push_back({fix, timestamp});
+  }
+  fclose(file);
+  return true;
+}
+
+#endif // BENCH_TRACK_LOADER_H
@@ -0,0 +1,132 @@
+// Track simplification benchmark: replays recorded NMEA drives through
+// TrackSimplifier at several tolerances and reports how many fixes are
+// kept against how far the reported polyline strays from the full track.
+//
+//   pio run -e bench_track
+//   .pio/build/bench_track/program drive1.nmea drive2.nmea
+//   .pio/build/bench_track/program --tolerance 5,10,25 drive1.nmea
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "geo.h"
+#include "gps_fix.h"
+#include "track_loader.h"
+#include "track_simplifier.h"
+
+// Meters from p to the segment a-b, in a plane tangent at a
+static double segmentDistance(const GpsFix &p, const GpsFix &a,
+                              const GpsFix &b) {
+  double k = GEO_EARTH_RADIUS_M * GEO_DEG_TO_RAD;
+  double c = cos(a.latitude * GEO_DEG_TO_RAD);
+  double px = (p.longitude - a.longitude) * k * c;
+  double py = (p.latitude - a.latitude) * k;
+  double bx = (b.longitude - a.longitude) * k * c;
+  double by = (b.latitude - a.latitude) * k;
+  double lengthSq = bx * bx + by * by;
+  double t = lengthSq > 0 ? (px * bx + py * by) / lengthSq : 0;
+  t = t < 0 ? 0 : (t > 1 ? 1 : t);
+  return hypot(px - t * bx, py - t * by);
+}
+
+struct Result {
+  size_t kept;
+  double maxDeviation;
+  double meanDeviation;
+  double nsPerFix;
+};
+
+static Result run(const std::vector<TrackPoint> &track, float tolerance) {
+  // Indices of kept fixes; first and last always stay
+  std::vector<size_t> kept;
+  kept.push_back(0);
+
+  TrackSimplifier simplifier(tolerance);
+  GpsFix keyFix;
+  unsigned long keyTime;
+  std::vector<unsigned long> keyTimes;
+
+  auto start = std::chrono::steady_clock::now();
+  for (const TrackPoint &point : track) {
+    if (simplifier.add(point.fix, point.timestamp, keyFix, keyTime))
+      keyTimes.push_back(keyTime);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // Map key timestamps back to track indices (timestamps are increasing)
+  size_t index = 0;
+  for (unsigned long t : keyTimes) {
+    while (index < track.size() && track[index].timestamp != t)
+      index++;
+    if (index < track.size() && index != kept.back())
+      kept.push_back(index);
+  }
+  if (kept.back() != track.size() - 1)
+    kept.push_back(track.size() - 1);
+
+  Result result = {};
+  result.kept = kept.size();
+  double total = 0;
+  for (size_t k = 0; k + 1 < kept.size(); k++) {
+    const GpsFix &a = track[kept[k]].fix;
+    const GpsFix &b = track[kept[k + 1]].fix;
+    for (size_t i = kept[k] + 1; i < kept[k + 1]; i++) {
+      double d = segmentDistance(track[i].fix, a, b);
+      total += d;
+      if (d > result.maxDeviation)
+        result.maxDeviation = d;
+    }
+  }
+  result.meanDeviation = total / track.size();
+  result.nsPerFix =
+      std::chrono::duration<double, std::nano>(elapsed).count() /
+      track.size();
+  return result;
+}
+
+int main(int argc, char **argv) {
+  std::vector<float> tolerances = {2, 5, 10, 20, 50};
+  std::vector<const char *> files;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+      tolerances.clear();
+      for (char *s = strtok(argv[++i], ","); s; s = strtok(nullptr, ","))
+        tolerances.push_back((float)atof(s));
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+  if (files.empty()) {
+    fprintf(stderr, "usage: %s [--tolerance M[,M...]] drive.nmea...\n",
+            argv[0]);
+    return 2;
+  }
+
+  printf("%-24s %8s %8s %7s %8s %9s %10s %8s\n", "drive", "tol_m", "fixes",
+         "kept", "ratio", "max_dev_m", "mean_dev_m", "ns/fix");
+  for (const char *path : files) {
+    std::vector<TrackPoint> track;
+    if (!loadTrack(path, track))
+      return 1;
+    if (track.size() < 2) {
+      fprintf(stderr, "%s: fewer than two fixes\n", path);
+      continue;
+    }
+
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    for (float tolerance : tolerances) {
+      Result r = run(track, tolerance);
+      printf("%-24s %8.1f %8zu %7zu %7.1fx %9.2f %10.2f %8.1f\n", name,
+             tolerance, track.size(), r.kept,
+             (double)track.size() / r.kept, r.maxDeviation, r.meanDeviation,
+             r.nsPerFix);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+#ifndef AT_ENGINE_H
+#define AT_ENGINE_H
+
+#include <Arduino.h>
+#include <stddef.h>
+
+#define AT_LINE_MAX 128     // Longest response line kept
+#define AT_RESPONSE_MAX 256 // Information lines of one command line
+#define AT_COMMAND_MAX 96   // Command text after "AT" (joined or single)
+#define AT_QUEUE_SIZE 8     // Commands waiting to be sent
+#define AT_URC_HANDLERS 8   // Registered unsolicited result codes
+
+// Query that may share a command line with neighbouring AT_JOIN queries
+// ("AT+CSQ;+CREG?;+CGATT?"): one round trip instead of several. Only for
+// commands whose reply lines carry their own prefix.
+#define AT_JOIN 0x01
+
+enum AtResult : uint8_t {
+  AT_PENDING, // No final result code yet
+  AT_OK,
+  AT_ERROR, // ERROR, +CME ERROR or +CMS ERROR
+  AT_TIMEOUT,
+};
+
+// Called once per command with the information lines of its command line
+// (joined with '\n'; shared by all commands of a joined line)
+typedef void (*AtCallback)(void *context, AtResult result,
+                           const char *response);
+
+// Called with each unsolicited line matching a registered prefix
+typedef void (*AtLineHandler)(void *context, const char *line);
+
+// Text following prefix (e.g. "+CSQ:") in a response, or nullptr
+const char *atFind(const char *response, const char *prefix);
+
+// Asynchronous AT command engine on the modem UART. Commands are queued
+// with submit() and written one command line at a time; poll() reads
+// whatever bytes have arrived, assembles lines, completes the command in
+// flight and starts the next one in the same call. Lines that do not
+// belong to the command in flight go to the unsolicited handlers.
+class AtEngine {
+private:
+  struct Command {
+    char text[AT_COMMAND_MAX];
+    unsigned long timeoutMs;
+    AtCallback callback;
+    void *context;
+    const char *finalLine; // Extra line that ends it, e.g. SHUT OK
+    uint8_t flags;
+  };
+
+  struct UrcHandler {
+    const char *prefix;
+    AtLineHandler handler;
+    void *context;
+  };
+
+  Stream *stream;
+
+  Command queue[AT_QUEUE_SIZE];
+  uint8_t head;
+  uint8_t count;
+  uint8_t inFlight; // Queue entries on the current command line
+
+  UrcHandler handlers[AT_URC_HANDLERS];
+  uint8_t handlerCount;
+
+  char current[AT_COMMAND_MAX]; // Command line in flight, without "AT"
+  unsigned long startedAt;
+  unsigned long startedMicros;
+  unsigned long timeoutMs;
+
+  char line[AT_LINE_MAX];
+  size_t lineLength;
+
+  char response[AT_RESPONSE_MAX];
+  size_t responseLength;
+
+  unsigned long commandLines;
+  unsigned long unsolicited;
+  unsigned long timeouts;
+
+  void start();
+  void complete(AtResult result);
+  void handleLine();
+  bool dispatchUnsolicited();
+  bool isSolicited() const;
+
+public:
+  AtEngine();
+
+  void begin(Stream *modemStream) { stream = modemStream; }
+
+  // Queue "AT<command>"; false if the queue is full or the text too long
+  bool submit(const char *command, unsigned long timeout,
+              AtCallback callback = nullptr, void *context = nullptr,
+              uint8_t flags = 0, const char *finalLine = nullptr);
+
+  // Route unsolicited lines starting with prefix (after an optional
+  // "<n>, " link number, as in "0, CLOSED") to handler
+  bool onUnsolicited(const char *prefix, AtLineHandler handler,
+                     void *context);
+
+  // Read available bytes, dispatch lines, advance the queue
+  void poll();
+
+  // Drop queued and in-flight commands without callbacks (modem reset)
+  void abort();
+
+  // A command line is waiting for its result; the UART is not free
+  bool isBusy() const { return inFlight > 0; }
+  bool isIdle() const { return inFlight == 0 && count == 0; }
+  size_t getQueued() const { return count; }
+
+  unsigned long getCommandLines() const { return commandLines; }
+  unsigned long getUnsolicited() const { return unsolicited; }
+  unsigned long getTimeouts() const { return timeouts; }
+};
+
+#endif // AT_ENGINE_H
@@ -10,16 +10,18 @@
 // No UART sharing or multiplexing is used.
 
 // GPS (NEO-6M) - UART0 (Dedicated)
-#define GPS_UART_NUM 0 // UART0
-#define GPS_TX_PIN 17  // TX - Connect to NEO-6M RX
-#define GPS_RX_PIN 18  // RX - Connect to NEO-6M TX
-#define GPS_BAUD 9600  // NEO-6M default baud rate
+#define GPS_UART_NUM 0       // UART0
+#define GPS_TX_PIN 17        // TX - Connect to NEO-6M RX
+#define GPS_RX_PIN 18        // RX - Connect to NEO-6M TX
+#define GPS_BAUD 9600        // NEO-6M default baud rate
+#define GPS_BAUD_FAST 115200 // Negotiated at startup (GPS_BAUD: keep default)
 
 // GSM (SIM800L) - UART1 (Dedicated)
-#define GSM_UART_NUM 1 // UART1
-#define GSM_TX_PIN 43  // TX - Connect to SIM800L RX
-#define GSM_RX_PIN 44  // RX - Connect to SIM800L TX
-#define GSM_BAUD 9600  // SIM800L default baud rate
+#define GSM_UART_NUM 1       // UART1
+#define GSM_TX_PIN 43        // TX - Connect to SIM800L RX
+#define GSM_RX_PIN 44        // RX - Connect to SIM800L TX
+#define GSM_BAUD 9600        // SIM800L default baud rate
+#define GSM_BAUD_FAST 115200 // Set with AT+IPR in bring-up (GSM_BAUD: keep)
 
 // SIM800L Control Pins
 #define SIM800L_RESET_PIN 4  // SIM800L hardware reset pin (RST)
@@ -43,11 +45,44 @@
 #define MQTT_USER "your_username" // Your MQTT username
 #define MQTT_PASS "your_password" // Your MQTT password
 #define MQTT_CLIENT_ID "ESP32_GPS_Tracker"
-#define MQTT_BUFFER_SIZE 512
+#define MQTT_BUFFER_SIZE 1024 // Fits a full MQTT_BATCH_SIZE batch
+
+// Fixes per location message (1 = one JSON object per fix, as before).
+// A batch is sent when full or when its oldest fix reaches the max age.
+#define MQTT_BATCH_SIZE 6
+#define MQTT_BATCH_MAX_AGE_MS 30000
 
 // MQTT Topics
 #define MQTT_TOPIC_GPS "gps/location"
 #define MQTT_TOPIC_STATUS "gps/status"
+#define MQTT_TOPIC_GPS_BIN "gps/location/bin"
+#define MQTT_TOPIC_GPS_Z "gps/location/z"
+#define MQTT_TOPIC_COMMAND "gps/command" // Runtime settings (subscribed)
+#define MQTT_TOPIC_ALARM "gps/alarm"
+
+// Outbound queue. Alarms go first, then locations, status, metrics.
+// QoS 1 messages wait in RAM until the broker acknowledges them; several
+// can be unacknowledged at once so one GPRS round trip (0.5-2 s) does not
+// cap throughput. Status and metrics are QoS 0 and dropped first when the
+// link cannot keep up.
+#define MQTT_QOS 1                    // Locations: 0 or 1 (alarms: always 1)
+#define MQTT_INFLIGHT_WINDOW 4        // Unacknowledged messages on the wire
+#define MQTT_OUTBOX_SLOTS 8           // Queued + in flight (~1 KB each)
+#define MQTT_OUTBOX_ALARM_SLOTS 0     // Of those, kept free for alarms
+#define MQTT_STATUS_MAX_AGE_MS 60000  // Unsent status is dropped after this
+#define MQTT_RETRY_INTERVAL_MS 20000  // Resend without PUBACK after this
+#define MQTT_CLEAN_SESSION false      // Keep session state across reconnects
+#define MQTT_LOOP_INTERVAL_MS 100     // Poll for PUBACKs and broker traffic
+#define MQTT_KEEPALIVE_S 120          // Outlasts a parked light sleep
+
+// Location encodings: JSON on MQTT_TOPIC_GPS, delta-coded binary (GPSB,
+// docs/BINARY_FORMAT.md) on MQTT_TOPIC_GPS_BIN, LZ-compressed JSON
+// (docs/COMPRESSED_FORMAT.md) on MQTT_TOPIC_GPS_Z. Enable at least one.
+#define MQTT_PUBLISH_JSON true
+#define MQTT_PUBLISH_BINARY false
+#define MQTT_PUBLISH_COMPRESSED false
+#define PAYLOAD_COMPRESS_CHAIN 4          // Match candidates tried per byte
+#define PAYLOAD_COMPRESS_DICTIONARY true  // Prime with typical batch JSON
 
                            // Your API key if needed
 
@@ -59,11 +94,147 @@
 #define GPS_READ_DURATION_MS 20      // Time to read GPS data per update
 #define GPS_DATA_MAX_AGE_MS 2000     // Max age for valid GPS data (2 seconds)
 #define GPS_MIN_CHARS_PROCESSED 100  // Min characters to consider GPS ready
-#define GPS_UPDATE_INTERVAL 5000     // Send GPS data every 5 seconds
+#define GPS_UPDATE_INTERVAL 5000     // MQTT service tick; fixed publish rate
+#define GPS_BULK_INGEST true         // Ring-buffer NMEA path (false: TinyGPSPlus)
+#define GPS_RING_BUFFER_SIZE 1024    // NMEA ring size, power of two
+#define GPS_UART_RX_BUFFER_SIZE 2048 // Driver RX buffer (~180ms at 115200)
+#define GPS_BAUD_SWITCH_MS 100       // CFG-PRT sent to receiver listening
+#define GPS_BAUD_VERIFY_MS 1500      // Wait for a valid sentence (1 Hz output)
+#define GPS_UBX_MODE true            // Binary NAV messages (needs bulk ingest)
+#define GPS_UBX_ACK_TIMEOUT_MS 500   // CFG message unanswered: stay on NMEA
+#define UBX_BUFFER_SIZE 512          // UBX frame buffer (NAV epoch: 168 bytes)
 #define CONNECTIVITY_CHECK_MS 10000  // Check connectivity every 10 seconds
 #define MQTT_RECONNECT_INTERVAL 5000 // Try to reconnect to MQTT every 5 seconds
 #define MQTT_RECONNECT_MAX_INTERVAL 60000UL // Max backoff interval
-#define GSM_TIMEOUT 30000                   // GSM connection timeout
+#define GSM_TIMEOUT 30000                   // Network registration timeout
+
+// GSM bring-up (non-blocking, see GSMModule::poll())
+#define SIM800L_RESET_PULSE_MS 200      // Reset pin held low
+#define SIM800L_BOOT_MS 3000            // Reset release to first AT
+#define GSM_PROBE_TIMEOUT_MS 10000      // AT unanswered: modem missing
+#define GSM_SIM_TIMEOUT_MS 10000        // +CPIN? not READY
+#define GSM_SIGNAL_TIMEOUT_MS 30000     // +CSQ stays 0 or 99
+#define GSM_ATTACH_TIMEOUT_MS 90000     // Whole GPRS attach sequence
+#define GSM_RETRY_INTERVAL_MS 5000      // First back-off after a failure
+#define GSM_RETRY_MAX_INTERVAL_MS 60000 // Back-off cap
+#define GSM_RESET_AFTER_FAILURES 3      // Hardware reset after N failures
+#define GSM_STATUS_QUERY_MS 30000       // +CSQ/+CREG?/+CGATT? while ready
+#define GSM_BAUD_VERIFY_MS 2000         // AT answered after AT+IPR
+#define GSM_RESUME_TIMEOUT_MS 2000      // Warm start: AT unanswered, reset
+
+// ============================================
+// GPS RECEIVER CONFIGURATION
+// ============================================
+
+// Applied at boot and changed at runtime through MQTT_TOPIC_COMMAND
+// (see README). Dynamic platform models (CFG-NAV5):
+#define GPS_MODEL_PORTABLE 0
+#define GPS_MODEL_STATIONARY 2
+#define GPS_MODEL_PEDESTRIAN 3
+#define GPS_MODEL_AUTOMOTIVE 4
+#define GPS_DYNAMIC_MODEL GPS_MODEL_AUTOMOTIVE
+
+#define GPS_MEASUREMENT_RATE_MS 1000 // Fix period, 200 (5 Hz) to 1000
+#define GPS_MINIMAL_MESSAGES true    // Only the messages the parser decodes
+
+// Receiver power (see README). Cyclic tracking while awake; between parked
+// position checks and heartbeats the receiver goes to backup and hot
+// starts in time for the next fix the publish loop needs.
+#define GPS_POWER_SAVE true          // CFG-RXM power save, cyclic tracking
+#define GPS_BACKUP_ENABLED true      // RXM-PMREQ backup while parked
+#define GPS_PARKED_CHECK_MS 60000    // Parked: fix to look for movement
+#define GPS_HOT_START_MS 5000        // Wake this long before a fix is due
+#define GPS_BACKUP_MIN_MS 15000      // Shorter gaps stay tracking
+#define GPS_ACQUIRE_TIMEOUT_MS 60000 // Wake-to-fix longer: count as failed
+#define GPS_BACKUP_POLL_MS 1000      // Ingest period while in backup
+
+// Warm start: the last fix and time, kept in RTC memory, are sent to the
+// receiver (AID-INI) at boot so it need not search the whole sky
+#define GPS_START_HINT true           // Send the hint when one is retained
+#define GPS_HINT_MAX_AGE_MS 14400000  // Older fixes are no help (4 h)
+#define GPS_HINT_DRIFT_M_PER_S 40     // Position uncertainty growth, moving
+
+// ============================================
+// PUBLISH SCHEDULING
+// ============================================
+
+// When a fix is reported. FIXED samples every GPS_UPDATE_INTERVAL as
+// before; DISTANCE reports every PUBLISH_DISTANCE_M travelled; ADAPTIVE
+// also reports corners and start/stop, and stays quiet while parked.
+#define PUBLISH_POLICY_FIXED 0
+#define PUBLISH_POLICY_DISTANCE 1
+#define PUBLISH_POLICY_ADAPTIVE 2
+#define PUBLISH_POLICY PUBLISH_POLICY_ADAPTIVE
+
+#define PUBLISH_MIN_INTERVAL_MS 1000       // Never report faster than this
+#define PUBLISH_MAX_INTERVAL_MS 60000      // Report at least this often moving
+#define PUBLISH_PARKED_INTERVAL_MS 900000  // Heartbeat while parked (15 min)
+#define PUBLISH_DISTANCE_M 150             // Distance trigger
+#define PUBLISH_HEADING_DEG 25             // Corner trigger (ADAPTIVE)
+#define PUBLISH_CORNER_MIN_KMH 10.0        // Course is noise below this speed
+#define PUBLISH_STATIONARY_KMH 3.0         // Slower than this counts as parked
+#define PUBLISH_STOP_DWELL_MS 20000        // ...for this long to count as stopped
+#define PUBLISH_DEADBAND_M 30              // Parked position wander ignored
+
+// ============================================
+// TRACK SIMPLIFICATION
+// ============================================
+
+// While moving, keep only the fixes needed to redraw the track within
+// TRACK_TOLERANCE_M; they replace the ADAPTIVE distance and heading
+// triggers (start/stop, heartbeat and max interval still apply)
+#define TRACK_SIMPLIFY_ENABLED true
+#define TRACK_TOLERANCE_M 10.0 // Max distance of a dropped fix from the line
+#define TRACK_WINDOW_SIZE 64   // Buffered fixes (8 bytes each)
+
+// ============================================
+// STORE-AND-FORWARD JOURNAL
+// ============================================
+
+// Fixes that cannot be published are appended to a raw flash partition
+// (see partitions.csv) and replayed once the broker is reachable again
+#define JOURNAL_ENABLED true
+#define JOURNAL_PARTITION_LABEL "journal"
+#define JOURNAL_DRAIN_INTERVAL_MS 1000 // Replay pace while connected
+#define JOURNAL_DRAIN_BATCH 4          // Replays queued, not yet acknowledged
+
+// ============================================
+// SLEEP WHILE PARKED
+// ============================================
+
+// Once parked with nothing left to send, the ESP32 sleeps while the GPS
+// receiver is in backup and wakes for its hot start (see README). The
+// SIM800L stays registered in AT+CSCLK=2 sleep. Light sleep keeps the
+// MQTT session open; after SLEEP_DEEP_AFTER_MS parked, long gaps are
+// spent in deep sleep and the firmware restarts from RTC memory.
+#define SLEEP_ENABLED true
+#define SLEEP_LIGHT_MIN_MS 10000    // Shorter gaps stay awake
+#define SLEEP_DEEP_AFTER_MS 1800000 // Parked this long allows deep sleep
+#define SLEEP_DEEP_MIN_MS 120000    // Shorter gaps use light sleep
+#define SLEEP_DEEP_CHECK_MS 600000  // Parked check period once deep sleeping
+#define SLEEP_WAKE_PIN -1           // RTC GPIO ending sleep early (-1: none)
+#define SLEEP_WAKE_LEVEL 1          // Wake pin level that wakes
+#define GSM_WAKE_PROBE_MS 300       // First AT after modem sleep (byte lost)
+
+// ============================================
+// METRICS
+// ============================================
+
+// Stage latency histograms (p50/p99/max) and UART/parser error counters,
+// published on MQTT_TOPIC_STATUS once per window (see README)
+#define METRICS_ENABLED true
+#define METRICS_PUBLISH_INTERVAL_MS 900000 // Window length (15 min)
+
+// ============================================
+// TASK CONFIGURATION
+// ============================================
+
+// GPS ingest runs in its own FreeRTOS task so blocking modem calls in
+// loop() (network registration, GPRS attach) cannot starve the GPS UART
+#define GPS_TASK_ENABLED true
+#define GPS_TASK_CORE 0         // loop() runs on core 1
+#define GPS_TASK_PRIORITY 3     // Above loopTask (1)
+#define GPS_TASK_STACK_SIZE 4096
 
 // ============================================
 // DEBUG CONFIGURATION
@@ -0,0 +1,53 @@
+#ifndef FIX_BATCHER_H
+#define FIX_BATCHER_H
+
+#include "config.h"
+#include "gps_fix.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// PubSubClient needs room for the fixed header, topic length and topic
+#define MQTT_MAX_PAYLOAD(topic)                                               \
+  (MQTT_BUFFER_SIZE - 5 - 2 - (sizeof(topic) - 1))
+
+struct BatchEntry {
+  GpsFix fix;
+  unsigned long timestamp; // millis() when the fix was sampled
+};
+
+// Collects fixes and serializes them into as few MQTT payloads as the
+// broker buffer allows. A batch is due when MQTT_BATCH_SIZE fixes are
+// queued or the oldest one is MQTT_BATCH_MAX_AGE_MS old. With
+// MQTT_BATCH_SIZE 1 the payload is the single-fix object used before
+// batching; otherwise it is a JSON array of those objects.
+class FixBatcher {
+private:
+  BatchEntry entries[MQTT_BATCH_SIZE];
+  size_t count;
+
+public:
+  FixBatcher();
+
+  // Queue a fix; returns false if the batch is already full
+  bool add(const GpsFix &fix, unsigned long timestamp);
+
+  // Full, or the oldest entry has waited long enough
+  bool isDue(unsigned long now) const;
+
+  // Serialize queued fixes, oldest first, until the next one would not fit
+  // in capacity. Returns the payload length; included is set to the number
+  // of fixes serialized (0 if none fit).
+  size_t buildPayload(char *buffer, size_t capacity, size_t &included) const;
+
+  // Same, as a GPSB binary payload covering at most limit fixes
+  size_t buildBinaryPayload(uint8_t *buffer, size_t capacity, size_t limit,
+                            size_t &included) const;
+
+  // Drop the oldest n entries (after they were published)
+  void consume(size_t n);
+
+  size_t size() const { return count; }
+  const BatchEntry &at(size_t index) const { return entries[index]; }
+};
+
+#endif // FIX_BATCHER_H
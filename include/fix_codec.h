@@ -0,0 +1,47 @@
+#ifndef FIX_CODEC_H
+#define FIX_CODEC_H
+
+#include "gps_fix.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact binary encoding of a batch of fixes ("GPSB", see
+// docs/BINARY_FORMAT.md). Fixed-point fields, LEB128 varints, every fix
+// delta-coded against the previous one (the first against zero).
+
+#define FIX_CODEC_VERSION 1
+#define FIX_CODEC_MAX_HEADER 16 // Version byte + three 5-byte varints
+#define FIX_CODEC_MAX_RECORD 48 // Seven varints, worst case
+
+class FixEncoder {
+private:
+  uint8_t *buffer;
+  size_t capacity;
+  size_t bodyLength; // Bytes of fix records after the header gap
+  size_t fixCount;
+
+  unsigned long baseTimestamp;
+  uint32_t baseUtc;
+
+  unsigned long prevTimestamp;
+  int32_t prevLatitude;
+  int32_t prevLongitude;
+  int32_t prevAltitude;
+  int32_t prevSpeed;
+  int32_t prevCourse;
+  int32_t prevSatellites;
+
+public:
+  // Records are written after a header gap; finish() closes it up
+  FixEncoder(uint8_t *buffer, size_t capacity);
+
+  // Append a fix sampled at timestamp (millis()); false if it does not fit
+  bool add(const GpsFix &fix, unsigned long timestamp);
+
+  // Write the header and return the payload length (0 if empty)
+  size_t finish();
+
+  size_t count() const { return fixCount; }
+};
+
+#endif // FIX_CODEC_H
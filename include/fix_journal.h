@@ -0,0 +1,103 @@
+#ifndef FIX_JOURNAL_H
+#define FIX_JOURNAL_H
+
+#include "config.h"
+#include "gps_fix.h"
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define JOURNAL_MAGIC 0xA5
+#define JOURNAL_STATE_PENDING 0xFF // Erased flash
+#define JOURNAL_STATE_SENT 0x00    // Cleared in place once delivered
+
+// Fixed-size journal record, 32 bytes, little endian on flash
+struct JournalRecord {
+  uint8_t magic;
+  uint8_t state;
+  uint16_t crc;         // CRC-16/CCITT over bytes 4..31
+  uint32_t sequence;    // Increases by one per record, never reused
+  int32_t latitudeE7;   // 1e-7 degrees
+  int32_t longitudeE7;  // 1e-7 degrees
+  int32_t altitudeDm;   // Decimeters
+  uint16_t speedCkmh;   // 0.01 km/h
+  uint16_t courseCdeg;  // 0.01 degrees
+  uint32_t utcSeconds;  // Since 2000-01-01 00:00 UTC, 0 if unknown
+  uint8_t satellites;
+  uint8_t reserved[3];
+};
+
+static_assert(sizeof(JournalRecord) == 32, "JournalRecord must be 32 bytes");
+
+// Journal position, kept in RTC memory across deep sleep so that waking up
+// does not cost a scan of the whole partition
+struct JournalCursor {
+  uint32_t headIndex;
+  uint32_t tailIndex;
+  uint32_t nextSequence;
+  uint32_t pending;
+  uint32_t overwritten;
+};
+
+// Store-and-forward journal of fixes in a raw flash partition.
+//
+// Records are appended round-robin through the whole partition, so every
+// sector is erased equally often. A sector is erased just before the head
+// enters it; if that sector still holds undelivered records (journal full)
+// the oldest ones are lost. Delivered records are marked by clearing their
+// state byte in place, so no erase is needed to advance the tail. begin()
+// rebuilds head and tail by scanning the partition after a reboot, or
+// checks a cursor saved before deep sleep against the records it names.
+class FixJournal {
+private:
+  const esp_partition_t *partition;
+  uint32_t capacity;     // Records in the partition
+  uint32_t headIndex;    // Slot for the next append
+  uint32_t tailIndex;    // Oldest undelivered record
+  uint32_t nextSequence; // Sequence number of the next append
+  uint32_t pending;      // Undelivered records
+  uint32_t overwritten;  // Undelivered records lost to wrap-around
+
+  bool readRecord(uint32_t index, JournalRecord &record);
+  bool isValid(const JournalRecord &record);
+  void advanceTail();
+  bool open(const char *label);
+  bool scan();
+  bool resume(const JournalCursor &cursor);
+
+public:
+  FixJournal();
+
+  // Find the partition and recover the journal position
+  bool begin(const char *label = JOURNAL_PARTITION_LABEL);
+
+  // As begin(), starting from a saved cursor; scans if it does not match
+  bool begin(const JournalCursor &cursor,
+             const char *label = JOURNAL_PARTITION_LABEL);
+
+  JournalCursor getCursor() const;
+
+  // Append a fix; returns false on flash errors
+  bool append(const GpsFix &fix);
+
+  // Oldest undelivered record
+  bool peek(JournalRecord &record);
+
+  // Undelivered record with this sequence number, for sending several
+  // records before the oldest one is confirmed
+  bool peek(uint32_t sequence, JournalRecord &record);
+
+  // Mark the record returned by peek() as delivered
+  bool markSent(const JournalRecord &record);
+
+  uint32_t getPending() const { return pending; }
+  uint32_t getCapacity() const { return capacity; }
+  uint32_t getOverwritten() const { return overwritten; }
+  bool isReady() const { return partition != nullptr; }
+
+  // Convert a stored record back to a GpsFix (location, motion, time)
+  static void toFix(const JournalRecord &record, GpsFix &fix);
+};
+
+#endif // FIX_JOURNAL_H
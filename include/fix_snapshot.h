@@ -0,0 +1,42 @@
+#ifndef FIX_SNAPSHOT_H
+#define FIX_SNAPSHOT_H
+
+#include "gps_fix.h"
+#include <atomic>
+
+// Single-producer/single-consumer handoff of the latest GpsFix between the
+// GPS ingest task and the network loop. Two slots behind a sequence counter
+// (odd while a write is in progress): the writer always fills the slot the
+// reader is not using, so neither side ever waits on the other. A reader
+// only retries if the writer lapped it twice during one copy.
+class FixSnapshot {
+private:
+  GpsFix slots[2];
+  std::atomic<uint32_t> sequence;
+
+public:
+  FixSnapshot() : slots(), sequence(0) {}
+
+  // Producer side (GPS task)
+  void publish(const GpsFix &fix) {
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slots[((seq >> 1) + 1) & 1] = fix;
+    sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  // Consumer side (network loop); returns the number of fixes published
+  uint32_t read(GpsFix &out) const {
+    for (;;) {
+      uint32_t begin = sequence.load(std::memory_order_acquire) & ~1u;
+      out = slots[(begin >> 1) & 1];
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint32_t end = sequence.load(std::memory_order_relaxed);
+      if (end - begin < 3)
+        return begin >> 1;
+    }
+  }
+};
+
+#endif // FIX_SNAPSHOT_H
@@ -0,0 +1,27 @@
+#ifndef GEO_H
+#define GEO_H
+
+#include <math.h>
+
+// Small-distance geometry for track decisions. Equirectangular projection:
+// well under 0.1% error over the few kilometres between reports.
+
+#define GEO_EARTH_RADIUS_M 6371000.0
+#define GEO_DEG_TO_RAD (M_PI / 180.0)
+
+// Meters between two points given in degrees
+inline double geoDistanceMeters(double lat1, double lon1, double lat2,
+                                double lon2) {
+  double x = (lon2 - lon1) * GEO_DEG_TO_RAD *
+             cos((lat1 + lat2) * 0.5 * GEO_DEG_TO_RAD);
+  double y = (lat2 - lat1) * GEO_DEG_TO_RAD;
+  return sqrt(x * x + y * y) * GEO_EARTH_RADIUS_M;
+}
+
+// Smallest angle between two headings, 0..180 degrees
+inline double geoHeadingDelta(double from, double to) {
+  double delta = fmod(fabs(to - from), 360.0);
+  return delta > 180.0 ? 360.0 - delta : delta;
+}
+
+#endif // GEO_H
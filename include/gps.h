@@ -2,16 +2,88 @@
 #define GPS_H
 
 #include "config.h"
+#include "gps_fix.h"
+#include "receiver_config.h"
+#include "ubx.h"
+#include "ubx_parser.h"
 #include <Arduino.h>
+#include <atomic>
+
+#if GPS_BULK_INGEST
+#include "nmea_parser.h"
+#else
 #include <TinyGPSPlus.h>
+#endif
+
+enum GpsPowerState : uint8_t {
+  GPS_POWER_TRACKING,  // Continuous or cyclic tracking
+  GPS_POWER_BACKUP,    // RXM-PMREQ backup: no output until woken
+  GPS_POWER_ACQUIRING, // Woken, waiting for the first fix (hot start)
+};
+
+const char *gpsPowerStateName(GpsPowerState state);
 
 class GPSModule {
 private:
+#if GPS_BULK_INGEST
+  NmeaParser nmea;
+#else
   TinyGPSPlus gps;
+
+  // Copy TinyGPSPlus state into fix
+  void syncFix();
+#endif
+  UbxParser ubx; // UBX NAV data in UBX mode, CFG acknowledgements always
+  GpsFix fix;
   HardwareSerial *gpsSerial;
   bool isInitialized;
 
   unsigned long lastValidDataTime;
+  unsigned long baudRate; // Current gpsSerial and receiver rate
+  bool ubxActive;         // Receiver configured for UBX-only output
+
+  // Runtime configuration handed over from another thread
+  enum ConfigRequest : uint8_t {
+    CONFIG_IDLE,
+    CONFIG_REQUESTED, // requestedConfig waits for update()
+    CONFIG_APPLIED,
+    CONFIG_FAILED,
+  };
+  std::atomic<uint8_t> configRequest;
+  ReceiverConfig requestedConfig;
+
+  // Power management: the network loop sets the deadline, update() acts
+  std::atomic<unsigned long> fixDeadline; // 0: keep tracking
+  std::atomic<uint8_t> powerState;        // GpsPowerState
+  unsigned long wakeAt;                   // Planned end of backup
+  unsigned long wokeAt;                   // Start of the current wake-up
+  unsigned long wakeToFixMs;              // Last wake-up to fix time
+  unsigned long backupCount;
+
+  // Enter or leave backup as the fix deadline requires
+  void managePower(unsigned long now);
+
+  // RXM-PMREQ: backup for durationMs, after which the receiver restarts
+  void enterBackup(unsigned long durationMs);
+
+  // Any UART activity wakes the receiver from backup early
+  void wakeUp(unsigned long now);
+
+  // Wait for the receiver's answer to CFG message id; true on ACK-ACK
+  bool waitAck(uint8_t id);
+
+  // CFG-MSG: output rate of a message on the host port (0 = off)
+  bool setMessageRate(uint8_t messageClass, uint8_t id, uint8_t rate);
+
+  // UBX CFG-PRT for the receiver's host UART; outProtocols is a
+  // UBX_PROTO_* mask
+  void sendPortConfig(unsigned long baud,
+                      uint16_t outProtocols = UBX_PROTO_UBX | UBX_PROTO_NMEA);
+
+  // Read gpsSerial for up to timeoutMs; true once a sentence with a valid
+  // checksum (or, in UBX mode, a valid UBX frame) arrives: the receiver
+  // talks at our baud rate
+  bool verifyBaud(unsigned long timeoutMs);
 
 public:
   GPSModule();
@@ -19,9 +91,75 @@ public:
   // Initialize GPS module with dedicated UART
   bool begin(HardwareSerial *serial);
 
+  // Move receiver and gpsSerial to baud, verify, and fall back to GPS_BAUD
+  // if the receiver goes quiet. Blocks up to a few seconds; call before the
+  // GPS task starts. Returns the rate in use.
+  unsigned long negotiateBaud(unsigned long baud);
+
+  unsigned long getBaudRate() const { return baudRate; }
+
+#if GPS_UBX_MODE
+  // Enable NAV-POSLLH/SOL/VELNED/TIMEUTC and turn NMEA output off. Every
+  // step must be acknowledged; otherwise NMEA is restored and parsed as
+  // before. Blocks up to a few seconds; call after negotiateBaud().
+  bool configureUbx();
+
+  const UbxParser &getUbxParser() const { return ubx; }
+#endif
+
+  bool isUbxActive() const { return ubxActive; }
+
+  // Set the measurement rate, dynamic model, NMEA message set and power
+  // save mode (GPS_POWER_SAVE). Stops at the first step the receiver does
+  // not acknowledge. Blocks for the ACK round trips; call before the GPS
+  // task starts, or use requestConfig().
+  bool applyConfig(const ReceiverConfig &config);
+
+  // Thread-safe: config is applied by the next update() while tracking; a
+  // receiver in backup is woken and gets it after the hot start. False
+  // while an earlier request is still pending.
+  bool requestConfig(const ReceiverConfig &config);
+
+  // True once per finished request; applied tells whether it took effect
+  bool takeConfigResult(bool &applied);
+
+  // CFG-RXM power save mode with cyclic tracking at the measurement rate
+  // (CFG-PM2), or continuous tracking. Blocks for the ACK round trips.
+  bool setPowerSave(bool enabled, uint16_t updatePeriodMs);
+
+  // AID-INI: approximate position (accuracy in m) and UTC time (0 if
+  // unknown) so a receiver that lost its state starts warm. Call before
+  // the GPS task starts.
+  void sendStartHint(double latitude, double longitude, double altitude,
+                     uint32_t positionAccuracyM, uint32_t utcSeconds,
+                     uint32_t timeAccuracyMs);
+
+  // Thread-safe. The next fix is needed by deadline (millis()): after the
+  // current fix the receiver may sleep in backup and hot start
+  // GPS_HOT_START_MS ahead of it. 0 keeps it tracking.
+  void requestFixBy(unsigned long deadline);
+
+  GpsPowerState getPowerState() const {
+    return (GpsPowerState)powerState.load(std::memory_order_relaxed);
+  }
+
+  // Thread-safe. In GPS_POWER_BACKUP: the millis() at which the receiver
+  // hot starts; false in any other state
+  bool getBackupEnd(unsigned long &end) const;
+
+  // How often update() needs to run in the current power state
+  unsigned long getPollInterval() const;
+
+  // Last backup wake-up to first fix, in ms (0 = none yet)
+  unsigned long getWakeToFixMs() const { return wakeToFixMs; }
+  unsigned long getBackupCount() const { return backupCount; }
+
   // Update GPS data (call frequently in loop)
   void update();
 
+  // Latest decoded state (only valid on the thread calling update())
+  const GpsFix &getFix() const { return fix; }
+
   // Check if GPS has valid location fix
   bool hasValidLocation();
 
@@ -43,11 +181,19 @@ public:
   // Get number of characters processed by GPS
   unsigned long getCharsProcessed();
 
-  // Get GPS date/time
-  String getDateTime();
+  // Sentences and UBX frames that failed their checksum, and bytes thrown
+  // away as line noise. Counters of the ingest side; a read from another
+  // task sees a recent value.
+  unsigned long getDroppedSentences();
+  unsigned long getDroppedBytes();
+
+  // Write "YYYY-MM-DD hh:mm:ss" (or "Invalid") into buffer; returns the
+  // length, 0 if it did not fit
+  size_t getDateTime(char *buffer, size_t capacity);
 
-  // Get location as JSON string
-  String getLocationJSON();
+  // Write the location as a JSON object into buffer; returns the length,
+  // 0 if it did not fit
+  size_t getLocationJSON(char *buffer, size_t capacity);
 
   // Check if GPS module is responding
   bool isReady();
@@ -0,0 +1,50 @@
+#ifndef GPS_FIX_H
+#define GPS_FIX_H
+
+#include "config.h"
+#include <stdint.h>
+
+// Decoded receiver state, independent of the protocol it was parsed from.
+// Value-initialize (GpsFix fix = {}) to start with everything invalid.
+struct GpsFix {
+  double latitude;  // Degrees, north positive
+  double longitude; // Degrees, east positive
+  double altitude;  // Meters above mean sea level
+  double speedKmph; // Ground speed in km/h
+  double courseDeg; // Course over ground, degrees true
+  double hdop;      // Horizontal dilution of precision
+  uint8_t satellites;
+
+  uint16_t year;
+  uint8_t month;
+  uint8_t day;
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  uint8_t centisecond;
+
+  bool locationValid;
+  bool altitudeValid;
+  bool speedValid;
+  bool courseValid;
+  bool satellitesValid;
+  bool hdopValid;
+  bool dateValid;
+  bool timeValid;
+
+  unsigned long locationMillis; // millis() when the location last updated
+  unsigned long charsProcessed; // UART bytes consumed by the parser so far
+
+  // Seconds since 2000-01-01 00:00 UTC, or 0 without a valid date/time
+  uint32_t utcSeconds() const;
+
+  // Set date and time from seconds since 2000-01-01 00:00 UTC
+  void setUtcSeconds(uint32_t seconds);
+
+  // Location present and no older than GPS_DATA_MAX_AGE_MS
+  bool hasLocation(unsigned long now) const {
+    return locationValid && now - locationMillis < GPS_DATA_MAX_AGE_MS;
+  }
+};
+
+#endif // GPS_FIX_H
@@ -0,0 +1,14 @@
+#ifndef GPS_TASK_H
+#define GPS_TASK_H
+
+#include "config.h"
+#include "fix_snapshot.h"
+#include "gps.h"
+
+// Start the GPS ingest task pinned to GPS_TASK_CORE. It runs
+// GPSModule::update() every GPS_TASK_DELAY_MS, publishes the fix into
+// snapshot and feeds the task watchdog. Returns false when no task could be
+// started (including on the host build); the caller then ingests inline.
+bool startGPSTask(GPSModule *gps, FixSnapshot *snapshot);
+
+#endif // GPS_TASK_H
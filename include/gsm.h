@@ -3,54 +3,203 @@
 
 #include <Arduino.h>
 #define TINY_GSM_MODEM_SIM800
+#include "at_engine.h"
 #include "config.h"
+#include "modem_health.h"
 #include <TinyGsmClient.h>
 
+// Bring-up progress, in order. poll() moves through these one AT exchange
+// at a time; GSM_READY means the data bearer is up for TinyGsmClient.
+enum GsmState : uint8_t {
+  GSM_OFF,         // begin() not called
+  GSM_RESUMING,    // Warm start: is the modem still registered and attached?
+  GSM_RESETTING,   // Reset pin held low
+  GSM_BOOTING,     // Waiting for the modem firmware to start
+  GSM_PROBING,     // AT until it answers
+  GSM_SWITCHING_BAUD, // AT+IPR, then AT at GSM_BAUD_FAST
+  GSM_CONFIGURING, // Echo off, registration/signal URCs on
+  GSM_SIM_CHECK,   // +CPIN?
+  GSM_SIGNAL_CHECK, // +CSQ
+  GSM_REGISTERING, // +CREG? until home or roaming
+  GSM_ATTACHING,   // CIPSHUT, CGATT, socket options, CSTT, CIICR, CIFSR
+  GSM_READY,
+  GSM_FAILED, // Backing off before the next attempt
+};
+
+// Why the last attempt failed
+enum GsmError : uint8_t {
+  GSM_ERROR_NONE,
+  GSM_ERROR_NO_MODEM,     // No answer to AT
+  GSM_ERROR_NO_SIM,       // SIM missing or locked
+  GSM_ERROR_NO_SIGNAL,    // +CSQ 0 or 99 (antenna)
+  GSM_ERROR_DENIED,       // Registration denied
+  GSM_ERROR_REGISTRATION, // Not registered within GSM_TIMEOUT
+  GSM_ERROR_ATTACH,       // GPRS attach or bearer setup failed
+  GSM_ERROR_LINK_LOST,    // Was ready; URC or status query says down
+};
+
+// TinyGsmClient that can be told the modem holds data for it. TinyGSM learns
+// that from the "+CIPRXGET: 1,<mux>" notice, but AtEngine reads the UART
+// first, so GSMModule passes the notice on.
+class GsmDataClient : public TinyGsmClient {
+public:
+  explicit GsmDataClient(TinyGsm &modem) : TinyGsmClient(modem) {}
+
+  // The next available() asks the modem instead of waiting for its own poll
+  void notifyData() { got_data = true; }
+};
+
+const char *gsmStateName(GsmState state);
+const char *gsmErrorName(GsmError error);
+
 class GSMModule {
 private:
   TinyGsm *modem;
-  TinyGsmClient *client;
+  GsmDataClient *client;
   HardwareSerial *gsmSerial;
   bool isInitialized;
-  bool isConnected;
 
-  unsigned long lastConnectionAttempt;
+  // Bring-up state machine (see poll())
+  AtEngine at;
+  GsmState state;
+  GsmError lastError;
+  unsigned long stateSince;
+  unsigned long nextActionAt; // Earliest time for the next command
+  bool commandSent;
+  AtResult exchangeResult;
+  uint8_t step; // Command index within the current state
+  uint8_t consecutiveFailures;
+  unsigned long retryInterval;
+  char command[AT_COMMAND_MAX];
+  char reply[AT_RESPONSE_MAX]; // Response of the last bring-up exchange
+  unsigned long baudRate;      // Current gsmSerial and modem rate
+  bool baudFallback;           // Fast rate failed once; stay at GSM_BAUD
+
+  // Link health, kept current by URCs and background status queries
+  ModemHealth health;
+  bool statusQueryPending;
+  uint8_t statusTimeouts;
+  unsigned long lastStatusQuery;
+  bool linkLost;     // Set from callbacks, acted on in poll()
+  bool socketClosed; // Modem reported CLOSED for the socket
+  bool dataPending;  // Modem reported +CIPRXGET: 1; the MQTT loop reads it
+
+  // Modem sleep (AT+CSCLK=2), entered and left in GSM_READY
+  bool sleepRequested;
+  bool modemAsleep; // CSCLK=2 acknowledged; wake before using the UART
+
+  void enter(GsmState next);
+  void fail(GsmError error);
+  // Queue cmd on the first call, then check it; true once it completed
+  bool exchange(const char *cmd, unsigned long timeout, AtResult &result,
+                const char *finalLine = nullptr);
+  static void onExchange(void *context, AtResult result, const char *response);
+  void pollResume(unsigned long now);
+  void pollProbe(unsigned long now);
+  void pollBaudSwitch(unsigned long now);
+  void pollConfigure();
+  void pollSimCheck(unsigned long now);
+  void pollSignalCheck(unsigned long now);
+  void pollRegistration(unsigned long now);
+  void pollAttach(unsigned long now);
+  void pollSleep();
+
+  // Status query replies (one pipelined command line)
+  static void onSignalReply(void *context, AtResult result,
+                            const char *response);
+  static void onRegistrationReply(void *context, AtResult result,
+                                  const char *response);
+  static void onAttachReply(void *context, AtResult result,
+                            const char *response);
+
+  // Unsolicited result codes
+  static void onRegistrationUrc(void *context, const char *line);
+  static void onSignalUrc(void *context, const char *line);
+  static void onBearerUrc(void *context, const char *line);
+  static void onSocketClosedUrc(void *context, const char *line);
+  static void onDataUrc(void *context, const char *line);
+  static void onModemRestartUrc(void *context, const char *line);
+  void updateSignal(int quality);
+  void updateRegistration(int status);
+  void updateAttach(bool attached);
 
 public:
   GSMModule();
   ~GSMModule();
 
-  // Initialize GSM module with dedicated UART
-  bool begin(HardwareSerial *serial);
+  // Set up the modem driver on its UART and start bring-up (non-blocking).
+  // warm: only the ESP32 restarted and the modem kept running, so check
+  // its registration and bearer before falling back to a hardware reset.
+  bool begin(HardwareSerial *serial, bool warm = false);
+
+  // Advance bring-up by at most one AT exchange; call every loop()
+  GsmState poll();
 
-  // Hardware reset using reset pin
+  // Start a hardware reset (non-blocking; poll() finishes it)
   void hardwareReset();
 
-  // Connect to GPRS network
+  // Start bring-up if it is idle; true if the bearer is already up
   bool connectGPRS();
 
   // Disconnect from GPRS
   void disconnectGPRS();
 
-  // Check if connected to GPRS
+  // Check if connected to GPRS (from URCs and status queries; no modem
+  // traffic)
   bool isGPRSConnected();
 
-  // Get signal quality (0-31, 99=unknown)
-  int getSignalQuality();
+  // Bring-up finished and not known to be lost; no modem traffic
+  bool isReady() const { return state == GSM_READY; }
+
+  // Ready, awake and no AT command in flight: TinyGsm may use the UART
+  bool isLinkFree() const {
+    return state == GSM_READY && !at.isBusy() && !modemAsleep &&
+           !sleepRequested;
+  }
+
+  // Let the modem sleep whenever its UART is idle (AT+CSCLK=2), or wake it
+  // and turn that off again. poll() does the exchanges while ready; the
+  // link is not free until the modem is awake and asked to stay so.
+  void setSleep(bool sleep) { sleepRequested = sleep; }
+  bool isAsleep() const { return modemAsleep; }
+
+  // Queue +CSQ, +CREG? and +CGATT? as one pipelined command line; poll()
+  // does this every GSM_STATUS_QUERY_MS while ready
+  void queryStatus();
+
+  GsmState getState() const { return state; }
+  unsigned long getBaudRate() const { return baudRate; }
+  GsmError getLastError() const { return lastError; }
+
+  // Last known link state; free to read, no modem traffic
+  const ModemHealth &getHealth() const { return health; }
+
+  // Get signal quality (0-31, 99=unknown), as last reported by the modem
+  int getSignalQuality() const { return health.signalQuality; }
+
+  // The socket owner (MQTT) reports opens and closes here
+  void setSocketOpen(bool open);
 
   // Get TinyGsmClient for MQTT/HTTP
   TinyGsmClient *getClient();
 
+  // The modem has socket data waiting; the socket owner should read soon
+  bool hasDataPending() const { return dataPending; }
+
+  // Hand a pending data notice to the client so its next read fetches the
+  // data at once. False if there was none.
+  bool takeDataNotice();
+
   // Send HTTP POST request (for API)
   bool sendHTTPPost(const char *url, const char *data);
 
-  // Check if modem is responding
-  bool isModemReady();
+  // Check if modem is responding (answered during the current bring-up)
+  bool isModemReady() const;
 
   // Check antenna connection and signal quality
   bool checkAntennaConnection();
 
-  // Restart modem
+  // Restart modem (hardware reset and full bring-up, non-blocking)
   void restart();
 };
 
@@ -0,0 +1,73 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Builds JSON into a caller-supplied buffer with no heap allocation.
+// Commas between members are inserted automatically. Output that does not
+// fit sets a sticky overflow flag; the buffer always stays NUL-terminated.
+class JsonWriter {
+public:
+  // Saved position for rolling back a partly written element
+  struct Mark {
+    size_t length;
+    bool needComma;
+  };
+
+private:
+  char *buffer;
+  size_t capacity;
+  size_t length;
+  bool needComma;
+  bool overflow;
+
+  void put(char c);
+  void put(const char *text, size_t n);
+  void separator();
+  void quoted(const char *text);
+
+public:
+  JsonWriter(char *buffer, size_t capacity);
+
+  void beginObject();
+  void endObject();
+  void beginArray();
+  void endArray();
+
+  // Object member name; the next value call supplies its value
+  void key(const char *name);
+
+  void value(const char *text); // Escaped string
+  void value(bool b);
+  void value(long n);
+  void value(unsigned long n);
+  void value(int n) { value((long)n); }
+  void value(unsigned int n) { value((unsigned long)n); }
+  void value(double v, uint8_t decimals); // Fixed point, like "%.*f"
+  void null();
+
+  // key + value shorthands
+  template <typename T> void field(const char *name, T v) {
+    key(name);
+    value(v);
+  }
+  void field(const char *name, double v, uint8_t decimals) {
+    key(name);
+    value(v, decimals);
+  }
+
+  Mark mark() const { return {length, needComma}; }
+  void rewind(const Mark &m);
+
+  bool ok() const { return !overflow; }
+  size_t size() const { return length; }
+  const char *c_str() const { return buffer; }
+};
+
+// Append v with the given decimals (max 9) to out; returns the characters
+// written, or 0 if they would not fit in room. Non-finite values are not
+// handled here.
+size_t formatFixed(char *out, size_t room, double v, uint8_t decimals);
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,88 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "config.h"
+#include <Arduino.h>
+#include <atomic>
+#include <stdint.h>
+
+#define METRIC_SUB_BUCKETS 4 // Per power of two: bucket width under 25 %
+#define METRIC_OCTAVES 25    // Up to 2^26 us (67 s); longer goes in the last
+#define METRIC_BUCKETS (METRIC_SUB_BUCKETS * METRIC_OCTAVES)
+
+// Timed stages of the hot path
+enum MetricStage : uint8_t {
+  METRIC_GPS_UPDATE,     // GPSModule::update(): UART drain and parse
+  METRIC_JSON_BUILD,     // Location payload encoding
+  METRIC_PUBLISH,        // Location publish (outbox and socket write)
+  METRIC_MQTT_LOOP,      // MQTTClientModule::loop()
+  METRIC_AT_COMMAND,     // AT command line, written to final result code
+  METRIC_FIX_TO_PUBLISH, // Location decoded to its message accepted
+  METRIC_STAGE_COUNT,
+};
+
+// Events counted since boot
+enum MetricCounter : uint8_t {
+  METRIC_GPS_UART_OVERRUN, // RX FIFO or buffer full, bytes lost
+  METRIC_GSM_UART_OVERRUN,
+  METRIC_COUNTER_COUNT,
+};
+
+const char *metricStageName(MetricStage stage);
+
+struct LatencySummary {
+  uint32_t count;
+  uint32_t p50Us;
+  uint32_t p99Us;
+  uint32_t maxUs;
+};
+
+// Latencies in fixed log-linear buckets: METRIC_SUB_BUCKETS per power of
+// two microseconds, 400 bytes and no allocation. record() is lock-free and
+// may be called from any task; one reader calls summarize().
+class LatencyHistogram {
+private:
+  std::atomic<uint32_t> buckets[METRIC_BUCKETS];
+  std::atomic<uint32_t> maxUs;
+
+  static uint8_t bucketOf(uint32_t us);
+  static uint32_t bucketLimit(uint8_t index); // Largest value it holds
+
+public:
+  LatencyHistogram();
+
+  void record(uint32_t us);
+
+  // Percentiles are bucket upper bounds (never above the max); reset
+  // starts the next window
+  LatencySummary summarize(bool reset);
+};
+
+// Process-wide histograms and counters, so that modules need no wiring
+void metricRecord(MetricStage stage, uint32_t us);
+void metricRecordCycles(MetricStage stage, uint32_t cycles);
+void metricCount(MetricCounter counter);
+uint32_t metricCounterValue(MetricCounter counter);
+LatencySummary metricSummary(MetricStage stage, bool reset);
+
+// Times the enclosing scope with the CPU cycle counter. Only for stages that
+// stay on one core and finish within a counter wrap (about 17 s at 240 MHz).
+class StageTimer {
+#if METRICS_ENABLED
+private:
+  MetricStage stage;
+  uint32_t start;
+
+public:
+  explicit StageTimer(MetricStage stage)
+      : stage(stage), start(ESP.getCycleCount()) {}
+  ~StageTimer() { metricRecordCycles(stage, ESP.getCycleCount() - start); }
+#else
+public:
+  explicit StageTimer(MetricStage stage) { (void)stage; }
+#endif
+  StageTimer(const StageTimer &) = delete;
+  StageTimer &operator=(const StageTimer &) = delete;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,36 @@
+#ifndef MODEM_HEALTH_H
+#define MODEM_HEALTH_H
+
+#include <stdint.h>
+
+// Last known link state of the modem. GSMModule keeps it current from URCs,
+// bring-up replies and the periodic status query; readers never touch the
+// UART. Each field carries the millis() of its last update (0 = never).
+struct ModemHealth {
+  int signalQuality; // +CSQ 0-31, 99 = unknown
+  unsigned long signalMillis;
+
+  int registration; // +CREG stat: 0 idle, 1 home, 2 searching, 3 denied,
+                    // 5 roaming
+  unsigned long registrationMillis;
+
+  bool gprsAttached; // +CGATT and a bearer with an IP address
+  unsigned long gprsMillis;
+
+  bool socketOpen; // The MQTT TCP socket, as its owner and the modem report
+  unsigned long socketMillis;
+
+  bool isRegistered() const { return registration == 1 || registration == 5; }
+
+  // +CSQ to dBm (-113 dBm at 0, 2 dB steps); 0 when unknown
+  int rssiDbm() const {
+    return signalQuality == 99 ? 0 : -113 + 2 * signalQuality;
+  }
+
+  // Age in ms of a field timestamp; (unsigned long)-1 if never set
+  static unsigned long age(unsigned long stamp, unsigned long now) {
+    return stamp ? now - stamp : (unsigned long)-1;
+  }
+};
+
+#endif // MODEM_HEALTH_H
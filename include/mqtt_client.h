@@ -3,9 +3,24 @@
 
 #include "config.h"
 #include "gsm.h"
+#include "mqtt_outbox.h"
+#include "mqtt_wire_tap.h"
 #include <Arduino.h>
 #include <PubSubClient.h>
 
+// What a status message reports. A queued status of a kind other than
+// MQTT_STATUS_OTHER is replaced by a newer one of the same kind.
+enum MqttStatusKind : uint8_t {
+  MQTT_STATUS_OTHER,      // Every message is sent
+  MQTT_STATUS_CONNECTION, // "connected"
+  MQTT_STATUS_GPS_FIX,    // "waiting_for_fix"
+  MQTT_STATUS_GPS_CONFIG, // Receiver command results
+};
+
+// Called from loop() with each message on MQTT_TOPIC_COMMAND
+typedef void (*MqttCommandHandler)(void *context, const char *payload,
+                                   size_t length);
+
 class MQTTClientModule {
 private:
   PubSubClient *mqttClient;
@@ -14,6 +29,21 @@ private:
   unsigned long lastReconnectAttempt;
   unsigned long reconnectInterval; // Current backoff interval
   int reconnectAttempts;           // Track consecutive failures
+  unsigned long firstConnectTime;  // millis(), 0 until connected once
+
+  MqttWireTap wireTap; // PubSubClient's socket, observed for PUBACKs
+  MqttOutbox outbox;   // Every PUBLISH except the last one in disconnect()
+
+  // Queue a payload and send what the link allows
+  bool publishData(const char *topic, const uint8_t *payload, size_t length,
+                   MqttPriority priority, uint8_t qos, uint8_t key = 0,
+                   uint32_t tag = 0);
+
+  MqttCommandHandler commandHandler;
+  void *commandContext;
+
+  // PubSubClient callbacks carry no context; there is one client
+  static MQTTClientModule *instance;
 
   // MQTT callback for incoming messages
   static void messageCallback(char *topic, byte *payload, unsigned int length);
@@ -31,21 +61,63 @@ public:
   // Disconnect from MQTT broker
   void disconnect();
 
-  // Check if connected to MQTT broker
+  // Check if connected to MQTT broker (cached; no modem traffic)
   bool isConnectedToBroker();
 
-  // Publish GPS location data
-  bool publishLocation(const String &locationData);
+  // Publish GPS location data (payload is sent as-is, no copy). A
+  // non-zero tag goes to the delivered handler once the broker has it.
+  bool publishLocation(const char *payload, size_t length, uint32_t tag = 0);
+
+  // Publish a binary (GPSB) location payload
+  bool publishLocationBinary(const uint8_t *payload, unsigned int length);
+
+  // Publish a compressed JSON location payload (PayloadCompressor)
+  bool publishLocationCompressed(const uint8_t *payload, unsigned int length);
 
-  // Publish status message
-  bool publishStatus(const String &statusData);
+  // Publish status message (QoS 0, may be dropped on a slow link)
+  bool publishStatus(const char *payload, size_t length,
+                     MqttStatusKind kind = MQTT_STATUS_OTHER);
+
+  // Publish a metrics window on MQTT_TOPIC_STATUS (QoS 0, dropped first)
+  bool publishMetrics(const char *payload, size_t length);
+
+  // Publish on MQTT_TOPIC_ALARM (QoS 1, ahead of everything else)
+  bool publishAlarm(const char *payload, size_t length);
 
   // Subscribe to a topic
   bool subscribe(const char *topic);
 
-  // Process MQTT messages (call in loop)
+  // Subscribe to MQTT_TOPIC_COMMAND on every connect and pass its
+  // messages to handler
+  void onCommand(MqttCommandHandler handler, void *context);
+
+  // Report tagged messages as they are delivered (see MqttOutbox)
+  void onDelivered(MqttDeliveredHandler handler, void *context) {
+    outbox.onDelivered(handler, context);
+  }
+
+  // Process MQTT messages and QoS 1 acknowledgements (call in loop)
   void loop();
 
+  // Location messages the queue would take now
+  size_t getLocationRoom() const { return outbox.room(MQTT_PRIORITY_FIX); }
+
+  // Messages queued or not yet acknowledged
+  size_t getPendingCount() const { return outbox.pending(); }
+
+  // Messages of a class dropped by the queue since boot
+  unsigned long getDroppedCount(MqttPriority priority) const {
+    return outbox.getDropped(priority);
+  }
+
+  // When the broker first accepted a connection since boot; 0 before
+  unsigned long getFirstConnectTime() const { return firstConnectTime; }
+
+  // Client side of the broker session (MQTT_CLEAN_SESSION false), saved
+  // before deep sleep and restored after it
+  uint16_t getNextPacketId() const;
+  void resumeSession(uint16_t nextPacketId);
+
   // Attempt to reconnect if disconnected
   bool reconnect();
 };
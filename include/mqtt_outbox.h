@@ -0,0 +1,134 @@
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include "config.h"
+#include "mqtt_wire_tap.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest QoS 1 PUBLISH: PubSubClient's buffer plus the packet identifier
+#define MQTT_OUTBOX_PACKET_SIZE (MQTT_BUFFER_SIZE + 2)
+
+// Outbound classes, most valuable first
+enum MqttPriority : uint8_t {
+  MQTT_PRIORITY_ALARM,   // May use the slots kept free for it
+  MQTT_PRIORITY_FIX,     // Never dropped once queued
+  MQTT_PRIORITY_STATUS,  // Superseded ones replaced, stale ones dropped
+  MQTT_PRIORITY_METRICS, // First to be dropped
+  MQTT_PRIORITY_COUNT,
+};
+
+const char *mqttPriorityName(MqttPriority priority);
+
+// Called from service() when a message queued with a non-zero tag has
+// been delivered: PUBACK received at QoS 1, written at QoS 0. It must not
+// queue messages itself.
+typedef void (*MqttDeliveredHandler)(void *context, uint32_t tag);
+
+// Every outbound PUBLISH, in one bounded queue. Messages are serialized
+// once into a slot. The next one sent is always the oldest of the most
+// valuable class queued, so under congestion status and metrics wait
+// behind fixes, and nothing overtakes a QoS 1 message held back by a full
+// in-flight window.
+//
+// QoS 0 messages leave their slot once written. QoS 1 messages stay until
+// their PUBACK arrives. Up to MQTT_INFLIGHT_WINDOW are on the wire at a
+// time, so throughput is not limited to one message per GPRS round trip.
+// Unacknowledged messages are resent (DUP set, same packet identifier)
+// after MQTT_RETRY_INTERVAL_MS and after every reconnect; with
+// MQTT_CLEAN_SESSION false the broker keeps its side of the session.
+//
+// When the link is slow:
+// - a queued status with the same non-zero key is replaced, not added;
+// - status and metrics still queued after MQTT_STATUS_MAX_AGE_MS are
+//   dropped;
+// - a full queue makes room by dropping the oldest message of the least
+//   valuable class below the new one (metrics, then status);
+// - fixes and alarms are never dropped, so enqueue() fails instead and the
+//   caller keeps the fix (main.cpp journals it);
+// - MQTT_OUTBOX_ALARM_SLOTS slots are only ever given to alarms.
+class MqttOutbox {
+private:
+  enum SlotState : uint8_t { SLOT_FREE, SLOT_QUEUED, SLOT_IN_FLIGHT };
+
+  struct Slot {
+    uint8_t packet[MQTT_OUTBOX_PACKET_SIZE];
+    uint16_t length;
+    uint16_t packetId; // 0 at QoS 0
+    uint32_t order;    // Enqueue sequence, oldest first within a class
+    uint32_t tag;      // Passed to the delivered handler, 0 = none
+    unsigned long queuedAt;
+    unsigned long sentAt;
+    uint8_t attempts;
+    uint8_t key; // Coalescing key, 0 = none
+    MqttPriority priority;
+    SlotState state;
+  };
+
+  Slot slots[MQTT_OUTBOX_SLOTS];
+  MqttWireTap *tap;
+  uint16_t nextPacketId;
+  uint32_t nextOrder;
+  MqttDeliveredHandler deliveredHandler;
+  void *deliveredContext;
+
+  unsigned long acknowledged;
+  unsigned long retransmits;
+  unsigned long coalesced;
+  unsigned long dropped[MQTT_PRIORITY_COUNT];
+
+  Slot *findByPacketId(uint16_t packetId);
+  Slot *findQueued(MqttPriority priority, uint8_t key);
+  // A free slot for priority, dropping a less valuable message if needed
+  Slot *acquire(MqttPriority priority);
+  Slot *nextQueued();
+  void drop(Slot &slot);
+  void release(Slot &slot); // Delivered
+  bool send(Slot &slot, unsigned long now);
+
+public:
+  MqttOutbox();
+
+  void begin(MqttWireTap *wireTap) { tap = wireTap; }
+
+  void onDelivered(MqttDeliveredHandler handler, void *context) {
+    deliveredHandler = handler;
+    deliveredContext = context;
+  }
+
+  // Serialize and queue a PUBLISH at qos (0 or 1); false if there is no
+  // room for it or it is too large. A non-zero tag is reported to the
+  // delivered handler once the message is delivered.
+  bool enqueue(const char *topic, const uint8_t *payload, size_t length,
+               MqttPriority priority, uint8_t qos, uint8_t key,
+               unsigned long now, uint32_t tag = 0);
+
+  // Apply PUBACKs, drop stale status, send queued messages in priority
+  // order and resend stale ones. Call often while connected.
+  void service(unsigned long now);
+
+  // After a reconnect: everything unacknowledged goes out again
+  void requeueInFlight();
+
+  // Messages of this class enqueue() would take now, counting the less
+  // valuable ones it would drop to make room
+  size_t room(MqttPriority priority) const;
+
+  size_t pending() const;  // Queued + in flight
+  size_t inFlight() const;
+  unsigned long getAcknowledged() const { return acknowledged; }
+  unsigned long getRetransmits() const { return retransmits; }
+  unsigned long getCoalesced() const { return coalesced; }
+  unsigned long getDropped(MqttPriority priority) const {
+    return dropped[priority];
+  }
+
+  // Packet identifier of the next QoS 1 PUBLISH; carried across deep sleep
+  // so a resumed broker session never sees an identifier reused early
+  uint16_t getNextPacketId() const { return nextPacketId; }
+  void setNextPacketId(uint16_t packetId) {
+    nextPacketId = packetId ? packetId : 1;
+  }
+};
+
+#endif // MQTT_OUTBOX_H
@@ -0,0 +1,66 @@
+#ifndef MQTT_WIRE_TAP_H
+#define MQTT_WIRE_TAP_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+#define MQTT_TAP_ACK_QUEUE 16 // PUBACKs buffered between outbox services
+
+// Sits between PubSubClient and the modem socket. Everything is passed
+// through unchanged, but the inbound byte stream is framed on the side so
+// PUBACKs (which PubSubClient ignores) and the CONNACK session flag can be
+// picked up. Also lets the outbox write complete QoS 1 PUBLISH packets on
+// the same socket.
+class MqttWireTap : public Client {
+private:
+  enum FrameState : uint8_t { FRAME_HEADER, FRAME_LENGTH, FRAME_BODY };
+
+  Client *inner;
+
+  FrameState frameState;
+  uint8_t packetType;
+  uint32_t remaining;
+  uint32_t lengthMultiplier;
+  uint8_t body[2]; // First bytes of the variable header
+  uint8_t bodyCount;
+
+  uint16_t acks[MQTT_TAP_ACK_QUEUE];
+  uint8_t ackHead;
+  uint8_t ackCount;
+  unsigned long droppedAcks;
+
+  bool sessionPresent;
+
+  void observe(uint8_t byte);
+  void packetComplete();
+
+public:
+  MqttWireTap();
+
+  void attach(Client *client) { inner = client; }
+
+  // Next PUBACK packet identifier seen on the wire
+  bool takeAck(uint16_t &packetId);
+
+  // Session-present flag from the last CONNACK
+  bool wasSessionPresent() const { return sessionPresent; }
+
+  unsigned long getDroppedAcks() const { return droppedAcks; }
+
+  // Client interface, forwarded to the socket
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char *host, uint16_t port) override;
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t *buf, size_t size) override;
+  int peek() override;
+  void flush() override;
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override;
+  using Print::write;
+};
+
+#endif // MQTT_WIRE_TAP_H
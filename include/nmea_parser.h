@@ -0,0 +1,53 @@
+#ifndef NMEA_PARSER_H
+#define NMEA_PARSER_H
+
+#include "config.h"
+#include "gps_fix.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define NMEA_MAX_SENTENCE 96 // Spec limit is 82 characters incl. CR/LF
+
+// Bulk NMEA ingest. UART bytes are read straight into a fixed ring buffer;
+// process() splits complete sentences, drops every type except GGA, RMC
+// and VTG before touching their payload, checksums the rest while copying
+// them out of the ring and decodes them into a GpsFix. No heap use.
+class NmeaParser {
+private:
+  uint8_t ring[GPS_RING_BUFFER_SIZE];
+  size_t head;    // Next write position (monotonic, wrapped on access)
+  size_t tail;    // Start of the first unconsumed sentence
+  size_t scanned; // Everything before this has no line feed
+
+  char sentence[NMEA_MAX_SENTENCE];
+
+  unsigned long charsProcessed;
+  unsigned long sentencesParsed;
+  unsigned long sentencesIgnored;
+  unsigned long checksumFailures;
+  unsigned long droppedBytes;
+
+  void handleSentence(size_t start, size_t end, GpsFix &fix,
+                      unsigned long now);
+  bool decodeGGA(char **fields, int count, GpsFix &fix, unsigned long now);
+  bool decodeRMC(char **fields, int count, GpsFix &fix, unsigned long now);
+  bool decodeVTG(char **fields, int count, GpsFix &fix);
+
+public:
+  NmeaParser();
+
+  // Contiguous free space for a direct UART read; commit() what was read
+  uint8_t *writeSpace(size_t &length);
+  void commit(size_t length);
+
+  // Decode every complete sentence in the ring
+  void process(GpsFix &fix, unsigned long now);
+
+  unsigned long getCharsProcessed() const { return charsProcessed; }
+  unsigned long getSentencesParsed() const { return sentencesParsed; }
+  unsigned long getSentencesIgnored() const { return sentencesIgnored; }
+  unsigned long getChecksumFailures() const { return checksumFailures; }
+  unsigned long getDroppedBytes() const { return droppedBytes; }
+};
+
+#endif // NMEA_PARSER_H
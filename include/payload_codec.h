@@ -0,0 +1,61 @@
+#ifndef PAYLOAD_CODEC_H
+#define PAYLOAD_CODEC_H
+
+#include "config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Content-type marker: the first byte of every MQTT_TOPIC_GPS_Z payload
+// says how the rest is encoded (docs/COMPRESSED_FORMAT.md)
+enum PayloadEncoding : uint8_t {
+  PAYLOAD_STORED = 0x01,   // As is; compressing did not make it smaller
+  PAYLOAD_LZ = 0x02,       // LZ77, no dictionary
+  PAYLOAD_LZ_DICT1 = 0x03, // LZ77 primed with dictionary 1
+};
+
+#define PAYLOAD_CODEC_HEADER 1            // Marker byte
+#define PAYLOAD_CODEC_MAX_INPUT MQTT_BUFFER_SIZE
+#define PAYLOAD_CODEC_MAX_OFFSET 2048     // Farthest a match reaches back
+#define PAYLOAD_CODEC_HASH_BITS 9
+
+// Dictionary 1: the JSON FixBatcher writes. Changing it needs a new
+// marker, decoders keep every dictionary they have seen.
+extern const char PAYLOAD_DICT1[];
+extern const size_t PAYLOAD_DICT1_SIZE;
+
+#define PAYLOAD_CODEC_DICT_MAX 256 // Room reserved for a dictionary
+
+// Byte-aligned LZ77 for one location payload, in place of a streaming
+// library: a payload is at most MQTT_BUFFER_SIZE bytes and is already in
+// RAM when it is published. All working memory lives in the object
+// (sizeof(PayloadCompressor): 4866 bytes with the default MQTT_BUFFER_SIZE),
+// so keep it in a global, not on the loop() stack. Nothing is allocated.
+class PayloadCompressor {
+private:
+  uint8_t window[PAYLOAD_CODEC_DICT_MAX + PAYLOAD_CODEC_MAX_INPUT];
+  uint16_t head[1 << PAYLOAD_CODEC_HASH_BITS]; // Latest position + 1
+  uint16_t chain[PAYLOAD_CODEC_DICT_MAX + PAYLOAD_CODEC_MAX_INPUT];
+  uint8_t chainDepth; // Candidates tried per position
+  bool useDictionary;
+
+  void insert(size_t position);
+  size_t store(const uint8_t *input, size_t length, uint8_t *out,
+               size_t capacity) const;
+
+public:
+  PayloadCompressor(uint8_t depth = PAYLOAD_COMPRESS_CHAIN,
+                    bool dictionary = PAYLOAD_COMPRESS_DICTIONARY);
+
+  // Marker byte and the compressed input, or the input itself when that
+  // is not larger. Returns the payload length, 0 if it does not fit in
+  // capacity.
+  size_t compress(const uint8_t *input, size_t length, uint8_t *out,
+                  size_t capacity);
+};
+
+// Inverse of PayloadCompressor::compress(). Returns the decoded length, 0
+// for an unknown marker, a malformed stream or too little capacity.
+size_t payloadDecompress(const uint8_t *payload, size_t length, uint8_t *out,
+                         size_t capacity);
+
+#endif // PAYLOAD_CODEC_H
@@ -0,0 +1,66 @@
+#ifndef PUBLISH_SCHEDULER_H
+#define PUBLISH_SCHEDULER_H
+
+#include "config.h"
+#include "gps_fix.h"
+
+// Why a fix was chosen for reporting
+enum PublishReason {
+  PUBLISH_NONE,
+  PUBLISH_FIRST,     // First fix since boot
+  PUBLISH_INTERVAL,  // Fixed cadence, or max interval while moving
+  PUBLISH_DISTANCE,  // PUBLISH_DISTANCE_M since the last report
+  PUBLISH_HEADING,   // Course changed by PUBLISH_HEADING_DEG
+  PUBLISH_STARTED,   // Left the parked dead-band
+  PUBLISH_STOPPED,   // Slow for PUBLISH_STOP_DWELL_MS
+  PUBLISH_HEARTBEAT, // Parked keep-alive
+};
+
+const char *publishReasonName(PublishReason reason);
+
+// Decides which fixes are worth sending, per PUBLISH_POLICY. Feed it every
+// fresh fix; it remembers the last reported one.
+class PublishScheduler {
+private:
+  bool hasReport;
+  bool moving;
+  double lastLatitude;
+  double lastLongitude;
+  double lastCourse;
+  unsigned long lastReportTime;
+  unsigned long slowSince; // 0 while above PUBLISH_STATIONARY_KMH
+
+  PublishReason evaluate(const GpsFix &fix, unsigned long now);
+
+public:
+  PublishScheduler();
+
+  // Returns the trigger if this fix should be reported, and records it as
+  // the new reference; PUBLISH_NONE otherwise
+  PublishReason update(const GpsFix &fix, unsigned long now);
+
+  // A fix was reported by another stage (track simplifier)
+  void markReported(const GpsFix &fix, unsigned long now);
+
+  bool isMoving() const { return moving; }
+
+  // Has reported a fix and is not moving
+  bool isParked() const { return hasReport && !moving; }
+
+  // Last reported position and when (millis()); valid once a fix was
+  // reported
+  double getLastLatitude() const { return lastLatitude; }
+  double getLastLongitude() const { return lastLongitude; }
+  unsigned long getLastReportTime() const { return lastReportTime; }
+
+  // Continue parked at a position reported at reportTime, as before a deep
+  // sleep (reportTime may lie before this boot's millis() started)
+  void restoreParked(double latitude, double longitude,
+                     unsigned long reportTime);
+
+  // millis() by which the next report needs a fix (a parked heartbeat);
+  // 0 while any fix may trigger one
+  unsigned long nextFixDeadline() const;
+};
+
+#endif // PUBLISH_SCHEDULER_H
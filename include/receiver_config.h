@@ -0,0 +1,33 @@
+#ifndef RECEIVER_CONFIG_H
+#define RECEIVER_CONFIG_H
+
+#include "config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define RECEIVER_RATE_MIN_MS 200 // NEO-6M limit (5 Hz)
+// Slower fixes would age past GPS_DATA_MAX_AGE_MS between epochs
+#define RECEIVER_RATE_MAX_MS (GPS_DATA_MAX_AGE_MS / 2)
+
+// NEO-6M navigation settings the firmware controls
+struct ReceiverConfig {
+  uint16_t measurementRateMs; // CFG-RATE measurement period
+  uint8_t dynamicModel;       // GPS_MODEL_* (CFG-NAV5)
+  bool minimalMessages;       // NMEA: only GGA and RMC
+
+  // Boot settings from config.h
+  static ReceiverConfig defaults();
+};
+
+// "automotive" for GPS_MODEL_AUTOMOTIVE; nullptr for other models
+const char *receiverModelName(uint8_t model);
+
+// Apply a command received on MQTT_TOPIC_COMMAND to config. The payload is
+// a flat JSON object; members that are absent keep their value:
+//   {"gps_rate_ms":200,"gps_model":"pedestrian","gps_messages":"minimal"}
+// Returns false, with config untouched, if no member is present or a value
+// is out of range or unknown.
+bool parseReceiverCommand(const char *payload, size_t length,
+                          ReceiverConfig &config);
+
+#endif // RECEIVER_CONFIG_H
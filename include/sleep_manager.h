@@ -0,0 +1,121 @@
+#ifndef SLEEP_MANAGER_H
+#define SLEEP_MANAGER_H
+
+#include "config.h"
+#include "fix_journal.h"
+#include "gps_fix.h"
+#include <Arduino.h>
+#include <stdint.h>
+
+#define RETAINED_STATE_MAGIC 0x534C5031 // "SLP1"
+
+enum SleepMode : uint8_t {
+  SLEEP_NONE,
+  SLEEP_LIGHT, // CPU paused; RAM, tasks and the MQTT session survive
+  SLEEP_DEEP,  // Firmware restarts; RetainedState carries what is needed
+};
+
+const char *sleepModeName(SleepMode mode);
+
+// What one boot hands to the next, in RTC slow memory. It survives deep
+// sleep and software, panic and watchdog resets; power-up and brown-out
+// clear it. millis() starts over at every boot, so times are kept on the
+// RTC clock or as ages at the moment a deep sleep began.
+struct RetainedState {
+  uint32_t magic;
+  uint32_t deepSleeps;
+
+  // Last fix, kept up to date while running, to aid the receiver's start
+  bool fixValid;
+  bool fixParked;
+  int32_t fixLatitudeE7;
+  int32_t fixLongitudeE7;
+  int32_t fixAltitudeDm;
+  uint32_t fixUtcSeconds; // Since 2000-01-01, 0 if unknown
+  uint64_t fixClockMs;    // RTC clock when it was recorded
+
+  // The rest is written by deepSleep() and valid after isResumed()
+  uint64_t sleepStartMs; // RTC clock when it began
+  uint32_t parkedMs;     // Parked this long when it began
+
+  // Publish scheduler reference: last report and its age
+  int32_t reportLatitudeE7;
+  int32_t reportLongitudeE7;
+  uint32_t reportAgeMs;
+
+  bool journalValid;
+  JournalCursor journal;
+
+  uint16_t nextPacketId; // MQTT session (broker keeps the rest)
+};
+
+// Decides how the ESP32 spends the gaps between parked position checks.
+// The network loop tracks parked time with update(), asks plan() once the
+// GPS receiver is in backup with nothing left to send, and then sleeps
+// with lightSleep() or deepSleep() until the receiver's hot start.
+class SleepManager {
+private:
+  unsigned long parkedSince; // millis(), 0 while moving
+  uint8_t resetReason;       // esp_reset_reason_t
+  bool warm;
+  bool resumed;
+  unsigned long sleptMs;    // Deep sleep that ended at this boot
+  unsigned long sleepStart; // Its start on this boot's millis() clock
+  unsigned long lightSleeps;
+  unsigned long lightSleepMs;
+
+  bool isLongParked(unsigned long now) const;
+  void armWakeSources(unsigned long durationMs);
+
+public:
+  SleepManager();
+
+  // Call early in setup(): classifies the boot and picks up RetainedState
+  void begin();
+
+  // Only the ESP32 restarted (deep sleep, software, panic or watchdog
+  // reset): the modem and GPS receiver kept running
+  bool isWarmBoot() const { return warm; }
+  const char *getResetReasonName() const;
+
+  // This boot ended a deep sleep and retained() holds what it saved
+  bool isResumed() const { return resumed; }
+  unsigned long getSleptMs() const { return sleptMs; }
+
+  // When the deep sleep began, as a millis() value of this boot (before
+  // zero, so it wraps; differences with later millis() are correct)
+  unsigned long getSleepStart() const { return sleepStart; }
+
+  // Filled by the caller before deepSleep(), read back after isResumed()
+  RetainedState &retained();
+
+  // Track how long the vehicle has been parked; call every loop()
+  void update(bool parked, unsigned long now);
+
+  // Keep a fresh fix for the next boot's receiver start hint
+  void recordFix(const GpsFix &fix, bool parked);
+
+  // A fix is retained (before the first recordFix(): from an earlier
+  // boot), and its age by the RTC clock
+  bool hasRetainedFix() const;
+  unsigned long getRetainedFixAgeMs() const;
+
+  // How often a parked receiver wakes to look for movement: longer once
+  // deep sleep is allowed
+  unsigned long getParkedCheckInterval(unsigned long now) const;
+
+  // How to spend the time until wakeAt (millis(), the receiver's hot start)
+  SleepMode plan(unsigned long now, unsigned long wakeAt) const;
+
+  // Pause until the timer or SLEEP_WAKE_PIN; returns the time slept
+  unsigned long lightSleep(unsigned long durationMs);
+
+  // Save parked time into retained() and restart after durationMs
+  void deepSleep(unsigned long durationMs);
+
+  unsigned long getLightSleeps() const { return lightSleeps; }
+  unsigned long getLightSleepMs() const { return lightSleepMs; }
+  unsigned long getDeepSleeps() const;
+};
+
+#endif // SLEEP_MANAGER_H
@@ -0,0 +1,58 @@
+#ifndef TRACK_SIMPLIFIER_H
+#define TRACK_SIMPLIFIER_H
+
+#include "config.h"
+#include "gps_fix.h"
+#include <stdint.h>
+
+// Streaming line simplification (opening-window Douglas-Peucker). Fixes
+// are buffered behind an anchor, the last kept point. While every buffered
+// fix lies within the tolerance (default TRACK_TOLERANCE_M) of the segment
+// from the anchor to the newest fix, the middle ones are redundant. When
+// one would stray further, the previous fix is kept and becomes the new
+// anchor. Every dropped fix is therefore within the tolerance of the
+// reported polyline.
+//
+// Memory is bounded by TRACK_WINDOW_SIZE: a full window forces a key point.
+// Key points come out one fix late, since a fix can only be judged once
+// the next one is known.
+class TrackSimplifier {
+private:
+  struct Point {
+    float x; // Meters east of the anchor
+    float y; // Meters north of the anchor
+  };
+
+  Point window[TRACK_WINDOW_SIZE];
+  uint16_t count;
+  float toleranceSq;
+
+  bool hasAnchor;
+  double anchorLatitude;
+  double anchorLongitude;
+  double metersPerDegreeLon;
+
+  GpsFix candidate; // Newest fix, reported if the next one breaks the line
+  unsigned long candidateTime;
+
+  Point project(const GpsFix &fix) const;
+  void setAnchor(const GpsFix &fix);
+
+public:
+  explicit TrackSimplifier(float toleranceMeters = TRACK_TOLERANCE_M);
+
+  // Add a fresh fix. Returns true and sets keyFix/keyTime when an earlier
+  // fix has to be kept.
+  bool add(const GpsFix &fix, unsigned long timestamp, GpsFix &keyFix,
+           unsigned long &keyTime);
+
+  // Start over from a fix that was reported by other means
+  void reset(const GpsFix &fix);
+
+  // Forget everything (no anchor)
+  void clear();
+
+  uint16_t buffered() const { return count; }
+};
+
+#endif // TRACK_SIMPLIFIER_H
@@ -0,0 +1,177 @@
+#ifndef UBX_H
+#define UBX_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// u-blox UBX binary protocol (NEO-6M, protocol version 7): frame layout
+// and the message IDs the firmware uses.
+//   0xB5 0x62 class id length(2, LE) payload checksum(2)
+
+#define UBX_SYNC_1 0xB5
+#define UBX_SYNC_2 0x62
+#define UBX_HEADER_SIZE 6 // Sync, class, id, length
+#define UBX_FRAME_OVERHEAD 8
+
+#define UBX_CLASS_NAV 0x01
+#define UBX_NAV_POSLLH 0x02
+#define UBX_NAV_SOL 0x06
+#define UBX_NAV_VELNED 0x12
+#define UBX_NAV_TIMEUTC 0x21
+
+#define UBX_CLASS_RXM 0x02
+#define UBX_RXM_PMREQ 0x41
+#define UBX_PMREQ_BACKUP 0x00000002 // RXM-PMREQ flags: enter backup
+
+#define UBX_CLASS_AID 0x0B
+#define UBX_AID_INI 0x01
+
+// AID-INI flags: position and time valid, position as lat/lon/alt
+#define UBX_AID_INI_POS 0x0001
+#define UBX_AID_INI_TIME 0x0002
+#define UBX_AID_INI_LLA 0x0020
+
+#define UBX_GPS_LEAP_SECONDS 18 // GPS - UTC since 2017-01-01
+
+#define UBX_CLASS_ACK 0x05
+#define UBX_ACK_NAK 0x00
+#define UBX_ACK_ACK 0x01
+
+#define UBX_CLASS_CFG 0x06
+#define UBX_CFG_PRT 0x00
+#define UBX_CFG_MSG 0x01
+#define UBX_CFG_RATE 0x08
+#define UBX_CFG_RXM 0x11
+#define UBX_CFG_PM2 0x3B
+#define UBX_CFG_NAV5 0x24
+
+#define UBX_NAV5_MASK_DYN 0x0001 // CFG-NAV5: apply dynModel only
+
+#define UBX_RXM_CONTINUOUS 0 // CFG-RXM lpMode: max performance
+#define UBX_RXM_POWER_SAVE 1
+
+// CFG-PM2 flags: cyclic tracking, keep ephemeris fresh, wait for a fix
+// before an off period
+#define UBX_PM2_CYCLIC_TRACKING 0x00020000
+#define UBX_PM2_UPDATE_EPH 0x00001000
+#define UBX_PM2_WAIT_TIME_FIX 0x00000400
+
+// Standard NMEA messages, for CFG-MSG
+#define UBX_CLASS_NMEA 0xF0
+#define UBX_NMEA_GGA 0x00
+#define UBX_NMEA_GLL 0x01
+#define UBX_NMEA_GSA 0x02
+#define UBX_NMEA_GSV 0x03
+#define UBX_NMEA_RMC 0x04
+#define UBX_NMEA_VTG 0x05
+
+#define UBX_PORT_UART1 1            // NEO-6M host port
+#define UBX_PORT_MODE_8N1 0x000008D0
+#define UBX_PROTO_UBX 0x0001
+#define UBX_PROTO_NMEA 0x0002
+#define UBX_PROTO_RTCM 0x0004
+
+// Payload overlays, little-endian as on the wire (ESP32 and hosts are
+// little-endian too). Packed: frames sit at any offset in the buffer.
+struct __attribute__((packed)) UbxNavPosllh {
+  uint32_t iTOW;  // GPS time of week, ms
+  int32_t lon;    // 1e-7 deg
+  int32_t lat;    // 1e-7 deg
+  int32_t height; // Above ellipsoid, mm
+  int32_t hMSL;   // Above mean sea level, mm
+  uint32_t hAcc;  // mm
+  uint32_t vAcc;  // mm
+};
+
+struct __attribute__((packed)) UbxNavSol {
+  uint32_t iTOW;
+  int32_t fTOW; // ns
+  int16_t week;
+  uint8_t gpsFix; // 0 none, 1 DR, 2 2D, 3 3D, 4 GPS+DR, 5 time only
+  uint8_t flags;  // Bit 0: gpsFixOK
+  int32_t ecefX;  // cm
+  int32_t ecefY;
+  int32_t ecefZ;
+  uint32_t pAcc;  // cm
+  int32_t ecefVX; // cm/s
+  int32_t ecefVY;
+  int32_t ecefVZ;
+  uint32_t sAcc; // cm/s
+  uint16_t pDOP; // 0.01
+  uint8_t reserved1;
+  uint8_t numSV;
+  uint32_t reserved2;
+};
+
+struct __attribute__((packed)) UbxNavVelned {
+  uint32_t iTOW;
+  int32_t velN; // cm/s
+  int32_t velE;
+  int32_t velD;
+  uint32_t speed;  // 3D, cm/s
+  uint32_t gSpeed; // Ground speed, cm/s
+  int32_t heading; // 1e-5 deg
+  uint32_t sAcc;   // cm/s
+  uint32_t cAcc;   // 1e-5 deg
+};
+
+struct __attribute__((packed)) UbxNavTimeutc {
+  uint32_t iTOW;
+  uint32_t tAcc; // ns
+  int32_t nano;  // -1e9..1e9, fraction of the second
+  uint16_t year;
+  uint8_t month;
+  uint8_t day;
+  uint8_t hour;
+  uint8_t min;
+  uint8_t sec;
+  uint8_t valid; // Bit 2: validUTC
+};
+
+// Initial position and time for a faster start (not acknowledged)
+struct __attribute__((packed)) UbxAidIni {
+  int32_t lat;     // 1e-7 deg (UBX_AID_INI_LLA)
+  int32_t lon;     // 1e-7 deg
+  int32_t alt;     // cm
+  uint32_t posAcc; // cm
+  int16_t tmCfg;   // 0: no time mark
+  uint16_t wn;     // GPS week
+  uint32_t tow;    // GPS time of week, ms
+  int32_t towNs;
+  uint32_t tAccMs;
+  uint32_t tAccNs;
+  int32_t clkD; // Clock drift, unknown: 0
+  uint32_t clkDAcc;
+  uint32_t flags;
+};
+
+#define UBX_SOL_FIX_OK 0x01
+#define UBX_TIMEUTC_VALID_UTC 0x04
+
+static_assert(sizeof(UbxNavPosllh) == 28, "NAV-POSLLH layout");
+static_assert(sizeof(UbxNavSol) == 52, "NAV-SOL layout");
+static_assert(sizeof(UbxNavVelned) == 36, "NAV-VELNED layout");
+static_assert(sizeof(UbxNavTimeutc) == 20, "NAV-TIMEUTC layout");
+static_assert(sizeof(UbxAidIni) == 48, "AID-INI layout");
+
+// 8-bit Fletcher checksum over class, id, length and payload
+void ubxChecksum(const uint8_t *data, size_t length, uint8_t &ckA,
+                 uint8_t &ckB);
+
+// Write one UBX frame to port; returns bytes written
+size_t ubxSend(Print &port, uint8_t messageClass, uint8_t messageId,
+               const uint8_t *payload, uint16_t length);
+
+// Little-endian payload fields
+inline void ubxPutU16(uint8_t *p, uint16_t value) {
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+inline void ubxPutU32(uint8_t *p, uint32_t value) {
+  ubxPutU16(p, (uint16_t)value);
+  ubxPutU16(p + 2, (uint16_t)(value >> 16));
+}
+
+#endif // UBX_H
@@ -0,0 +1,68 @@
+#ifndef UBX_PARSER_H
+#define UBX_PARSER_H
+
+#include "config.h"
+#include "gps_fix.h"
+#include "ubx.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define UBX_MAX_PAYLOAD 64 // Largest payload decoded (NAV-SOL: 52)
+
+// Bulk UBX ingest. UART bytes are read straight into a linear buffer;
+// process() finds frames, validates their checksum and decodes the NAV
+// messages by overlaying the payload structs from ubx.h on the buffer
+// itself. Only an incomplete trailing frame is moved (to the front). The
+// messages of one navigation epoch (same iTOW) are combined into the fix;
+// validity and locationMillis change once per epoch. No heap use.
+class UbxParser {
+private:
+  uint8_t buffer[UBX_BUFFER_SIZE];
+  size_t length;
+
+  // Navigation epoch being assembled
+  uint32_t epochTow;
+  uint8_t epochSeen; // EPOCH_* bits of the messages received
+  bool epochFixOk;   // NAV-SOL: gpsFixOK and a 2D/3D fix
+  bool epochFix3D;
+
+  // Last ACK-ACK / ACK-NAK
+  bool ackPending;
+  bool ackPositive;
+  uint8_t ackClass;
+  uint8_t ackId;
+
+  unsigned long bytesProcessed;
+  unsigned long framesParsed;
+  unsigned long framesIgnored;
+  unsigned long checksumFailures;
+  unsigned long droppedBytes;
+
+  void handleFrame(uint8_t messageClass, uint8_t messageId,
+                   const uint8_t *payload, uint16_t payloadLength,
+                   GpsFix &fix, unsigned long now);
+  void beginEpoch(uint32_t tow, GpsFix &fix, unsigned long now);
+  void commitEpoch(GpsFix &fix, unsigned long now);
+
+public:
+  UbxParser();
+
+  // Contiguous free space for a direct UART read; commit() what was read
+  uint8_t *writeSpace(size_t &space);
+  void commit(size_t count);
+
+  // Decode every complete frame in the buffer
+  void process(GpsFix &fix, unsigned long now);
+
+  // True once if the receiver answered the given CFG message since the
+  // last call; acknowledged is false for ACK-NAK
+  bool takeAck(uint8_t messageClass, uint8_t messageId, bool &acknowledged);
+
+  unsigned long getBytesProcessed() const { return bytesProcessed; }
+  unsigned long getFramesParsed() const { return framesParsed; }
+  unsigned long getFramesIgnored() const { return framesIgnored; }
+  unsigned long getChecksumFailures() const { return checksumFailures; }
+  unsigned long getDroppedBytes() const { return droppedBytes; }
+};
+
+#endif // UBX_PARSER_H
@@ -0,0 +1,64 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <cstdio>
+
+EspClass ESP;
+HostConsole Serial;
+
+unsigned long millis() { return hostclock::millis(); }
+unsigned long micros() { return hostclock::micros(); }
+void delay(unsigned long ms) { hostclock::delay(ms); }
+void delayMicroseconds(unsigned int us) { hostclock::delayMicroseconds(us); }
+void yield() { hostclock::yield(); }
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+#define MAX_WRITE_HOOKS 4
+
+static hostgpio::WriteHook writeHooks[MAX_WRITE_HOOKS];
+static int writeHookCount = 0;
+
+void hostgpio::addWriteHook(WriteHook hook) {
+  if (writeHookCount < MAX_WRITE_HOOKS) {
+    writeHooks[writeHookCount++] = hook;
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  for (int i = 0; i < writeHookCount; i++) {
+    writeHooks[i](pin, val);
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  (void)pin;
+  return LOW;
+}
+
+// No allocator introspection on the host; report the board's typical value
+uint32_t EspClass::getFreeHeap() { return 320 * 1024; }
+
+uint32_t EspClass::getCycleCount() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now)
+                    .count();
+  return (uint32_t)(ns * getCpuFreqMHz() / 1000);
+}
+
+void EspClass::restart() {
+  fflush(stdout);
+  exit(0);
+}
+
+size_t HostConsole::write(uint8_t c) { return write(&c, 1); }
+
+size_t HostConsole::write(const uint8_t *buffer, size_t size) {
+  if (!quiet) {
+    fwrite(buffer, 1, size, stdout);
+  }
+  return size;
+}
@@ -0,0 +1,96 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host (native) replacement for the Arduino core. Only the subset of the
+// API that the firmware and its libraries (TinyGPSPlus, PubSubClient) use
+// is provided. Timing is driven by host_clock.h.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "HardwareSerial.h"
+#include "Print.h"
+#include "Stream.h"
+#include "WString.h"
+#include "host_clock.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define radians(deg) ((deg) * DEG_TO_RAD)
+#define degrees(rad) ((rad) * RAD_TO_DEG)
+#define sq(x) ((x) * (x))
+
+#define PROGMEM
+#define F(s) (s)
+#define pgm_read_byte(addr) (*(const unsigned char *)(addr))
+
+using std::max;
+using std::min;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+// Simulated devices wired to GPIOs (the SIM800L reset line)
+namespace hostgpio {
+
+typedef void (*WriteHook)(uint8_t pin, uint8_t val);
+
+// Called on every digitalWrite()
+void addWriteHook(WriteHook hook);
+
+} // namespace hostgpio
+
+class EspClass {
+public:
+  uint32_t getFreeHeap();
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getCycleCount(); // Wall clock at getCpuFreqMHz(), not simulated
+  void restart();
+};
+
+extern EspClass ESP;
+
+// Debug console (USB CDC on the board), mapped to stdout
+class HostConsole : public Stream {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  void setQuiet(bool quiet) { this->quiet = quiet; }
+
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+
+private:
+  bool quiet = false;
+};
+
+extern HostConsole Serial;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,142 @@
+#include "HardwareSerial.h"
+
+#include "host_clock.h"
+
+static HardwareSerial *ports[HOST_UART_COUNT];
+static UartTap *tap = nullptr;
+
+HardwareSerial::HardwareSerial(int uartNum)
+    : uartNum(uartNum), baud(0), peer(nullptr), rxBuffer(nullptr),
+      rxCapacity(0), rxHead(0), rxCount(0), overrunBytes(0),
+      receivedBytes(0) {
+  setRxBufferSize(HOST_UART_RX_BUFFER_DEFAULT);
+  if (uartNum >= 0 && uartNum < HOST_UART_COUNT) {
+    ports[uartNum] = this;
+  }
+}
+
+HardwareSerial::~HardwareSerial() {
+  if (uartNum >= 0 && uartNum < HOST_UART_COUNT && ports[uartNum] == this) {
+    ports[uartNum] = nullptr;
+  }
+  delete[] rxBuffer;
+}
+
+HardwareSerial *HardwareSerial::port(int uartNum) {
+  if (uartNum < 0 || uartNum >= HOST_UART_COUNT)
+    return nullptr;
+  return ports[uartNum];
+}
+
+void HardwareSerial::setTap(UartTap *uartTap) { tap = uartTap; }
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin,
+                           int8_t txPin) {
+  (void)config;
+  (void)rxPin;
+  (void)txPin;
+  updateBaudRate(baud);
+}
+
+void HardwareSerial::end() { rxCount = 0; }
+
+void HardwareSerial::updateBaudRate(unsigned long baud) {
+  this->baud = baud;
+  if (peer) {
+    peer->onBaudRate(baud);
+  }
+}
+
+size_t HardwareSerial::setRxBufferSize(size_t size) {
+  delete[] rxBuffer;
+  rxBuffer = new uint8_t[size];
+  rxCapacity = size;
+  rxHead = 0;
+  rxCount = 0;
+  return size;
+}
+
+void HardwareSerial::attachPeer(SerialPeer *peer) {
+  this->peer = peer;
+  if (peer && baud) {
+    peer->onBaudRate(baud);
+  }
+}
+
+void HardwareSerial::pumpPeer() {
+  if (peer) {
+    peer->pump(hostclock::millis(), *this);
+  }
+}
+
+size_t HardwareSerial::inject(const uint8_t *data, size_t len) {
+  if (tap && len > 0) {
+    tap->onTraffic(uartNum, true, data, len);
+  }
+  size_t accepted = 0;
+  for (size_t i = 0; i < len; i++) {
+    if (rxCount == rxCapacity) {
+      overrunBytes += len - i;
+      if (onError)
+        onError(UART_BUFFER_FULL_ERROR);
+      break;
+    }
+    rxBuffer[(rxHead + rxCount) % rxCapacity] = data[i];
+    rxCount++;
+    accepted++;
+  }
+  receivedBytes += accepted;
+  return accepted;
+}
+
+int HardwareSerial::available() {
+  pumpPeer();
+  return (int)rxCount;
+}
+
+int HardwareSerial::peek() {
+  pumpPeer();
+  return rxCount ? rxBuffer[rxHead] : -1;
+}
+
+int HardwareSerial::read() {
+  pumpPeer();
+  if (!rxCount)
+    return -1;
+  uint8_t c = rxBuffer[rxHead];
+  rxHead = (rxHead + 1) % rxCapacity;
+  rxCount--;
+  return c;
+}
+
+size_t HardwareSerial::read(uint8_t *buffer, size_t size) {
+  pumpPeer();
+  size_t n = 0;
+  while (n < size && rxCount) {
+    buffer[n++] = rxBuffer[rxHead];
+    rxHead = (rxHead + 1) % rxCapacity;
+    rxCount--;
+  }
+  return n;
+}
+
+// Like the ESP32 core: drain what is buffered, wait only for the rest
+size_t HardwareSerial::readBytes(uint8_t *buffer, size_t length) {
+  size_t n = read(buffer, length);
+  if (n < length) {
+    n += Stream::readBytes(buffer + n, length - n);
+  }
+  return n;
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  if (tap && size > 0) {
+    tap->onTraffic(uartNum, false, buffer, size);
+  }
+  if (peer) {
+    peer->onHostWrite(buffer, size);
+  }
+  return size;
+}
@@ -0,0 +1,100 @@
+#ifndef HOST_HARDWARE_SERIAL_H
+#define HOST_HARDWARE_SERIAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "Stream.h"
+
+#define SERIAL_8N1 0x800001c
+
+#define HOST_UART_COUNT 3
+#define HOST_UART_RX_BUFFER_DEFAULT 256
+
+class HardwareSerial;
+
+enum hardwareSerial_error_t {
+  UART_NO_ERROR,
+  UART_BREAK_ERROR,
+  UART_BUFFER_FULL_ERROR,
+  UART_FIFO_OVF_ERROR,
+  UART_FRAME_ERROR,
+  UART_PARITY_ERROR,
+};
+
+typedef std::function<void(hardwareSerial_error_t)> OnReceiveErrorCb;
+
+// The device on the other end of a simulated UART. The peer sees every byte
+// the firmware writes and pushes its own bytes into the port from pump(),
+// which runs every time the firmware touches the port.
+class SerialPeer {
+public:
+  virtual ~SerialPeer() {}
+  virtual void onBaudRate(unsigned long baud) { (void)baud; }
+  virtual void onHostWrite(const uint8_t *data, size_t len) = 0;
+  virtual void pump(unsigned long nowMs, HardwareSerial &port) = 0;
+};
+
+// Sees the bytes on every port in both directions, for recording
+class UartTap {
+public:
+  virtual ~UartTap() {}
+  // toFirmware: arrived on the RX line (including bytes then lost to an
+  // overrun); otherwise written by the firmware
+  virtual void onTraffic(int uartNum, bool toFirmware, const uint8_t *data,
+                         size_t len) = 0;
+};
+
+// Simulated ESP32 UART with a bounded RX buffer. Bytes that arrive while
+// the buffer is full are dropped and counted, like a hardware FIFO overrun.
+class HardwareSerial : public Stream {
+public:
+  explicit HardwareSerial(int uartNum);
+  ~HardwareSerial();
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1,
+             int8_t rxPin = -1, int8_t txPin = -1);
+  void end();
+  void updateBaudRate(unsigned long baud);
+  unsigned long baudRate() const { return baud; }
+  size_t setRxBufferSize(size_t size);
+  // Called once for each arrival that overflows the RX buffer
+  void onReceiveError(OnReceiveErrorCb function) { onError = function; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t *buffer, size_t size);
+  size_t readBytes(uint8_t *buffer, size_t length) override;
+  using Stream::readBytes;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  void flush() override {}
+
+  // Host-side wiring
+  static HardwareSerial *port(int uartNum);
+  static void setTap(UartTap *tap);
+  void attachPeer(SerialPeer *peer);
+  // Push bytes into the RX buffer; returns how many fit
+  size_t inject(const uint8_t *data, size_t len);
+  unsigned long getOverrunBytes() const { return overrunBytes; }
+  unsigned long getReceivedBytes() const { return receivedBytes; }
+
+private:
+  void pumpPeer();
+
+  int uartNum;
+  unsigned long baud;
+  SerialPeer *peer;
+  OnReceiveErrorCb onError;
+  uint8_t *rxBuffer;
+  size_t rxCapacity;
+  size_t rxHead;
+  size_t rxCount;
+  unsigned long overrunBytes;
+  unsigned long receivedBytes;
+};
+
+#endif // HOST_HARDWARE_SERIAL_H
@@ -0,0 +1,65 @@
+#include "Print.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (write(*buffer++))
+      n++;
+    else
+      break;
+  }
+  return n;
+}
+
+size_t Print::print(const String &s) { return write(s.c_str(), s.length()); }
+
+size_t Print::print(const char *str) { return write(str); }
+
+size_t Print::print(char c) { return write((uint8_t)c); }
+
+size_t Print::print(unsigned char value, int base) {
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(int value, int base) { return print((long)value, base); }
+
+size_t Print::print(unsigned int value, int base) {
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(long value, int base) {
+  return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(unsigned long value, int base) {
+  return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(long long value, int base) {
+  return print((long)value, base);
+}
+
+size_t Print::print(unsigned long long value, int base) {
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(double value, int digits) {
+  return print(String(value, (unsigned int)digits));
+}
+
+size_t Print::println() { return write("\r\n"); }
+
+int Print::printf(const char *format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (len < 0)
+    return len;
+  size_t n = (size_t)len < sizeof(buffer) ? (size_t)len : sizeof(buffer) - 1;
+  return (int)write((const uint8_t *)buffer, n);
+}
@@ -0,0 +1,35 @@
+#include "Stream.h"
+
+#include "host_clock.h"
+
+int Stream::timedRead() {
+  unsigned long start = hostclock::millis();
+  do {
+    int c = read();
+    if (c >= 0)
+      return c;
+    hostclock::yield();
+  } while (hostclock::millis() - start < timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(uint8_t *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0)
+      break;
+    buffer[count++] = (uint8_t)c;
+  }
+  return count;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String result;
+  int c = timedRead();
+  while (c >= 0 && c != terminator) {
+    result += (char)c;
+    c = timedRead();
+  }
+  return result;
+}
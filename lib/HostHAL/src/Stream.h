@@ -0,0 +1,29 @@
+#ifndef HOST_STREAM_H
+#define HOST_STREAM_H
+
+#include "Print.h"
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { this->timeout = timeout; }
+  unsigned long getTimeout() const { return timeout; }
+
+  // Reads until length bytes arrived or the stream timeout expired
+  virtual size_t readBytes(uint8_t *buffer, size_t length);
+  size_t readBytes(char *buffer, size_t length) {
+    return readBytes((uint8_t *)buffer, length);
+  }
+
+  String readStringUntil(char terminator);
+
+protected:
+  int timedRead();
+
+  unsigned long timeout = 1000;
+};
+
+#endif // HOST_STREAM_H
@@ -0,0 +1,301 @@
+#include "TinyGsmClient.h"
+
+#include <string>
+
+// ============================================
+// TinyGsm
+// ============================================
+
+int8_t TinyGsm::waitResponse(uint32_t timeout_ms, String &data, GsmConstStr r1,
+                             GsmConstStr r2, GsmConstStr r3, GsmConstStr r4,
+                             GsmConstStr r5) {
+  GsmConstStr responses[] = {r1, r2, r3, r4, r5};
+  std::string buffer;
+  unsigned long start = millis();
+  do {
+    while (stream.available() > 0) {
+      buffer += (char)stream.read();
+      for (int i = 0; i < 5; i++) {
+        const char *r = responses[i];
+        size_t n = r ? strlen(r) : 0;
+        if (n && buffer.size() >= n &&
+            buffer.compare(buffer.size() - n, n, r) == 0) {
+          data = String(buffer);
+          return (int8_t)(i + 1);
+        }
+      }
+    }
+    yield();
+  } while (millis() - start < timeout_ms);
+  data = String(buffer);
+  return 0;
+}
+
+int8_t TinyGsm::waitResponse(uint32_t timeout_ms, GsmConstStr r1,
+                             GsmConstStr r2, GsmConstStr r3, GsmConstStr r4,
+                             GsmConstStr r5) {
+  String data;
+  return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5);
+}
+
+int8_t TinyGsm::waitResponse(GsmConstStr r1, GsmConstStr r2, GsmConstStr r3,
+                             GsmConstStr r4, GsmConstStr r5) {
+  return waitResponse(1000, r1, r2, r3, r4, r5);
+}
+
+bool TinyGsm::query(const char *cmd, const char *prefix, String &value,
+                    uint32_t timeout_ms) {
+  sendAT(cmd);
+  String data;
+  if (waitResponse(timeout_ms, data) != 1)
+    return false;
+  int pos = data.indexOf(prefix);
+  if (pos < 0)
+    return false;
+  int end = data.indexOf('\r', pos);
+  value = data.substring(pos + strlen(prefix), end < 0 ? data.length() : end);
+  value.trim();
+  return true;
+}
+
+bool TinyGsm::init(const char *pin) {
+  (void)pin;
+  if (!testAT())
+    return false;
+  sendAT("E0");
+  return waitResponse() == 1;
+}
+
+bool TinyGsm::restart(const char *pin) {
+  if (!testAT())
+    return false;
+  sendAT("+CFUN=1,1");
+  waitResponse(10000L);
+  delay(3000);
+  return init(pin);
+}
+
+bool TinyGsm::testAT(uint32_t timeout_ms) {
+  for (unsigned long start = millis(); millis() - start < timeout_ms;) {
+    sendAT("");
+    if (waitResponse(200) == 1)
+      return true;
+    delay(100);
+  }
+  return false;
+}
+
+String TinyGsm::getModemInfo() {
+  sendAT("I");
+  String data;
+  if (waitResponse(1000L, data) != 1)
+    return String();
+  // Drop the echo and the final result code
+  std::string text(data.c_str());
+  size_t ok = text.rfind("OK\r\n");
+  if (ok != std::string::npos)
+    text.erase(ok);
+  size_t echo = text.find("ATI");
+  if (echo != std::string::npos)
+    text.erase(echo, 3);
+  String info(text);
+  info.trim();
+  return info;
+}
+
+SimStatus TinyGsm::getSimStatus(uint32_t timeout_ms) {
+  for (unsigned long start = millis(); millis() - start < timeout_ms;) {
+    String value;
+    if (query("+CPIN?", "+CPIN:", value)) {
+      if (value == "READY")
+        return SIM_READY;
+      if (value.startsWith("SIM PIN") || value.startsWith("SIM PUK"))
+        return SIM_LOCKED;
+      return SIM_ERROR;
+    }
+    delay(1000);
+  }
+  return SIM_ERROR;
+}
+
+int16_t TinyGsm::getSignalQuality() {
+  String value;
+  if (!query("+CSQ", "+CSQ:", value))
+    return 99;
+  return (int16_t)value.toInt();
+}
+
+bool TinyGsm::isNetworkConnected() {
+  String value;
+  if (!query("+CREG?", "+CREG:", value))
+    return false;
+  int comma = value.indexOf(',');
+  int status = (int)value.substring(comma + 1).toInt();
+  return status == 1 || status == 5;
+}
+
+bool TinyGsm::waitForNetwork(uint32_t timeout_ms, bool check_signal) {
+  for (unsigned long start = millis(); millis() - start < timeout_ms;) {
+    if (check_signal)
+      getSignalQuality();
+    if (isNetworkConnected())
+      return true;
+    delay(250);
+  }
+  return false;
+}
+
+String TinyGsm::getOperator() {
+  String value;
+  if (!query("+COPS?", "+COPS:", value))
+    return String();
+  int open = value.indexOf('"');
+  int close = open < 0 ? -1 : value.indexOf('"', open + 1);
+  if (close < 0)
+    return String();
+  return value.substring(open + 1, close);
+}
+
+bool TinyGsm::gprsConnect(const char *apn, const char *user, const char *pwd) {
+  gprsDisconnect();
+
+  sendAT("+CGATT=1");
+  if (waitResponse(60000L) != 1)
+    return false;
+  sendAT("+CIPMUX=1");
+  if (waitResponse() != 1)
+    return false;
+  sendAT("+CIPQSEND=1");
+  if (waitResponse() != 1)
+    return false;
+  sendAT("+CIPRXGET=1");
+  if (waitResponse() != 1)
+    return false;
+  sendAT("+CSTT=\"", apn, "\",\"", user ? user : "", "\",\"", pwd ? pwd : "",
+         "\"");
+  if (waitResponse(60000L) != 1)
+    return false;
+  sendAT("+CIICR");
+  if (waitResponse(60000L) != 1)
+    return false;
+
+  return getLocalIP().length() > 0;
+}
+
+bool TinyGsm::gprsDisconnect() {
+  hostnet::dropAll();
+  sendAT("+CIPSHUT");
+  if (waitResponse(60000L, GF("SHUT OK")) != 1)
+    return false;
+  sendAT("+CGATT=0");
+  return waitResponse(60000L) == 1;
+}
+
+bool TinyGsm::isGprsConnected() {
+  String value;
+  if (!query("+CGATT?", "+CGATT:", value) || value.toInt() != 1)
+    return false;
+  return getLocalIP().length() > 0;
+}
+
+String TinyGsm::getLocalIP() {
+  // ";E0" makes the modem terminate the bare address line with an OK
+  sendAT("+CIFSR;E0");
+  String data;
+  if (waitResponse(10000L, data) != 1)
+    return String();
+  std::string text(data.c_str());
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t end = text.find("\r\n", pos);
+    if (end == std::string::npos)
+      end = text.size();
+    std::string line = text.substr(pos, end - pos);
+    if (!line.empty() &&
+        line.find_first_not_of("0123456789.") == std::string::npos) {
+      return String(line);
+    }
+    pos = end + 2;
+  }
+  return String();
+}
+
+// ============================================
+// TinyGsmClient
+// ============================================
+
+int TinyGsmClient::connect(IPAddress ip, uint16_t port) {
+  char host[16];
+  snprintf(host, sizeof(host), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  return connect(host, port);
+}
+
+int TinyGsmClient::connect(const char *host, uint16_t port) {
+  stop();
+  if (!at)
+    return 0;
+  // Like TinyGSM: the modem opens the socket, data then goes in-process
+  at->sendAT("+CIPSTART=0,\"TCP\",\"", host, "\",", port);
+  if (at->waitResponse(75000L, GF("CONNECT OK\r\n"), GF("CONNECT FAIL\r\n"),
+                       GF("ALREADY CONNECT\r\n"), GF("ERROR\r\n"),
+                       GF("CLOSE OK\r\n")) != 1)
+    return 0;
+  link = hostnet::connect(host, port);
+  return link != nullptr;
+}
+
+size_t TinyGsmClient::write(const uint8_t *buf, size_t size) {
+  if (!link || !link->open)
+    return 0;
+  link->toServer.insert(link->toServer.end(), buf, buf + size);
+  hostnet::poll();
+  return size;
+}
+
+int TinyGsmClient::available() {
+  if (!link)
+    return 0;
+  hostnet::poll();
+  if (link->toClient.empty()) {
+    // On the modem an empty poll is an AT+CIPRXGET round trip. Letting
+    // time move also ends busy-waits such as PubSubClient's CONNACK wait.
+    yield();
+  }
+  return (int)link->toClient.size();
+}
+
+int TinyGsmClient::read() {
+  if (!available())
+    return -1;
+  uint8_t c = link->toClient.front();
+  link->toClient.pop_front();
+  return c;
+}
+
+int TinyGsmClient::read(uint8_t *buf, size_t size) {
+  size_t n = 0;
+  while (n < size && available()) {
+    buf[n++] = link->toClient.front();
+    link->toClient.pop_front();
+  }
+  return (int)n;
+}
+
+int TinyGsmClient::peek() {
+  if (!available())
+    return -1;
+  return link->toClient.front();
+}
+
+void TinyGsmClient::stop() {
+  if (link) {
+    hostnet::close(link);
+    link = nullptr;
+  }
+}
+
+uint8_t TinyGsmClient::connected() {
+  if (!link)
+    return false;
+  return link->open || !link->toClient.empty();
+}
@@ -0,0 +1,124 @@
+#ifndef HOST_TINY_GSM_CLIENT_H
+#define HOST_TINY_GSM_CLIENT_H
+
+// Host replacement for TinyGSM. Implements the SIM800 calls the firmware
+// makes as plain AT exchanges over the given Stream (on the host build that
+// is a HardwareSerial wired to FakeSim800), and routes TinyGsmClient sockets
+// to in-process servers registered with hostnet::listen().
+
+#include "Arduino.h"
+#include "Client.h"
+#include "host_network.h"
+
+#define GSM_OK "OK\r\n"
+#define GSM_ERROR "ERROR\r\n"
+#define GSM_CME_ERROR "+CME ERROR:"
+#define GSM_CMS_ERROR "+CMS ERROR:"
+#define GF(x) x
+#define GFP(x) x
+
+typedef const char *GsmConstStr;
+
+enum SimStatus {
+  SIM_ERROR = 0,
+  SIM_READY = 1,
+  SIM_LOCKED = 2,
+  SIM_ANTITHEFT_LOCKED = 3,
+};
+
+class TinyGsm {
+public:
+  explicit TinyGsm(Stream &stream) : stream(stream) {}
+
+  bool init(const char *pin = nullptr);
+  bool restart(const char *pin = nullptr);
+  bool testAT(uint32_t timeout_ms = 10000L);
+  String getModemInfo();
+  SimStatus getSimStatus(uint32_t timeout_ms = 10000L);
+  int16_t getSignalQuality();
+  bool isNetworkConnected();
+  bool waitForNetwork(uint32_t timeout_ms = 60000L, bool check_signal = false);
+  String getOperator();
+  bool gprsConnect(const char *apn, const char *user = nullptr,
+                   const char *pwd = nullptr);
+  bool gprsDisconnect();
+  bool isGprsConnected();
+  String getLocalIP();
+  bool maintain() { return true; }
+
+  template <typename... Args> void sendAT(Args... cmd) {
+    stream.print("AT");
+    int unused[] = {0, ((void)stream.print(cmd), 0)...};
+    (void)unused;
+    stream.print("\r\n");
+    stream.flush();
+  }
+
+  int8_t waitResponse(uint32_t timeout_ms, String &data,
+                      GsmConstStr r1 = GFP(GSM_OK),
+                      GsmConstStr r2 = GFP(GSM_ERROR),
+                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
+                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
+                      GsmConstStr r5 = nullptr);
+  int8_t waitResponse(uint32_t timeout_ms, GsmConstStr r1 = GFP(GSM_OK),
+                      GsmConstStr r2 = GFP(GSM_ERROR),
+                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
+                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
+                      GsmConstStr r5 = nullptr);
+  int8_t waitResponse(GsmConstStr r1 = GFP(GSM_OK),
+                      GsmConstStr r2 = GFP(GSM_ERROR),
+                      GsmConstStr r3 = GFP(GSM_CME_ERROR),
+                      GsmConstStr r4 = GFP(GSM_CMS_ERROR),
+                      GsmConstStr r5 = nullptr);
+
+  Stream &stream;
+
+private:
+  // Sends a query and returns the text after "<prefix>" up to end of line
+  bool query(const char *cmd, const char *prefix, String &value,
+             uint32_t timeout_ms = 1000L);
+};
+
+class TinyGsmClient : public Client {
+public:
+  TinyGsmClient() {}
+  explicit TinyGsmClient(TinyGsm &modem, uint8_t mux = 0) : at(&modem) {
+    (void)mux;
+  }
+  ~TinyGsmClient() { stop(); }
+
+  bool init(TinyGsm *modem, uint8_t mux = 0) {
+    (void)mux;
+    at = modem;
+    return true;
+  }
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char *host, uint16_t port) override;
+  int connect(const char *host, uint16_t port, int timeout_s) {
+    (void)timeout_s;
+    return connect(host, port);
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int read(uint8_t *buf, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+protected:
+  // TinyGSM sets this from "+CIPRXGET: 1,<mux>" and reads the modem on the
+  // next available(); reads here go straight to the link, so it is unused
+  bool got_data = false;
+
+private:
+  TinyGsm *at = nullptr;
+  HostLink *link = nullptr;
+};
+
+#endif // HOST_TINY_GSM_CLIENT_H
@@ -0,0 +1,112 @@
+#include "WString.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+static std::string integerToString(unsigned long long value, bool negative,
+                                   unsigned char base) {
+  if (base < 2 || base > 36)
+    base = 10;
+  char buffer[72];
+  int pos = sizeof(buffer) - 1;
+  buffer[pos] = '\0';
+  do {
+    int digit = (int)(value % base);
+    buffer[--pos] = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    value /= base;
+  } while (value > 0);
+  if (negative)
+    buffer[--pos] = '-';
+  return std::string(&buffer[pos]);
+}
+
+static std::string floatToString(double value, unsigned int decimalPlaces) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", (int)decimalPlaces, value);
+  return std::string(buffer);
+}
+
+String::String(int value, unsigned char base)
+    : String((long)value, base) {}
+
+String::String(unsigned int value, unsigned char base)
+    : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base)
+    : s(base == 10 && value < 0
+            ? integerToString(0ULL - (unsigned long long)value, true, base)
+            : integerToString((unsigned long)value, false, base)) {}
+
+String::String(unsigned long value, unsigned char base)
+    : s(integerToString(value, false, base)) {}
+
+String::String(float value, unsigned int decimalPlaces)
+    : s(floatToString(value, decimalPlaces)) {}
+
+String::String(double value, unsigned int decimalPlaces)
+    : s(floatToString(value, decimalPlaces)) {}
+
+int String::indexOf(const char *str, unsigned int fromIndex) const {
+  size_t pos = s.find(str, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const {
+  size_t pos = s.find(c, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex) const {
+  if (beginIndex >= s.length())
+    return String();
+  return String(s.substr(beginIndex));
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+  if (beginIndex > endIndex)
+    std::swap(beginIndex, endIndex);
+  if (beginIndex >= s.length())
+    return String();
+  return String(s.substr(beginIndex, endIndex - beginIndex));
+}
+
+bool String::startsWith(const char *prefix) const {
+  return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+bool String::endsWith(const char *suffix) const {
+  size_t n = strlen(suffix);
+  return s.length() >= n && s.compare(s.length() - n, n, suffix) == 0;
+}
+
+long String::toInt() const { return strtol(s.c_str(), nullptr, 10); }
+
+void String::trim() {
+  size_t begin = s.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) {
+    s.clear();
+    return;
+  }
+  size_t end = s.find_last_not_of(" \t\r\n");
+  s = s.substr(begin, end - begin + 1);
+}
+
+String operator+(const String &lhs, const String &rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
+
+String operator+(const String &lhs, const char *rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
+
+String operator+(const char *lhs, const String &rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
@@ -0,0 +1,64 @@
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <cstddef>
+#include <string>
+
+// Minimal Arduino String backed by std::string
+class String {
+public:
+  String() {}
+  String(const char *cstr) : s(cstr ? cstr : "") {}
+  String(const std::string &str) : s(str) {}
+  explicit String(char c) : s(1, c) {}
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimalPlaces = 2);
+  explicit String(double value, unsigned int decimalPlaces = 2);
+
+  unsigned int length() const { return (unsigned int)s.length(); }
+  const char *c_str() const { return s.c_str(); }
+  bool reserve(unsigned int size) {
+    s.reserve(size);
+    return true;
+  }
+
+  String &operator+=(const String &rhs) {
+    s += rhs.s;
+    return *this;
+  }
+  String &operator+=(const char *rhs) {
+    s += rhs;
+    return *this;
+  }
+  String &operator+=(char c) {
+    s += c;
+    return *this;
+  }
+
+  bool operator==(const String &rhs) const { return s == rhs.s; }
+  bool operator==(const char *rhs) const { return s == rhs; }
+  bool operator!=(const String &rhs) const { return s != rhs.s; }
+  bool operator!=(const char *rhs) const { return s != rhs; }
+  char operator[](unsigned int index) const { return s[index]; }
+
+  int indexOf(const char *str, unsigned int fromIndex = 0) const;
+  int indexOf(char c, unsigned int fromIndex = 0) const;
+  String substring(unsigned int beginIndex) const;
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+  bool startsWith(const char *prefix) const;
+  bool endsWith(const char *suffix) const;
+  long toInt() const;
+  void trim();
+
+private:
+  std::string s;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+
+#endif // HOST_WSTRING_H
@@ -0,0 +1,12 @@
+#ifndef HOST_ESP_ATTR_H
+#define HOST_ESP_ATTR_H
+
+// Host stand-in for ESP-IDF memory placement attributes. There is no RTC
+// memory on the host: retained variables are ordinary globals, which is
+// enough because the host build never wakes from deep sleep (see
+// esp_sleep.h).
+
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+#endif // HOST_ESP_ATTR_H
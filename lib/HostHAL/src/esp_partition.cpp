@@ -0,0 +1,121 @@
+#include "esp_partition.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct HostPartition {
+  esp_partition_t info;
+  std::vector<uint8_t> data;
+  std::string backingFile;
+  unsigned long eraseCount = 0;
+};
+
+static std::vector<HostPartition *> partitions;
+
+static HostPartition *lookup(const esp_partition_t *partition) {
+  for (HostPartition *p : partitions) {
+    if (&p->info == partition)
+      return p;
+  }
+  return nullptr;
+}
+
+static HostPartition *lookup(const char *label) {
+  for (HostPartition *p : partitions) {
+    if (!strcmp(p->info.label, label))
+      return p;
+  }
+  return nullptr;
+}
+
+static void save(HostPartition *p) {
+  if (p->backingFile.empty())
+    return;
+  FILE *file = fopen(p->backingFile.c_str(), "wb");
+  if (file) {
+    fwrite(p->data.data(), 1, p->data.size(), file);
+    fclose(file);
+  }
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char *label) {
+  (void)subtype;
+  for (HostPartition *p : partitions) {
+    if (p->info.type == type && (!label || !strcmp(p->info.label, label)))
+      return &p->info;
+  }
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition,
+                             size_t src_offset, void *dst, size_t size) {
+  HostPartition *p = lookup(partition);
+  if (!p || src_offset + size > p->data.size())
+    return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, &p->data[src_offset], size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition,
+                              size_t dst_offset, const void *src, size_t size) {
+  HostPartition *p = lookup(partition);
+  if (!p || dst_offset + size > p->data.size())
+    return ESP_ERR_INVALID_SIZE;
+  const uint8_t *bytes = (const uint8_t *)src;
+  for (size_t i = 0; i < size; i++) {
+    p->data[dst_offset + i] &= bytes[i]; // NOR: program clears bits only
+  }
+  save(p);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition,
+                                    size_t offset, size_t size) {
+  HostPartition *p = lookup(partition);
+  if (!p || offset % SPI_FLASH_SEC_SIZE || size % SPI_FLASH_SEC_SIZE ||
+      offset + size > p->data.size())
+    return ESP_ERR_INVALID_ARG;
+  memset(&p->data[offset], 0xFF, size);
+  p->eraseCount += size / SPI_FLASH_SEC_SIZE;
+  save(p);
+  return ESP_OK;
+}
+
+namespace hostflash {
+
+void addPartition(const char *label, uint32_t size) {
+  HostPartition *p = new HostPartition();
+  p->info.type = ESP_PARTITION_TYPE_DATA;
+  p->info.subtype = ESP_PARTITION_SUBTYPE_ANY;
+  p->info.address = 0;
+  p->info.size = size;
+  snprintf(p->info.label, sizeof(p->info.label), "%s", label);
+  p->info.encrypted = false;
+  p->data.assign(size, 0xFF);
+  partitions.push_back(p);
+}
+
+bool setBackingFile(const char *label, const char *path) {
+  HostPartition *p = lookup(label);
+  if (!p)
+    return false;
+  p->backingFile = path;
+  FILE *file = fopen(path, "rb");
+  if (file) {
+    size_t n = fread(p->data.data(), 1, p->data.size(), file);
+    (void)n;
+    fclose(file);
+  }
+  return true;
+}
+
+unsigned long getEraseCount(const char *label) {
+  HostPartition *p = lookup(label);
+  return p ? p->eraseCount : 0;
+}
+
+} // namespace hostflash
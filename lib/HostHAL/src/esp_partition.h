@@ -0,0 +1,53 @@
+#ifndef HOST_ESP_PARTITION_H
+#define HOST_ESP_PARTITION_H
+
+// Host stand-in for the ESP-IDF partition API, backed by RAM (optionally
+// mirrored to a file so a "reboot" can be replayed). Enforces NOR flash
+// semantics: writes can only clear bits, erase works on 4 KB sectors.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum {
+  ESP_PARTITION_TYPE_APP = 0x00,
+  ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+  ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+  bool encrypted;
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition,
+                             size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition,
+                              size_t dst_offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition,
+                                    size_t offset, size_t size);
+
+namespace hostflash {
+
+// Data partitions available to esp_partition_find_first()
+void addPartition(const char *label, uint32_t size);
+// Load the partition image from path (if present) and save it on every change
+bool setBackingFile(const char *label, const char *path);
+unsigned long getEraseCount(const char *label);
+
+} // namespace hostflash
+
+#endif // HOST_ESP_PARTITION_H
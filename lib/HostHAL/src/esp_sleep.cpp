@@ -0,0 +1,41 @@
+#include "esp_sleep.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "host_clock.h"
+
+static uint64_t timerWakeupUs = 0;
+static esp_sleep_wakeup_cause_t wakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+  timerWakeupUs = time_in_us;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t gpio_num, int level) {
+  // No GPIOs on the host: the pin never fires
+  (void)gpio_num;
+  (void)level;
+  return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start(void) {
+  if (timerWakeupUs == 0)
+    return ESP_ERR_INVALID_ARG;
+  hostclock::delay((unsigned long)(timerWakeupUs / 1000));
+  wakeupCause = ESP_SLEEP_WAKEUP_TIMER;
+  return ESP_OK;
+}
+
+void esp_deep_sleep_start(void) {
+  fflush(stdout);
+  fprintf(stderr,
+          "\n=== deep sleep at %lu ms for %llu ms: host run ends ===\n",
+          hostclock::millis(), (unsigned long long)(timerWakeupUs / 1000));
+  exit(0);
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void) {
+  return wakeupCause;
+}
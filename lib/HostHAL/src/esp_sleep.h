@@ -0,0 +1,27 @@
+#ifndef HOST_ESP_SLEEP_H
+#define HOST_ESP_SLEEP_H
+
+// Host stand-in for the ESP-IDF sleep API. Light sleep passes simulated
+// time up to the timer wake-up (peers keep running, as the modem and GPS
+// do on the board). Deep sleep would restart the firmware; the host run
+// reports it and ends there.
+
+#include <cstdint>
+
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+typedef enum {
+  ESP_SLEEP_WAKEUP_UNDEFINED = 0, // Reset or power-up, not a wake-up
+  ESP_SLEEP_WAKEUP_EXT0 = 2,
+  ESP_SLEEP_WAKEUP_TIMER = 4,
+} esp_sleep_wakeup_cause_t;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t gpio_num, int level);
+esp_err_t esp_light_sleep_start(void);
+[[noreturn]] void esp_deep_sleep_start(void);
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void);
+
+#endif // HOST_ESP_SLEEP_H
@@ -0,0 +1,11 @@
+#include "esp_system.h"
+
+static esp_reset_reason_t resetReason = ESP_RST_POWERON;
+
+esp_reset_reason_t esp_reset_reason(void) { return resetReason; }
+
+namespace hostsystem {
+
+void setResetReason(esp_reset_reason_t reason) { resetReason = reason; }
+
+} // namespace hostsystem
@@ -0,0 +1,28 @@
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+// Host stand-in for esp_reset_reason(). A run is a power-up unless
+// host_main simulates a reboot with the modem left running (--warm).
+
+typedef enum {
+  ESP_RST_UNKNOWN = 0,
+  ESP_RST_POWERON = 1,
+  ESP_RST_EXT = 2,
+  ESP_RST_SW = 3,
+  ESP_RST_PANIC = 4,
+  ESP_RST_INT_WDT = 5,
+  ESP_RST_TASK_WDT = 6,
+  ESP_RST_WDT = 7,
+  ESP_RST_DEEPSLEEP = 8,
+  ESP_RST_BROWNOUT = 9,
+} esp_reset_reason_t;
+
+esp_reset_reason_t esp_reset_reason(void);
+
+namespace hostsystem {
+
+void setResetReason(esp_reset_reason_t reason);
+
+} // namespace hostsystem
+
+#endif // HOST_ESP_SYSTEM_H
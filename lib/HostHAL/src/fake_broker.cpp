@@ -0,0 +1,269 @@
+#include "fake_broker.h"
+
+#include "host_clock.h"
+
+#define PUBACK_TAG 0x10000 // Down segment carries the PUBACK for the id
+
+FakeBroker::FakeBroker(const LinkProfile &profile)
+    : profile(profile), rng(gprslink::seedState(profile.seed)) {}
+
+bool FakeBroker::accept(HostLink *link) {
+  Connection *connection = new Connection();
+  connection->link = link;
+  unsigned long oneWayMs = profile.rttMs / 2;
+  unsigned long rtoMs = profile.rttMs * 2;
+  connection->up.configure(oneWayMs, profile.upBytesPerS, profile.lossPercent,
+                           rtoMs, &rng);
+  connection->down.configure(oneWayMs, profile.downBytesPerS,
+                             profile.lossPercent, rtoMs, &rng);
+  if (profile.dropMeanMs > 0) {
+    connection->dropAtMs = hostclock::millis() +
+                           gprslink::randomInterval(rng, profile.dropMeanMs);
+  }
+  connections.push_back(connection);
+  return true;
+}
+
+void FakeBroker::addLinkStats(const Connection &connection,
+                              BrokerStats &into) const {
+  into.bytesUp += connection.up.getBytes();
+  into.bytesDown += connection.down.getBytes();
+  into.segmentsUp += connection.up.getSegments();
+  into.segmentsDown += connection.down.getSegments();
+  into.segmentsLost += connection.up.getLost() + connection.down.getLost();
+}
+
+BrokerStats FakeBroker::getStats() const {
+  BrokerStats total = stats;
+  for (const Connection *connection : connections) {
+    addLinkStats(*connection, total);
+  }
+  return total;
+}
+
+void FakeBroker::close(Connection &connection) {
+  addLinkStats(connection, stats);
+  connection.up.clear();
+  connection.down.clear();
+  connection.link->open = false;
+}
+
+void FakeBroker::dropConnections() {
+  for (Connection *connection : connections) {
+    stats.linkDrops++;
+    close(*connection);
+    delete connection;
+  }
+  connections.clear();
+}
+
+bool FakeBroker::takeDeliveredAck(uint16_t &packetId, unsigned long &ms) {
+  if (deliveredAcks.empty())
+    return false;
+  packetId = deliveredAcks.front().packetId;
+  ms = deliveredAcks.front().ms;
+  deliveredAcks.pop_front();
+  return true;
+}
+
+void FakeBroker::send(Connection &connection, unsigned long nowMs,
+                      const uint8_t *packet, size_t len, uint32_t tag) {
+  connection.down.send(nowMs, packet, len, tag);
+}
+
+void FakeBroker::poll(unsigned long nowMs) {
+  for (size_t i = 0; i < connections.size();) {
+    Connection &connection = *connections[i];
+    HostLink *link = connection.link;
+
+    bool keep = link->open;
+    if (keep && connection.dropAtMs && nowMs >= connection.dropAtMs) {
+      stats.linkDrops++;
+      keep = false;
+    }
+    // MQTT 3.1.1: one and a half keep-alive periods without a packet
+    if (keep && connection.connected && connection.keepAliveMs > 0 &&
+        nowMs - connection.lastPacketMs > connection.keepAliveMs * 3 / 2) {
+      stats.keepAliveExpired++;
+      keep = false;
+    }
+
+    if (keep && !link->toServer.empty()) {
+      std::string written(link->toServer.begin(), link->toServer.end());
+      link->toServer.clear();
+      connection.up.send(nowMs, (const uint8_t *)written.data(),
+                         written.size());
+    }
+    std::string segment;
+    uint32_t tag;
+    while (keep && connection.up.receive(nowMs, segment, tag)) {
+      connection.inbound += segment;
+      keep = handlePackets(connection, nowMs);
+    }
+    while (keep && connection.down.receive(nowMs, segment, tag)) {
+      link->toClient.insert(link->toClient.end(), segment.begin(),
+                            segment.end());
+      if (tag & PUBACK_TAG) {
+        deliveredAcks.push_back({(uint16_t)tag, nowMs});
+      }
+    }
+
+    if (keep) {
+      i++;
+    } else {
+      close(connection);
+      delete &connection;
+      connections.erase(connections.begin() + i);
+    }
+  }
+}
+
+bool FakeBroker::handlePackets(Connection &connection, unsigned long nowMs) {
+  const std::string &in = connection.inbound;
+  size_t pos = 0;
+  while (in.size() - pos >= 2) {
+    // Remaining length: up to four bytes, seven bits each
+    uint32_t length = 0;
+    uint32_t multiplier = 1;
+    size_t at = pos + 1;
+    bool complete = false;
+    while (at < in.size() && at < pos + 5) {
+      uint8_t digit = (uint8_t)in[at++];
+      length += (digit & 0x7F) * multiplier;
+      multiplier <<= 7;
+      if (!(digit & 0x80)) {
+        complete = true;
+        break;
+      }
+    }
+    if (!complete) {
+      if (at >= pos + 5)
+        return false; // Malformed length
+      break;
+    }
+    if (in.size() - at < length)
+      break;
+    if (!handle(connection, nowMs, (uint8_t)in[pos],
+                (const uint8_t *)in.data() + at, length))
+      return false;
+    pos = at + length;
+  }
+  connection.inbound.erase(0, pos);
+  return true;
+}
+
+bool FakeBroker::handle(Connection &connection, unsigned long nowMs,
+                        uint8_t header, const uint8_t *body, size_t len) {
+  uint8_t type = header >> 4;
+  connection.lastPacketMs = nowMs;
+  if (!connection.connected && type != 1)
+    return false; // Anything before CONNECT is a protocol violation
+
+  switch (type) {
+  case 1: { // CONNECT
+    if (connection.connected || len < 12)
+      return false;
+    size_t p = 2 + ((body[0] << 8) | body[1]); // Past the protocol name
+    if (p + 6 > len)
+      return false;
+    uint8_t flags = body[p + 1];
+    connection.keepAliveMs = ((body[p + 2] << 8) | body[p + 3]) * 1000UL;
+    size_t idLength = (body[p + 4] << 8) | body[p + 5];
+    if (p + 6 + idLength > len)
+      return false;
+    connection.clientId.assign((const char *)body + p + 6, idLength);
+
+    bool cleanSession = flags & 0x02;
+    bool present = false;
+    if (cleanSession) {
+      sessions.erase(connection.clientId);
+    } else {
+      present = sessions.count(connection.clientId) > 0;
+    }
+    sessions[connection.clientId]; // Created for the connection's lifetime
+    connection.connected = true;
+    stats.connects++;
+    if (present)
+      stats.sessionsResumed++;
+
+    uint8_t connack[] = {0x20, 0x02, (uint8_t)(present ? 1 : 0), 0x00};
+    send(connection, nowMs, connack, sizeof(connack));
+    return true;
+  }
+
+  case 3: { // PUBLISH
+    uint8_t qos = (header >> 1) & 0x03;
+    if (len < 2 || qos > 1)
+      return false;
+    size_t topicLength = (body[0] << 8) | body[1];
+    size_t p = 2 + topicLength;
+    uint16_t packetId = 0;
+    if (qos > 0) {
+      if (p + 2 > len)
+        return false;
+      packetId = (body[p] << 8) | body[p + 1];
+      p += 2;
+    }
+    if (p > len)
+      return false;
+    std::string topic((const char *)body + 2, topicLength);
+    std::string payload((const char *)body + p, len - p);
+    stats.publishes++;
+
+    Session &session = sessions[connection.clientId];
+    auto delivered = session.delivered.find(packetId);
+    if (qos > 0 && delivered != session.delivered.end() &&
+        delivered->second == payload) {
+      stats.duplicates++;
+    } else {
+      if (qos > 0)
+        session.delivered[packetId] = payload;
+      messages.push_back({topic, payload, packetId, nowMs});
+    }
+
+    if (qos > 0) {
+      uint8_t puback[] = {0x40, 0x02, (uint8_t)(packetId >> 8),
+                          (uint8_t)packetId};
+      send(connection, nowMs, puback, sizeof(puback), PUBACK_TAG | packetId);
+    }
+    return true;
+  }
+
+  case 8: { // SUBSCRIBE: granted at QoS 0 or 1
+    if (len < 2)
+      return false;
+    std::string suback = {(char)0x90, 0, (char)body[0], (char)body[1]};
+    size_t p = 2;
+    while (p + 2 <= len) {
+      size_t filterLength = (body[p] << 8) | body[p + 1];
+      p += 2 + filterLength;
+      if (p >= len)
+        return false;
+      suback += (char)(body[p++] ? 1 : 0);
+    }
+    suback[1] = (char)(suback.size() - 2);
+    send(connection, nowMs, (const uint8_t *)suback.data(), suback.size());
+    return true;
+  }
+
+  case 10: { // UNSUBSCRIBE
+    if (len < 2)
+      return false;
+    uint8_t unsuback[] = {0xB0, 0x02, body[0], body[1]};
+    send(connection, nowMs, unsuback, sizeof(unsuback));
+    return true;
+  }
+
+  case 12: { // PINGREQ
+    uint8_t pingresp[] = {0xD0, 0x00};
+    send(connection, nowMs, pingresp, sizeof(pingresp));
+    return true;
+  }
+
+  case 14: // DISCONNECT
+    return false;
+
+  default: // PUBACK and the rest: nothing to answer
+    return true;
+  }
+}
@@ -0,0 +1,97 @@
+#ifndef HOST_FAKE_BROKER_H
+#define HOST_FAKE_BROKER_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gprs_link.h"
+#include "host_network.h"
+
+struct BrokerMessage {
+  std::string topic;
+  std::string payload;
+  uint16_t packetId;       // 0 at QoS 0
+  unsigned long arrivedMs; // Last byte reached the broker
+};
+
+struct BrokerStats {
+  unsigned long connects = 0;
+  unsigned long sessionsResumed = 0; // CONNACK with session present
+  unsigned long publishes = 0;       // Including duplicates
+  unsigned long duplicates = 0;      // QoS 1 resends already delivered
+  unsigned long linkDrops = 0;       // Resets injected by the profile
+  unsigned long keepAliveExpired = 0;
+  unsigned long bytesUp = 0; // MQTT bytes, device to broker
+  unsigned long bytesDown = 0;
+  unsigned long segmentsUp = 0;
+  unsigned long segmentsDown = 0;
+  unsigned long segmentsLost = 0;
+};
+
+// MQTT 3.1.1 broker on the far side of a shaped GPRS link, registered
+// with hostnet::listen() in place of MQTT_BROKER. Handles what the
+// firmware sends: CONNECT (with a persistent session when cleanSession is
+// false), PUBLISH at QoS 0 and 1, SUBSCRIBE, PINGREQ and DISCONNECT.
+// Messages are kept once; a QoS 1 resend with a packet identifier and
+// payload already delivered in the session is counted as a duplicate.
+class FakeBroker : public HostServer {
+public:
+  explicit FakeBroker(const LinkProfile &profile = LinkProfile());
+
+  bool accept(HostLink *link) override;
+  void poll(unsigned long nowMs) override;
+
+  // Reset every open connection now, as a cell reselection would
+  void dropConnections();
+
+  // Next PUBACK that reached the device, and when
+  bool takeDeliveredAck(uint16_t &packetId, unsigned long &ms);
+
+  const std::vector<BrokerMessage> &getMessages() const { return messages; }
+  // Totals over closed and open connections
+  BrokerStats getStats() const;
+
+private:
+  struct Connection {
+    HostLink *link;
+    ShapedPipe up;
+    ShapedPipe down;
+    std::string inbound; // Shaped bytes not yet a whole packet
+    std::string clientId;
+    bool connected = false;
+    unsigned long keepAliveMs = 0;
+    unsigned long lastPacketMs = 0;
+    unsigned long dropAtMs = 0; // 0: no reset scheduled
+  };
+
+  // What a persistent session remembers between connections
+  struct Session {
+    std::map<uint16_t, std::string> delivered; // Packet id, payload
+  };
+
+  struct DeliveredAck {
+    uint16_t packetId;
+    unsigned long ms;
+  };
+
+  void addLinkStats(const Connection &connection, BrokerStats &into) const;
+  void close(Connection &connection);
+  void send(Connection &connection, unsigned long nowMs,
+            const uint8_t *packet, size_t len, uint32_t tag = 0);
+  // Parse whole packets out of connection.inbound; false closes it
+  bool handlePackets(Connection &connection, unsigned long nowMs);
+  bool handle(Connection &connection, unsigned long nowMs, uint8_t header,
+              const uint8_t *body, size_t len);
+
+  LinkProfile profile;
+  uint32_t rng;
+  std::vector<Connection *> connections;
+  std::map<std::string, Session> sessions;
+  std::vector<BrokerMessage> messages;
+  std::deque<DeliveredAck> deliveredAcks;
+  BrokerStats stats;
+};
+
+#endif // HOST_FAKE_BROKER_H
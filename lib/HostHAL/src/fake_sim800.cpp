@@ -0,0 +1,254 @@
+#include "fake_sim800.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "host_clock.h"
+#include "host_network.h"
+
+// AT+CSCLK=2: the module sleeps once its UART has been idle this long
+#define SLEEP_IDLE_MS 5000
+
+FakeSim800::FakeSim800(const FakeSim800Config &config) : config(config) {
+  if (config.running) {
+    modemBaud = config.runningBaud;
+    this->config.registrationMs = 0;
+    wasRegistered = true;
+    cregMode = 1;
+    echo = false;
+    attached = true;
+    bearerUp = true;
+  }
+}
+
+bool FakeSim800::isRegistered() const {
+  return nowMs >= config.registrationMs && nowMs >= unregisteredUntilMs &&
+         config.signalQuality > 0 && config.signalQuality != 99;
+}
+
+void FakeSim800::loseRegistration(unsigned long forMs) {
+  unregisteredUntilMs = nowMs + forMs;
+  attached = false;
+  bearerUp = false;
+  hostnet::dropAll();
+  queue("\r\n0, CLOSED\r\n\r\n+PDP: DEACT\r\n", 0);
+}
+
+void FakeSim800::restart() {
+  cregMode = 0;
+  sleepMode = 0;
+  attached = false;
+  bearerUp = false;
+  rxGetManual = false;
+  echo = true;
+  hostnet::dropAll();
+}
+
+void FakeSim800::reset() {
+  restart();
+  modemBaud = SIM800_DEFAULT_BAUD;
+  pendingBaud = 0;
+  lineBuffer.clear();
+  followUp.clear();
+  replies.clear();
+  wire.clear();
+}
+
+void FakeSim800::queue(const std::string &text, unsigned long delayMs) {
+  replies.push_back({nowMs + delayMs, text});
+}
+
+void FakeSim800::onHostWrite(const uint8_t *data, size_t len) {
+  // Framing errors on a baud mismatch: the modem sees garbage
+  if (!baudMatches())
+    return;
+  // Asleep: the character that wakes the module is lost
+  unsigned long now = hostclock::millis();
+  size_t i = 0;
+  if (sleepMode == 2 && len > 0 && now - lastHostWriteMs >= SLEEP_IDLE_MS) {
+    sleepWakeUps++;
+    i = 1;
+  }
+  lastHostWriteMs = now;
+  for (; i < len; i++) {
+    char c = (char)data[i];
+    if (echo) {
+      wire.push_back((uint8_t)c);
+    }
+    if (c == '\r') {
+      handleLine(lineBuffer);
+      lineBuffer.clear();
+    } else if (c != '\n') {
+      lineBuffer += c;
+    }
+  }
+}
+
+void FakeSim800::handleLine(const std::string &line) {
+  if (line.size() < 2 || (line[0] != 'A' && line[0] != 'a') ||
+      (line[1] != 'T' && line[1] != 't')) {
+    return;
+  }
+  commandCount++;
+
+  std::string reply;
+  bool ok = true;
+  std::string rest = line.substr(2);
+  size_t pos = 0;
+  do {
+    size_t end = rest.find(';', pos);
+    std::string cmd = rest.substr(pos, end == std::string::npos
+                                           ? std::string::npos
+                                           : end - pos);
+    // Joined commands drop the "AT" prefix after the first one
+    if (cmd.size() > 1 && (cmd[0] == 'A' || cmd[0] == 'a') &&
+        (cmd[1] == 'T' || cmd[1] == 't'))
+      cmd = cmd.substr(2);
+    std::string body;
+    ok = execute(cmd, body);
+    reply += body;
+    if (!ok)
+      break;
+    pos = end == std::string::npos ? rest.size() : end + 1;
+  } while (pos < rest.size());
+
+  if (!ok) {
+    reply += "\r\nERROR\r\n";
+  } else if (reply.find("SHUT OK") == std::string::npos &&
+             !(rest == "+CIFSR")) {
+    reply += "\r\nOK\r\n";
+  }
+  queue(reply, config.responseLatencyMs);
+  if (!followUp.empty()) {
+    queue(followUp, config.responseLatencyMs + config.connectMs);
+    followUp.clear();
+  }
+}
+
+bool FakeSim800::execute(const std::string &cmd, std::string &body) {
+  char line[96];
+
+  if (cmd.empty() || cmd == "E1") {
+    echo = cmd.empty() ? echo : true;
+  } else if (cmd == "E0") {
+    echo = false;
+  } else if (cmd == "I") {
+    body += "\r\nSIM800 R14.18\r\n";
+  } else if (cmd == "+CPIN?") {
+    if (!config.simReady) {
+      body += "\r\n+CME ERROR: 10\r\n";
+      return false;
+    }
+    body += "\r\n+CPIN: READY\r\n";
+  } else if (cmd == "+CSQ") {
+    snprintf(line, sizeof(line), "\r\n+CSQ: %d,0\r\n", config.signalQuality);
+    body += line;
+  } else if (cmd == "+CREG?") {
+    snprintf(line, sizeof(line), "\r\n+CREG: %d,%d\r\n", cregMode,
+             isRegistered() ? 1 : 2);
+    body += line;
+  } else if (cmd.compare(0, 7, "+CSCLK=") == 0) {
+    sleepMode = atoi(cmd.c_str() + 7);
+  } else if (cmd.compare(0, 6, "+CREG=") == 0) {
+    cregMode = atoi(cmd.c_str() + 6);
+  } else if (cmd == "+COPS?") {
+    if (isRegistered()) {
+      snprintf(line, sizeof(line), "\r\n+COPS: 0,0,\"%s\"\r\n",
+               config.operatorName);
+    } else {
+      snprintf(line, sizeof(line), "\r\n+COPS: 0\r\n");
+    }
+    body += line;
+  } else if (cmd == "+CGATT?") {
+    snprintf(line, sizeof(line), "\r\n+CGATT: %d\r\n", attached ? 1 : 0);
+    body += line;
+  } else if (cmd == "+CGATT=1") {
+    if (!isRegistered())
+      return false;
+    attached = true;
+  } else if (cmd == "+CGATT=0") {
+    attached = false;
+    bearerUp = false;
+  } else if (cmd == "+CIPSHUT") {
+    bearerUp = false;
+    hostnet::dropAll();
+    body += "\r\nSHUT OK\r\n";
+  } else if (cmd == "+CIICR") {
+    if (!attached)
+      return false;
+    bearerUp = true;
+  } else if (cmd == "+CIFSR") {
+    if (!bearerUp)
+      return false;
+    body += "\r\n";
+    body += config.localIP;
+    body += "\r\n";
+  } else if (cmd.compare(0, 10, "+CIPSTART=") == 0) {
+    if (!bearerUp)
+      return false;
+    // OK now, the connection result once the TCP handshake is done
+    followUp = "\r\n" + cmd.substr(10, 1) + ", CONNECT OK\r\n";
+  } else if (cmd == "+CIPSTATUS") {
+    body += bearerUp ? "\r\nSTATE: IP STATUS\r\n" : "\r\nSTATE: IP INITIAL\r\n";
+  } else if (cmd.compare(0, 5, "+IPR=") == 0) {
+    pendingBaud = strtoul(cmd.c_str() + 5, nullptr, 10);
+  } else if (cmd.compare(0, 10, "+CIPRXGET=") == 0) {
+    rxGetManual = atoi(cmd.c_str() + 10) == 1;
+  } else if (cmd == "+CFUN=1,1") {
+    restart();
+  }
+  // Everything else (+CSTT, +CIPMUX, +CSCLK, ...) is accepted
+  return true;
+}
+
+void FakeSim800::pump(unsigned long now, HardwareSerial &port) {
+  nowMs = now;
+
+  // Registration changes are reported once AT+CREG=1 is set
+  bool registered = isRegistered();
+  if (registered != wasRegistered) {
+    wasRegistered = registered;
+    if (cregMode > 0)
+      queue(registered ? "\r\n+CREG: 1\r\n" : "\r\n+CREG: 2\r\n", 0);
+  }
+
+  // In manual receive mode data arriving on an idle socket is announced
+  // once; the host client still reads the link directly
+  for (HostLink *link : hostnet::allLinks()) {
+    if (!link->open || link->toClient.empty()) {
+      link->dataAnnounced = false;
+    } else if (rxGetManual && !link->dataAnnounced) {
+      link->dataAnnounced = true;
+      queue("\r\n+CIPRXGET: 1,0\r\n", 0);
+    }
+  }
+
+  while (!replies.empty() && replies.front().dueMs <= now) {
+    const std::string &text = replies.front().text;
+    wire.insert(wire.end(), text.begin(), text.end());
+    replies.pop_front();
+  }
+
+  // 10 bits per byte on the wire
+  txBudgetMilliBytes += (now - lastPumpMs) * modemBaud / 10;
+  lastPumpMs = now;
+  uint8_t chunk[64];
+  while (!wire.empty() && txBudgetMilliBytes >= 1000) {
+    size_t n = 0;
+    while (n < sizeof(chunk) && !wire.empty() && txBudgetMilliBytes >= 1000) {
+      chunk[n++] = wire.front();
+      wire.pop_front();
+      txBudgetMilliBytes -= 1000;
+    }
+    if (baudMatches())
+      port.inject(chunk, n);
+  }
+  if (wire.empty()) {
+    // An idle line does not bank transmit time
+    txBudgetMilliBytes = 0;
+    if (pendingBaud && replies.empty()) {
+      modemBaud = pendingBaud;
+      pendingBaud = 0;
+    }
+  }
+}
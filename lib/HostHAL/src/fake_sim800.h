@@ -0,0 +1,87 @@
+#ifndef HOST_FAKE_SIM800_H
+#define HOST_FAKE_SIM800_H
+
+#include <deque>
+#include <string>
+
+#include "HardwareSerial.h"
+
+#define SIM800_DEFAULT_BAUD 9600 // After power-up or reset
+
+struct FakeSim800Config {
+  bool simReady = true;
+  int signalQuality = 18;            // +CSQ value, 99 = no antenna
+  unsigned long registrationMs = 8000; // Time from power-up to +CREG: 0,1
+  unsigned long responseLatencyMs = 20; // Command to first response byte
+  unsigned long connectMs = 300;        // AT+CIPSTART to CONNECT OK
+  const char *operatorName = "HOST-NET";
+  const char *localIP = "10.64.0.2";
+  // Already up when the run starts (only the ESP32 rebooted): registered,
+  // attached, bearer open, echo off, at runningBaud
+  bool running = false;
+  unsigned long runningBaud = 115200;
+};
+
+// Scripted SIM800L on the far side of the GSM UART. Answers the AT
+// commands the firmware issues, echoes like the real module (ATE1 after
+// power-up) and paces its replies at the configured baud rate.
+class FakeSim800 : public SerialPeer {
+public:
+  explicit FakeSim800(const FakeSim800Config &config = FakeSim800Config());
+
+  void onBaudRate(unsigned long baud) override { hostBaud = baud; }
+  void onHostWrite(const uint8_t *data, size_t len) override;
+  void pump(unsigned long nowMs, HardwareSerial &port) override;
+
+  // Network-side events for scripted scenarios
+  void loseRegistration(unsigned long forMs);
+
+  // RST pulled low: everything since power-up is forgotten, including
+  // the AT+IPR rate (not saved without AT&W) and replies not yet sent
+  void reset();
+  void setSignalQuality(int csq) { config.signalQuality = csq; }
+
+  unsigned long getCommandCount() const { return commandCount; }
+  // Times a host write found the module asleep (AT+CSCLK=2)
+  unsigned long getSleepWakeUps() const { return sleepWakeUps; }
+
+private:
+  struct Reply {
+    unsigned long dueMs;
+    std::string text;
+  };
+
+  void handleLine(const std::string &line);
+  // Runs one command of a ';'-joined line; returns false on ERROR
+  bool execute(const std::string &cmd, std::string &body);
+  bool isRegistered() const;
+  // Settings that do not survive a reboot (AT+CFUN=1,1 or RST)
+  void restart();
+  bool baudMatches() const { return modemBaud == hostBaud; }
+  void queue(const std::string &text, unsigned long delayMs);
+
+  FakeSim800Config config;
+  unsigned long modemBaud = SIM800_DEFAULT_BAUD;
+  unsigned long hostBaud = SIM800_DEFAULT_BAUD;
+  unsigned long nowMs = 0;
+  unsigned long lastPumpMs = 0;
+  unsigned long txBudgetMilliBytes = 0;
+  unsigned long unregisteredUntilMs = 0;
+  unsigned long commandCount = 0;
+  int sleepMode = 0; // AT+CSCLK=<n>
+  unsigned long lastHostWriteMs = 0;
+  unsigned long sleepWakeUps = 0;
+  bool echo = true;
+  int cregMode = 0; // AT+CREG=<n>
+  bool wasRegistered = false;
+  bool attached = false;
+  bool bearerUp = false;
+  bool rxGetManual = false; // AT+CIPRXGET=1: hold socket data, announce it
+  unsigned long pendingBaud = 0;
+  std::string lineBuffer;
+  std::string followUp; // Unsolicited result after the OK (CONNECT OK)
+  std::deque<Reply> replies;
+  std::deque<uint8_t> wire;
+};
+
+#endif // HOST_FAKE_SIM800_H
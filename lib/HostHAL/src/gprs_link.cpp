@@ -0,0 +1,86 @@
+#include "gprs_link.h"
+
+#include <cmath>
+
+namespace gprslink {
+
+uint32_t seedState(uint32_t seed) {
+  // MurmurHash3 finalizer
+  seed ^= seed >> 16;
+  seed *= 0x85EBCA6B;
+  seed ^= seed >> 13;
+  seed *= 0xC2B2AE35;
+  seed ^= seed >> 16;
+  return seed ? seed : 1;
+}
+
+uint32_t random(uint32_t &state) {
+  if (state == 0)
+    state = 1;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+unsigned long randomInterval(uint32_t &state, unsigned long meanMs) {
+  double u = (random(state) + 1.0) / 4294967297.0; // (0, 1)
+  return (unsigned long)(-std::log(u) * meanMs) + 1;
+}
+
+} // namespace gprslink
+
+void ShapedPipe::configure(unsigned long oneWay, unsigned long rate,
+                           unsigned loss, unsigned long rto, uint32_t *state) {
+  oneWayMs = oneWay;
+  bytesPerS = rate;
+  lossPercent = loss;
+  rtoMs = rto < LINK_MIN_RTO_MS ? LINK_MIN_RTO_MS : rto;
+  rng = state;
+}
+
+void ShapedPipe::send(unsigned long nowMs, const uint8_t *data, size_t len,
+                      uint32_t tag) {
+  while (len > 0) {
+    size_t n = len < LINK_MSS ? len : LINK_MSS;
+    len -= n;
+
+    // Serialized behind whatever the bearer is still sending
+    uint64_t startUs = (uint64_t)nowMs * 1000;
+    if (busyUntilUs > startUs)
+      startUs = busyUntilUs;
+    uint64_t airUs =
+        bytesPerS ? (uint64_t)(n + LINK_HEADER_BYTES) * 1000000 / bytesPerS
+                  : 0;
+    busyUntilUs = startUs + airUs;
+
+    unsigned long dueMs = (unsigned long)(busyUntilUs / 1000) + oneWayMs;
+    if (lossPercent > 0 && rng &&
+        gprslink::random(*rng) % 100 < lossPercent) {
+      // Sent again after the RTO, occupying the bearer a second time
+      dueMs += rtoMs;
+      busyUntilUs += airUs;
+      lost++;
+    }
+    if (dueMs < lastDueMs)
+      dueMs = lastDueMs; // In order: waits for the segment ahead
+    lastDueMs = dueMs;
+
+    // The tag goes with the segment holding the message's last byte
+    segments.push_back({dueMs, len == 0 ? tag : 0,
+                        std::string((const char *)data, n)});
+    data += n;
+    bytes += n;
+    segmentCount++;
+  }
+}
+
+bool ShapedPipe::receive(unsigned long nowMs, std::string &out,
+                         uint32_t &tag) {
+  if (segments.empty() || segments.front().dueMs > nowMs)
+    return false;
+  out.swap(segments.front().bytes);
+  tag = segments.front().tag;
+  segments.pop_front();
+  return true;
+}
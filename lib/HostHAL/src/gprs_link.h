@@ -0,0 +1,81 @@
+#ifndef HOST_GPRS_LINK_H
+#define HOST_GPRS_LINK_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#define LINK_MSS 1360          // SIM800 CIPSEND maximum per segment
+#define LINK_HEADER_BYTES 40   // IPv4 + TCP header, no options
+#define LINK_MIN_RTO_MS 1000   // RFC 6298 lower bound
+
+// Radio side of a GPRS data session. The defaults are a CS-2 class 10
+// session on a loaded cell: two uplink and three downlink slots.
+struct LinkProfile {
+  unsigned long rttMs = 700;          // Round trip, half each way
+  unsigned long upBytesPerS = 2500;   // Device to network, 0 = unlimited
+  unsigned long downBytesPerS = 4500; // Network to device, 0 = unlimited
+  unsigned lossPercent = 0;           // Segments resent after an RTO
+  unsigned long dropMeanMs = 0;       // Mean time between resets, 0 = none
+  uint32_t seed = 1;
+};
+
+// One direction of a TCP connection over the link. Bytes leave at the
+// bearer's rate, arrive half an RTT later and in order: a lost segment is
+// resent after the retransmission timeout and holds back the ones behind
+// it, as on a real TCP stream.
+class ShapedPipe {
+public:
+  void configure(unsigned long oneWayMs, unsigned long bytesPerS,
+                 unsigned lossPercent, unsigned long rtoMs, uint32_t *rng);
+
+  // Bytes written at nowMs; tag is handed back with the segment that
+  // carries them (0: none)
+  void send(unsigned long nowMs, const uint8_t *data, size_t len,
+            uint32_t tag = 0);
+
+  // Next segment due by nowMs
+  bool receive(unsigned long nowMs, std::string &bytes, uint32_t &tag);
+
+  // Connection reset: whatever is still in transit is gone
+  void clear() { segments.clear(); }
+
+  unsigned long getBytes() const { return bytes; }
+  unsigned long getSegments() const { return segmentCount; }
+  unsigned long getLost() const { return lost; }
+
+private:
+  struct Segment {
+    unsigned long dueMs;
+    uint32_t tag;
+    std::string bytes;
+  };
+
+  unsigned long oneWayMs = 0;
+  unsigned long bytesPerS = 0;
+  unsigned lossPercent = 0;
+  unsigned long rtoMs = LINK_MIN_RTO_MS;
+  uint32_t *rng = nullptr;
+
+  uint64_t busyUntilUs = 0; // Bearer transmitting until then
+  unsigned long lastDueMs = 0;
+  std::deque<Segment> segments;
+
+  unsigned long bytes = 0;
+  unsigned long segmentCount = 0;
+  unsigned long lost = 0;
+};
+
+namespace gprslink {
+
+// Deterministic xorshift32, so runs with the same seed repeat exactly.
+// seedState() spreads small seeds, whose first outputs are poor.
+uint32_t seedState(uint32_t seed);
+uint32_t random(uint32_t &state);
+
+// Exponentially distributed interval with the given mean
+unsigned long randomInterval(uint32_t &state, unsigned long meanMs);
+
+} // namespace gprslink
+
+#endif // HOST_GPRS_LINK_H
@@ -0,0 +1,82 @@
+#include "host_clock.h"
+
+#include <chrono>
+#include <thread>
+
+namespace hostclock {
+
+static const int MAX_TICK_HOOKS = 8;
+
+static bool realtime = false;
+static uint64_t virtualMicros = 0;
+static uint64_t realtimeEpoch = 0;
+static TickHook tickHooks[MAX_TICK_HOOKS];
+static int tickHookCount = 0;
+
+uint64_t wallMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static uint64_t nowMicros() {
+  return realtime ? wallMicros() - realtimeEpoch : virtualMicros;
+}
+
+static void runTickHooks() {
+  unsigned long now = (unsigned long)(nowMicros() / 1000);
+  for (int i = 0; i < tickHookCount; i++) {
+    tickHooks[i](now);
+  }
+}
+
+void setRealtime(bool enable) {
+  realtime = enable;
+  realtimeEpoch = wallMicros() - virtualMicros;
+}
+
+bool isRealtime() { return realtime; }
+
+unsigned long millis() { return (unsigned long)(nowMicros() / 1000); }
+
+unsigned long micros() { return (unsigned long)nowMicros(); }
+
+void advance(unsigned long ms) {
+  if (!realtime) {
+    virtualMicros += (uint64_t)ms * 1000;
+  }
+  runTickHooks();
+}
+
+void delay(unsigned long ms) {
+  if (realtime) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+  advance(ms);
+}
+
+void delayMicroseconds(unsigned int us) {
+  if (realtime) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  } else {
+    virtualMicros += us;
+  }
+  runTickHooks();
+}
+
+void yield() {
+  if (realtime) {
+    std::this_thread::yield();
+    runTickHooks();
+  } else {
+    advance(1);
+  }
+}
+
+void addTickHook(TickHook hook) {
+  if (tickHookCount < MAX_TICK_HOOKS) {
+    tickHooks[tickHookCount++] = hook;
+  }
+}
+
+} // namespace hostclock
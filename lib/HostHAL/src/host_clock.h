@@ -0,0 +1,37 @@
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <cstdint>
+
+// Time base for the host build.
+//
+// In virtual mode (the default) time only moves when the firmware blocks:
+// delay() jumps forward by the requested amount and yield() - which every
+// busy-wait in the firmware and its libraries calls - advances by one
+// millisecond. Runs are therefore deterministic and as fast as the CPU
+// allows. In realtime mode millis()/delay() follow the host monotonic clock.
+namespace hostclock {
+
+typedef void (*TickHook)(unsigned long nowMs);
+
+void setRealtime(bool realtime);
+bool isRealtime();
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// Move virtual time forward (no-op in realtime mode)
+void advance(unsigned long ms);
+
+// Called whenever time moves, so simulated peers can make progress
+void addTickHook(TickHook hook);
+
+// Host monotonic clock, independent of the simulated one
+uint64_t wallMicros();
+
+} // namespace hostclock
+
+#endif // HOST_CLOCK_H
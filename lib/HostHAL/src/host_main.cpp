@@ -0,0 +1,218 @@
+// Entry point for the native build: wires simulated peers to the firmware
+// UARTs, then runs setup() and loop() until the simulated duration ends.
+//
+//   .pio/build/native/program --gps drive.nmea --duration 600000 --quiet
+//
+// --record writes both UARTs to a capture file; --replay plays one back in
+// place of the simulated receiver and modem (see uart_capture.h). --broker
+// answers MQTT_BROKER with an in-process broker over a GPRS-like link.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Arduino.h"
+#include "config.h"
+#include "esp_partition.h"
+#include "esp_system.h"
+#include "fake_broker.h"
+#include "fake_sim800.h"
+#include "host_network.h"
+#include "metrics.h"
+#include "nmea_replay.h"
+#include "uart_capture.h"
+
+void setup();
+void loop();
+
+static void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [--gps FILE] [--loop-gps] [--duration MS] [--realtime]\n"
+          "          [--quiet] [--registration-ms MS] [--csq N] [--no-sim]\n"
+          "          [--flash FILE] [--outage START_MS:DURATION_MS] [--warm]\n"
+          "          [--record FILE] [--replay FILE] [--broker]\n",
+          program);
+}
+
+int main(int argc, char **argv) {
+  const char *gpsPath = nullptr;
+  bool loopGps = false;
+  unsigned long durationMs = 60000;
+  FakeSim800Config modemConfig;
+  unsigned long outageAt = 0, outageMs = 0;
+  const char *recordPath = nullptr;
+  const char *replayPath = nullptr;
+  bool withBroker = false;
+
+  // Same journal size as partitions.csv
+  hostflash::addPartition(JOURNAL_PARTITION_LABEL, 0x100000);
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(arg, "--gps") && value) {
+      gpsPath = value;
+      i++;
+    } else if (!strcmp(arg, "--loop-gps")) {
+      loopGps = true;
+    } else if (!strcmp(arg, "--duration") && value) {
+      durationMs = strtoul(value, nullptr, 10);
+      i++;
+    } else if (!strcmp(arg, "--realtime")) {
+      hostclock::setRealtime(true);
+    } else if (!strcmp(arg, "--quiet")) {
+      Serial.setQuiet(true);
+    } else if (!strcmp(arg, "--registration-ms") && value) {
+      modemConfig.registrationMs = strtoul(value, nullptr, 10);
+      i++;
+    } else if (!strcmp(arg, "--csq") && value) {
+      modemConfig.signalQuality = atoi(value);
+      i++;
+    } else if (!strcmp(arg, "--no-sim")) {
+      modemConfig.simReady = false;
+    } else if (!strcmp(arg, "--outage") && value) {
+      char *end = nullptr;
+      outageAt = strtoul(value, &end, 10);
+      outageMs = *end == ':' ? strtoul(end + 1, nullptr, 10) : 0;
+      i++;
+    } else if (!strcmp(arg, "--warm")) {
+      // Watchdog reboot: the modem kept its registration and bearer
+      hostsystem::setResetReason(ESP_RST_TASK_WDT);
+      modemConfig.running = true;
+      modemConfig.runningBaud = GSM_BAUD_FAST;
+    } else if (!strcmp(arg, "--record") && value) {
+      recordPath = value;
+      i++;
+    } else if (!strcmp(arg, "--replay") && value) {
+      replayPath = value;
+      i++;
+    } else if (!strcmp(arg, "--broker")) {
+      withBroker = true;
+    } else if (!strcmp(arg, "--flash") && value) {
+      hostflash::setBackingFile(JOURNAL_PARTITION_LABEL, value);
+      i++;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  NmeaReplay gpsReplay;
+  if (gpsPath && !gpsReplay.load(gpsPath)) {
+    fprintf(stderr, "cannot read GPS capture %s\n", gpsPath);
+    return 1;
+  }
+  gpsReplay.setLoop(loopGps);
+  FakeSim800 modem(modemConfig);
+
+  // Both ports from a capture instead of the simulated devices
+  CaptureReplay gpsCapture("gps"), gsmCapture("gsm");
+  if (replayPath &&
+      (!gpsCapture.load(replayPath) || !gsmCapture.load(replayPath))) {
+    fprintf(stderr, "cannot read UART capture %s\n", replayPath);
+    return 1;
+  }
+
+  HardwareSerial *gpsPort = HardwareSerial::port(GPS_UART_NUM);
+  HardwareSerial *gsmPort = HardwareSerial::port(GSM_UART_NUM);
+  if (!gpsPort || !gsmPort) {
+    fprintf(stderr, "firmware did not create the GPS/GSM UARTs\n");
+    return 1;
+  }
+  if (replayPath) {
+    gpsPort->attachPeer(&gpsCapture);
+    gsmPort->attachPeer(&gsmCapture);
+  } else {
+    if (gpsPath)
+      gpsPort->attachPeer(&gpsReplay);
+    gsmPort->attachPeer(&modem);
+  }
+
+  // Deep sleep ends the run through exit(); the capture is closed there too
+  static UartRecorder recorder;
+  if (recordPath) {
+    if (!recorder.open(recordPath)) {
+      fprintf(stderr, "cannot write UART capture %s\n", recordPath);
+      return 1;
+    }
+    recorder.addPort(GPS_UART_NUM, "gps");
+    recorder.addPort(GSM_UART_NUM, "gsm");
+    HardwareSerial::setTap(&recorder);
+    atexit([] { recorder.close(); });
+  }
+  static FakeBroker broker;
+  if (withBroker) {
+    hostnet::listen(MQTT_BROKER, MQTT_PORT, &broker);
+  }
+  hostclock::addTickHook([](unsigned long) { hostnet::poll(); });
+  // The firmware resets the modem by pulling its RST line low
+  static FakeSim800 *resetModem = &modem;
+  if (!replayPath) {
+    hostgpio::addWriteHook([](uint8_t pin, uint8_t val) {
+      if (pin == SIM800L_RESET_PIN && val == LOW)
+        resetModem->reset();
+    });
+  }
+  // Network drops the modem's registration once, mid-run
+  static FakeSim800 *outageModem = &modem;
+  static unsigned long outageStart = outageAt, outageLength = outageMs;
+  if (outageLength > 0 && !replayPath) {
+    hostclock::addTickHook([](unsigned long now) {
+      if (outageLength > 0 && now >= outageStart) {
+        outageModem->loseRegistration(outageLength);
+        outageLength = 0;
+      }
+    });
+  }
+
+  uint64_t wallStart = hostclock::wallMicros();
+  setup();
+  uint64_t loopStart = hostclock::wallMicros();
+  unsigned long loops = 0;
+  while (millis() < durationMs) {
+    loop();
+    loops++;
+  }
+  uint64_t wallEnd = hostclock::wallMicros();
+
+  fprintf(stderr,
+          "\n=== host run summary ===\n"
+          "simulated time:    %lu ms\n"
+          "setup() wall time: %.3f ms\n"
+          "loop() iterations: %lu (%.2f us/iteration wall)\n"
+          "GPS UART:          %lu bytes sent, %lu received, %lu overrun\n"
+          "GSM UART:          %lu AT commands, %lu sleep wake-ups\n",
+          millis(), (loopStart - wallStart) / 1000.0, loops,
+          loops ? (double)(wallEnd - loopStart) / loops : 0.0,
+          gpsReplay.getBytesSent(), gpsPort->getReceivedBytes(),
+          gpsPort->getOverrunBytes(), modem.getCommandCount(),
+          modem.getSleepWakeUps());
+  if (replayPath) {
+    fprintf(stderr, "replay:            %s, %s\n",
+            gpsCapture.hasDiverged() || gsmCapture.hasDiverged()
+                ? "diverged"
+                : "firmware output matched",
+            gpsCapture.finished() && gsmCapture.finished()
+                ? "capture played to the end"
+                : "capture not finished");
+  }
+  if (withBroker) {
+    BrokerStats stats = broker.getStats();
+    fprintf(stderr,
+            "broker:            %lu messages, %lu duplicates, %lu connects, "
+            "%lu bytes up, %lu down\n",
+            (unsigned long)broker.getMessages().size(), stats.duplicates,
+            stats.connects, stats.bytesUp, stats.bytesDown);
+  }
+  fprintf(stderr, "latency (us):      samples p50 p99 max\n");
+  for (int i = 0; i < METRIC_STAGE_COUNT; i++) {
+    LatencySummary summary = metricSummary((MetricStage)i, false);
+    if (summary.count > 0) {
+      fprintf(stderr, "  %-16s %lu %lu %lu %lu\n",
+              metricStageName((MetricStage)i), (unsigned long)summary.count,
+              (unsigned long)summary.p50Us, (unsigned long)summary.p99Us,
+              (unsigned long)summary.maxUs);
+    }
+  }
+  return 0;
+}
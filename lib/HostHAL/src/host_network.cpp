@@ -0,0 +1,60 @@
+#include "host_network.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "host_clock.h"
+
+namespace hostnet {
+
+struct Listener {
+  std::string host;
+  uint16_t port;
+  HostServer *server;
+};
+
+static std::vector<Listener> listeners;
+static std::vector<HostLink *> links;
+
+void listen(const char *host, uint16_t port, HostServer *server) {
+  listeners.push_back({host, port, server});
+}
+
+HostLink *connect(const char *host, uint16_t port) {
+  for (const Listener &listener : listeners) {
+    if (listener.port == port && listener.host == host) {
+      HostLink *link = new HostLink();
+      if (!listener.server->accept(link)) {
+        delete link;
+        return nullptr;
+      }
+      links.push_back(link);
+      return link;
+    }
+  }
+  return nullptr;
+}
+
+void close(HostLink *link) {
+  if (link) {
+    link->open = false;
+  }
+}
+
+void poll() {
+  unsigned long now = hostclock::millis();
+  for (const Listener &listener : listeners) {
+    listener.server->poll(now);
+  }
+}
+
+void dropAll() {
+  for (HostLink *link : links) {
+    link->open = false;
+  }
+}
+
+const std::vector<HostLink *> &allLinks() { return links; }
+
+} // namespace hostnet
@@ -0,0 +1,44 @@
+#ifndef HOST_NETWORK_H
+#define HOST_NETWORK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// In-process stand-in for the TCP sockets the SIM800L opens. A server
+// registers itself under host:port; TinyGsmClient::connect() on the host
+// build gets a HostLink to it instead of a modem socket.
+
+struct HostLink {
+  std::deque<uint8_t> toServer;
+  std::deque<uint8_t> toClient;
+  bool open = true;
+  bool dataAnnounced = false; // Modem sent +CIPRXGET: 1 for toClient
+};
+
+class HostServer {
+public:
+  virtual ~HostServer() {}
+  // A client connected; the server keeps the link until it closes it
+  virtual bool accept(HostLink *link) = 0;
+  // Process pending bytes on all links
+  virtual void poll(unsigned long nowMs) = 0;
+};
+
+namespace hostnet {
+
+void listen(const char *host, uint16_t port, HostServer *server);
+HostLink *connect(const char *host, uint16_t port);
+void close(HostLink *link);
+void poll();
+
+// Drop every open link, as when the modem loses its PDP context
+void dropAll();
+
+// Every link connect() handed out, closed ones included
+const std::vector<HostLink *> &allLinks();
+
+} // namespace hostnet
+
+#endif // HOST_NETWORK_H
@@ -0,0 +1,351 @@
+#include "nmea_replay.h"
+
+#include "host_clock.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+void putU16(std::string &out, unsigned v) {
+  out += (char)(v & 0xFF);
+  out += (char)(v >> 8 & 0xFF);
+}
+
+void putU32(std::string &out, unsigned long v) {
+  putU16(out, v & 0xFFFF);
+  putU16(out, v >> 16 & 0xFFFF);
+}
+
+// NMEA ddmm.mmmm plus hemisphere to signed degrees
+double nmeaDegrees(const std::string &value, const std::string &hemisphere) {
+  if (value.empty())
+    return 0;
+  double raw = atof(value.c_str());
+  int degrees = (int)(raw / 100);
+  double result = degrees + (raw - degrees * 100) / 60.0;
+  return hemisphere == "S" || hemisphere == "W" ? -result : result;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+long daysFromCivil(int y, int m, int d) {
+  y -= m <= 2;
+  long era = (y >= 0 ? y : y - 399) / 400;
+  long yoe = y - era * 400;
+  long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+} // namespace
+
+bool NmeaReplay::load(const char *path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  std::stringstream contents;
+  contents << file.rdbuf();
+  data = contents.str();
+  position = 0;
+  return !data.empty();
+}
+
+void NmeaReplay::onHostWrite(const uint8_t *bytes, size_t len) {
+  // Any activity on its RX line wakes the receiver from backup
+  if (asleep && len > 0) {
+    wake(hostclock::millis());
+    return;
+  }
+  // A receiver at another rate cannot decode what the host sends
+  if (hostBaud != receiverBaud)
+    return;
+
+  for (size_t i = 0; i < len; i++) {
+    uint8_t b = bytes[i];
+    if (command.empty() && b != 0xB5)
+      continue;
+    if (command.size() == 1 && b != 0x62) {
+      command.clear();
+      continue;
+    }
+    command += (char)b;
+    if (command.size() < 6)
+      continue;
+
+    const uint8_t *frame = (const uint8_t *)command.data();
+    size_t length = frame[4] | frame[5] << 8;
+    if (command.size() < length + 8)
+      continue;
+
+    uint8_t ckA = 0, ckB = 0;
+    for (size_t j = 2; j < length + 6; j++) {
+      ckA += frame[j];
+      ckB += ckA;
+    }
+    if (ckA == frame[length + 6] && ckB == frame[length + 7])
+      handleUbx(frame[2], frame[3], frame + 6, length);
+    command.clear();
+  }
+}
+
+void NmeaReplay::wake(unsigned long nowMs) {
+  asleep = false;
+  quietUntilMs = nowMs + hotStartMs; // Hot start: no output until the fix
+  wakeUps++;
+}
+
+void NmeaReplay::handleUbx(uint8_t messageClass, uint8_t messageId,
+                           const uint8_t *payload, size_t length) {
+  // RXM-PMREQ: backup for the given time (0 = until woken), no ACK
+  if (messageClass == 0x02 && messageId == 0x41 && length == 8 &&
+      (payload[4] & 0x02)) {
+    unsigned long duration = payload[0] | payload[1] << 8 |
+                             payload[2] << 16 |
+                             (unsigned long)payload[3] << 24;
+    asleep = true;
+    timedBackup = duration != 0;
+    backupEndMs = hostclock::millis() + duration;
+    return;
+  }
+
+  // CFG-PRT for UART1: new rate right after the frame, no ACK at either;
+  // at the same rate only the protocols change, and that is acknowledged
+  if (messageClass == 0x06 && messageId == 0x00 && length == 20 &&
+      payload[0] == 1) {
+    unsigned long baud = payload[8] | payload[9] << 8 | payload[10] << 16 |
+                         (unsigned long)payload[11] << 24;
+    outProtocols = payload[14] | payload[15] << 8;
+    if (baud != receiverBaud) {
+      receiverBaud = baud;
+      return;
+    }
+  }
+  // CFG-MSG (current port): output rate of one message
+  if (messageClass == 0x06 && messageId == 0x01 && length == 3) {
+    if (payload[0] == 0x01)
+      navRates[payload[1]] = payload[2];
+    else if (payload[0] == 0xF0 && payload[1] < 6)
+      nmeaRates[payload[1]] = payload[2];
+  }
+  // Other configuration is accepted and acknowledged
+  if (messageClass == 0x06) {
+    uint8_t ack[2] = {messageClass, messageId};
+    queueUbx(0x05, 0x01, ack, sizeof(ack));
+  }
+}
+
+void NmeaReplay::queueUbx(uint8_t messageClass, uint8_t messageId,
+                          const uint8_t *payload, size_t length) {
+  std::string frame = {(char)0xB5, (char)0x62, (char)messageClass,
+                       (char)messageId, (char)(length & 0xFF),
+                       (char)(length >> 8)};
+  frame.append((const char *)payload, length);
+  uint8_t ckA = 0, ckB = 0;
+  for (size_t j = 2; j < frame.size(); j++) {
+    ckA += (uint8_t)frame[j];
+    ckB += ckA;
+  }
+  frame += (char)ckA;
+  frame += (char)ckB;
+  replies += frame;
+}
+
+bool NmeaReplay::nmeaEnabled(const std::string &line) const {
+  static const char *const TYPES[] = {"GGA", "GLL", "GSA",
+                                      "GSV", "RMC", "VTG"};
+  if (line.size() < 6)
+    return true;
+  for (size_t id = 0; id < 6; id++) {
+    if (line.compare(3, 3, TYPES[id]) == 0)
+      return nmeaRates[id] != 0;
+  }
+  return true;
+}
+
+void NmeaReplay::handleSentence(const std::string &line) {
+  if (line.size() < 7 || line[0] != '$')
+    return;
+  size_t star = line.find('*');
+  std::vector<std::string> fields;
+  std::stringstream body(line.substr(1, star == std::string::npos
+                                            ? std::string::npos
+                                            : star - 1));
+  std::string field;
+  while (std::getline(body, field, ','))
+    fields.push_back(field);
+  if (fields.empty() || fields[0].size() != 5)
+    return;
+  fields.resize(15);
+  std::string type = fields[0].substr(2);
+
+  auto parseTime = [&](const std::string &value) {
+    if (value.size() < 6)
+      return;
+    epoch.hour = atoi(value.substr(0, 2).c_str());
+    epoch.minute = atoi(value.substr(2, 2).c_str());
+    double seconds = atof(value.c_str() + 4);
+    epoch.second = (int)seconds;
+    epoch.timeOfDayMs =
+        (epoch.hour * 3600UL + epoch.minute * 60UL) * 1000 +
+        (unsigned long)(seconds * 1000 + 0.5);
+    epoch.timeValid = true;
+  };
+
+  if (type == "RMC") {
+    parseTime(fields[1]);
+    if (fields[9].size() == 6) {
+      epoch.day = atoi(fields[9].substr(0, 2).c_str());
+      epoch.month = atoi(fields[9].substr(2, 2).c_str());
+      epoch.year = 2000 + atoi(fields[9].substr(4, 2).c_str());
+      // 1970-01-01 was a Thursday
+      epoch.weekday =
+          (unsigned long)(daysFromCivil(epoch.year, epoch.month, epoch.day) +
+                          4) %
+          7;
+      epoch.dateValid = true;
+    }
+    epoch.speedKnots = atof(fields[7].c_str());
+    epoch.courseDeg = atof(fields[8].c_str());
+  } else if (type == "GGA") {
+    parseTime(fields[1]);
+    epoch.latitude = nmeaDegrees(fields[2], fields[3]);
+    epoch.longitude = nmeaDegrees(fields[4], fields[5]);
+    epoch.quality = atoi(fields[6].c_str());
+    epoch.satellites = atoi(fields[7].c_str());
+    epoch.altitude = atof(fields[9].c_str());
+    emitNavEpoch();
+  }
+}
+
+void NmeaReplay::emitNavEpoch() {
+  if (!(outProtocols & 0x0001))
+    return;
+  unsigned long iTOW = epoch.weekday * 86400000UL + epoch.timeOfDayMs;
+  bool fix = epoch.quality > 0;
+
+  if (navRates[0x02]) { // NAV-POSLLH
+    std::string p;
+    putU32(p, iTOW);
+    putU32(p, (unsigned long)(long)(epoch.longitude * 1e7));
+    putU32(p, (unsigned long)(long)(epoch.latitude * 1e7));
+    putU32(p, (unsigned long)(long)(epoch.altitude * 1000));
+    putU32(p, (unsigned long)(long)(epoch.altitude * 1000));
+    putU32(p, fix ? 2500 : 0xFFFFFFFF);
+    putU32(p, fix ? 4000 : 0xFFFFFFFF);
+    queueUbx(0x01, 0x02, (const uint8_t *)p.data(), p.size());
+  }
+  if (navRates[0x06]) { // NAV-SOL
+    std::string p;
+    putU32(p, iTOW);
+    putU32(p, 0);                // fTOW
+    putU16(p, 0);                // week
+    p += (char)(fix ? 3 : 0);    // gpsFix
+    p += (char)(fix ? 0x0D : 0); // gpsFixOK | WKNSET | TOWSET
+    p.append(28, '\0');          // ECEF position/velocity, pAcc
+    putU32(p, 0);                // sAcc
+    putU16(p, 0);                // pDOP
+    p += '\0';
+    p += (char)epoch.satellites;
+    putU32(p, 0);
+    queueUbx(0x01, 0x06, (const uint8_t *)p.data(), p.size());
+  }
+  if (navRates[0x12]) { // NAV-VELNED
+    double speedCms = epoch.speedKnots * 51.4444;
+    std::string p;
+    putU32(p, iTOW);
+    putU32(p, 0);
+    putU32(p, 0);
+    putU32(p, 0);
+    putU32(p, (unsigned long)speedCms);
+    putU32(p, (unsigned long)speedCms);
+    putU32(p, (unsigned long)(long)(epoch.courseDeg * 1e5));
+    putU32(p, 50);
+    putU32(p, 100000);
+    queueUbx(0x01, 0x12, (const uint8_t *)p.data(), p.size());
+  }
+  if (navRates[0x21]) { // NAV-TIMEUTC
+    bool valid = epoch.dateValid && epoch.timeValid;
+    std::string p;
+    putU32(p, iTOW);
+    putU32(p, 50);
+    putU32(p, (epoch.timeOfDayMs % 1000) * 1000000UL);
+    putU16(p, epoch.year);
+    p += (char)epoch.month;
+    p += (char)epoch.day;
+    p += (char)epoch.hour;
+    p += (char)epoch.minute;
+    p += (char)epoch.second;
+    p += (char)(valid ? 0x07 : 0); // validTOW | validWKN | validUTC
+    queueUbx(0x01, 0x21, (const uint8_t *)p.data(), p.size());
+  }
+}
+
+void NmeaReplay::pump(unsigned long nowMs, HardwareSerial &port) {
+  if (!started) {
+    started = true;
+    lastPumpMs = nowMs;
+    return;
+  }
+
+  budgetMilliBytes += (nowMs - lastPumpMs) * captureBaud / 10;
+  lastPumpMs = nowMs;
+
+  if (asleep && timedBackup && (long)(nowMs - backupEndMs) >= 0)
+    wake(nowMs);
+  // The capture keeps playing while the receiver is off: time passes
+  bool quiet = asleep || (long)(nowMs - quietUntilMs) < 0;
+
+  if (!replies.empty() && hostBaud == receiverBaud) {
+    port.inject((const uint8_t *)replies.data(), replies.size());
+    replies.clear();
+  }
+
+  while (budgetMilliBytes >= 1000 && !data.empty()) {
+    if (position >= data.size()) {
+      if (!loop) {
+        budgetMilliBytes = 0;
+        return;
+      }
+      position = 0;
+    }
+    size_t n = budgetMilliBytes / 1000;
+    if (n > data.size() - position)
+      n = data.size() - position;
+    // Enabled NMEA sentences as captured and/or UBX re-encoded at each
+    // epoch end; output goes out a whole line at a time
+    std::string output;
+    for (size_t i = position; i < position + n; i++) {
+      char ch = data[i];
+      if (ch != '\n') {
+        if (sentence.size() < 128)
+          sentence += ch;
+        continue;
+      }
+      if (quiet) {
+        sentence.clear();
+        continue;
+      }
+      if ((outProtocols & 0x0002) && nmeaEnabled(sentence)) {
+        output += sentence;
+        output += ch;
+      }
+      handleSentence(sentence);
+      sentence.clear();
+      output += replies;
+      replies.clear();
+    }
+    // Bytes the UART could not buffer are lost, exactly as on the board
+    if (hostBaud != receiverBaud) {
+      // Framing errors: the bytes arrive, but as garbage
+      for (char &ch : output)
+        ch = (char)(ch ^ 0xA5);
+    }
+    port.inject((const uint8_t *)output.data(), output.size());
+    position += n;
+    bytesSent += output.size();
+    budgetMilliBytes -= n * 1000;
+  }
+}
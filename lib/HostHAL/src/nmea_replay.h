@@ -0,0 +1,89 @@
+#ifndef HOST_NMEA_REPLAY_H
+#define HOST_NMEA_REPLAY_H
+
+#include <string>
+
+#include "HardwareSerial.h"
+
+// Plays a recorded GPS UART byte stream (raw NMEA log) into the port at the
+// line rate it was captured at, as the NEO-6M would send it. Models the
+// receiver's own port rate: UBX CFG-PRT from the host changes it, and while
+// host and receiver rates differ the host only sees framing garbage.
+// CFG-PRT also selects the output protocols and CFG-MSG the messages
+// (standard NMEA and NAV); with UBX output on, each RMC/GGA pair of the
+// capture is re-encoded as NAV-POSLLH/SOL/VELNED/TIMEUTC at the end of its
+// epoch. Other CFG messages (CFG-RATE, CFG-NAV5, CFG-PM2, CFG-RXM) are
+// only acknowledged. RXM-PMREQ backup silences the receiver until its timer
+// runs out or the host writes to it, followed by a hot start.
+class NmeaReplay : public SerialPeer {
+public:
+  bool load(const char *path);
+  void setLoop(bool loop) { this->loop = loop; }
+  // Baud rate of the capture; sets the average byte rate (default 9600)
+  void setCaptureBaud(unsigned long baud) { captureBaud = baud; }
+
+  void onBaudRate(unsigned long baud) override { hostBaud = baud; }
+  void onHostWrite(const uint8_t *data, size_t len) override;
+  void pump(unsigned long nowMs, HardwareSerial &port) override;
+
+  unsigned long getReceiverBaud() const { return receiverBaud; }
+  // Output gap after leaving backup (default 1 s, NEO-6M hot start)
+  void setHotStartMs(unsigned long ms) { hotStartMs = ms; }
+  unsigned long getWakeUps() const { return wakeUps; }
+
+  bool finished() const { return !loop && position >= data.size(); }
+  unsigned long getBytesSent() const { return bytesSent; } // To the host
+
+private:
+  void handleUbx(uint8_t messageClass, uint8_t messageId,
+                 const uint8_t *payload, size_t length);
+  void queueUbx(uint8_t messageClass, uint8_t messageId,
+                const uint8_t *payload, size_t length);
+  // CFG-MSG has not switched this sentence type off
+  bool nmeaEnabled(const std::string &line) const;
+  // Decode one captured sentence; GGA ends the epoch and emits UBX
+  void handleSentence(const std::string &sentence);
+  void emitNavEpoch();
+  void wake(unsigned long nowMs);
+
+  // Navigation state decoded from the capture (RMC + GGA)
+  struct Epoch {
+    unsigned long timeOfDayMs = 0;
+    unsigned long weekday = 0; // 0 = Sunday
+    int year = 0, month = 0, day = 0;
+    int hour = 0, minute = 0, second = 0;
+    bool dateValid = false;
+    bool timeValid = false;
+    double latitude = 0, longitude = 0, altitude = 0;
+    double speedKnots = 0, courseDeg = 0;
+    int quality = 0; // GGA fix quality, 0 = none
+    int satellites = 0;
+  };
+
+  std::string data;
+  size_t position = 0;
+  bool loop = false;
+  unsigned long captureBaud = 9600;
+  unsigned long hostBaud = 9600;
+  unsigned long receiverBaud = 9600;
+  std::string command; // UBX frame being received from the host
+  std::string replies; // UBX output queued ahead of the capture
+  uint16_t outProtocols = 0x0003; // UBX | NMEA, the receiver default
+  uint8_t navRates[256] = {};     // CFG-MSG rates of the NAV class
+  // CFG-MSG rates of GGA, GLL, GSA, GSV, RMC and VTG
+  uint8_t nmeaRates[6] = {1, 1, 1, 1, 1, 1};
+  std::string sentence;           // Capture line being decoded
+  bool asleep = false;            // RXM-PMREQ backup
+  bool timedBackup = false;
+  unsigned long backupEndMs = 0;
+  unsigned long quietUntilMs = 0;
+  unsigned long hotStartMs = 1000;
+  unsigned long wakeUps = 0;
+  Epoch epoch;
+  bool started = false;
+  unsigned long lastPumpMs = 0;
+  unsigned long budgetMilliBytes = 0;
+  unsigned long bytesSent = 0;
+};
+
+#endif // HOST_NMEA_REPLAY_H
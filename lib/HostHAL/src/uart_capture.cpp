@@ -0,0 +1,136 @@
+#include "uart_capture.h"
+
+#include "host_clock.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+bool UartRecorder::open(const char *path) {
+  close();
+  file = fopen(path, "w");
+  if (!file)
+    return false;
+  fprintf(file, "# <ms> <port> <rx|tx> <hex>; rx is toward the firmware\n");
+  return true;
+}
+
+void UartRecorder::close() {
+  if (!file)
+    return;
+  flushLine();
+  fclose(file);
+  file = nullptr;
+}
+
+void UartRecorder::addPort(int uartNum, const char *name) {
+  if (uartNum >= 0 && uartNum < HOST_UART_COUNT) {
+    names[uartNum] = name;
+  }
+}
+
+void UartRecorder::onTraffic(int uartNum, bool toFirmware,
+                             const uint8_t *data, size_t len) {
+  if (!file || uartNum < 0 || uartNum >= HOST_UART_COUNT || !names[uartNum])
+    return;
+
+  unsigned long now = hostclock::millis();
+  if (now != lineMs || uartNum != lineUart || toFirmware != lineToFirmware) {
+    flushLine();
+    lineMs = now;
+    lineUart = uartNum;
+    lineToFirmware = toFirmware;
+  }
+  static const char digits[] = "0123456789abcdef";
+  for (size_t i = 0; i < len; i++) {
+    lineHex += digits[data[i] >> 4];
+    lineHex += digits[data[i] & 0x0F];
+  }
+}
+
+void UartRecorder::flushLine() {
+  if (lineHex.empty())
+    return;
+  fprintf(file, "%lu %s %s %s\n", lineMs, names[lineUart],
+          lineToFirmware ? "rx" : "tx", lineHex.c_str());
+  lineHex.clear();
+}
+
+bool CaptureReplay::load(const char *path) {
+  std::ifstream input(path);
+  if (!input)
+    return false;
+
+  unsigned long lastWriteMs = 0;
+  std::string line;
+  while (std::getline(input, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream fields(line);
+    unsigned long ms;
+    std::string port, direction, hex;
+    if (!(fields >> ms >> port >> direction >> hex) || port != name)
+      continue;
+
+    std::string bytes;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+      bytes += (char)strtoul(hex.substr(i, 2).c_str(), nullptr, 16);
+    }
+    if (direction == "tx") {
+      expected += bytes;
+      lastWriteMs = ms;
+    } else if (direction == "rx") {
+      // Hand edits may leave a reply ahead of its command; send it at once
+      unsigned long delay = ms > lastWriteMs ? ms - lastWriteMs : 0;
+      bursts.push_back({(unsigned long)expected.size(), delay, bytes});
+    }
+  }
+  return !bursts.empty() || !expected.empty();
+}
+
+void CaptureReplay::onHostWrite(const uint8_t *data, size_t len) {
+  unsigned long now = hostclock::millis();
+  if (!diverged) {
+    for (size_t i = 0; i < len; i++) {
+      size_t at = written + i;
+      if (at >= expected.size() || (uint8_t)expected[at] != data[i]) {
+        diverged = true;
+        fprintf(stderr,
+                "replay %s: firmware output differs from the capture at "
+                "byte %zu (%lu ms)\n",
+                name, at, now);
+        break;
+      }
+    }
+  }
+  written += len;
+  writes.push_back({written, now});
+}
+
+bool CaptureReplay::reachedAt(unsigned long offset, unsigned long &ms) {
+  if (offset == 0) {
+    ms = 0; // Before any write: time since the start of the run
+    return true;
+  }
+  while (writeIndex < writes.size() && writes[writeIndex].first < offset) {
+    writeIndex++;
+  }
+  if (writeIndex == writes.size())
+    return false;
+  ms = writes[writeIndex].second;
+  return true;
+}
+
+void CaptureReplay::pump(unsigned long nowMs, HardwareSerial &port) {
+  while (next < bursts.size()) {
+    const Burst &burst = bursts[next];
+    unsigned long anchorMs;
+    if (!reachedAt(burst.txOffset, anchorMs) ||
+        nowMs < anchorMs + burst.delayMs)
+      return;
+    port.inject((const uint8_t *)burst.bytes.data(), burst.bytes.size());
+    bytesSent += burst.bytes.size();
+    next++;
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef HOST_UART_CAPTURE_H
+#define HOST_UART_CAPTURE_H
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "HardwareSerial.h"
+
+// UART capture files: one line per burst of bytes on one port in one
+// direction, in time order,
+//
+//   <ms> <port> <rx|tx> <hex bytes>
+//
+// where rx is toward the firmware and ms is simulated time. Lines starting
+// with '#' are comments. The format is meant for hand edits: stretching
+// the gap before a reply or inserting "0, CLOSED" scripts a field failure.
+
+// Writes every byte crossing the named ports to a capture file
+class UartRecorder : public UartTap {
+public:
+  ~UartRecorder() override { close(); }
+
+  bool open(const char *path);
+  void close();
+  // Record this UART under name (other ports are ignored)
+  void addPort(int uartNum, const char *name);
+
+  void onTraffic(int uartNum, bool toFirmware, const uint8_t *data,
+                 size_t len) override;
+
+private:
+  void flushLine();
+
+  FILE *file = nullptr;
+  const char *names[HOST_UART_COUNT] = {};
+  // Burst being collected: same millisecond, port and direction
+  unsigned long lineMs = 0;
+  int lineUart = -1;
+  bool lineToFirmware = false;
+  std::string lineHex;
+};
+
+// Plays one port of a capture back as the device on the far side. An rx
+// burst is held until the firmware has written as many bytes as it had
+// when the burst arrived, then sent after the same delay past that point,
+// so replies follow their commands even when the firmware runs
+// differently. What the firmware writes is compared with the capture; the
+// first difference is reported.
+class CaptureReplay : public SerialPeer {
+public:
+  explicit CaptureReplay(const char *name) : name(name) {}
+
+  bool load(const char *path);
+
+  void onHostWrite(const uint8_t *data, size_t len) override;
+  void pump(unsigned long nowMs, HardwareSerial &port) override;
+
+  bool finished() const { return next >= bursts.size(); }
+  unsigned long getBytesSent() const { return bytesSent; }
+  bool hasDiverged() const { return diverged; }
+
+private:
+  struct Burst {
+    unsigned long txOffset; // Firmware bytes written before it arrived
+    unsigned long delayMs;  // After the firmware's write that reached it
+    std::string bytes;
+  };
+
+  // When the firmware's writes first reached offset
+  bool reachedAt(unsigned long offset, unsigned long &ms);
+
+  const char *name;
+  std::vector<Burst> bursts;
+  std::string expected; // Everything the firmware wrote in the capture
+  size_t next = 0;
+  unsigned long written = 0;
+  std::vector<std::pair<unsigned long, unsigned long>> writes; // End, ms
+  size_t writeIndex = 0;
+  unsigned long bytesSent = 0;
+  bool diverged = false;
+};
+
+#endif // HOST_UART_CAPTURE_H
@@ -0,0 +1,217 @@
+#include "at_engine.h"
+#include "metrics.h"
+
+#include <string.h>
+
+const char *atFind(const char *response, const char *prefix) {
+  const char *match = strstr(response, prefix);
+  if (!match)
+    return nullptr;
+  match += strlen(prefix);
+  while (*match == ' ')
+    match++;
+  return match;
+}
+
+AtEngine::AtEngine()
+    : stream(nullptr), head(0), count(0), inFlight(0), handlerCount(0),
+      startedAt(0), startedMicros(0), timeoutMs(0), lineLength(0),
+      responseLength(0), commandLines(0), unsolicited(0), timeouts(0) {
+  current[0] = '\0';
+  line[0] = '\0';
+  response[0] = '\0';
+}
+
+bool AtEngine::submit(const char *command, unsigned long timeout,
+                      AtCallback callback, void *context, uint8_t flags,
+                      const char *finalLine) {
+  size_t length = strlen(command);
+  if (count >= AT_QUEUE_SIZE || length >= AT_COMMAND_MAX)
+    return false;
+
+  Command &entry = queue[(head + count) % AT_QUEUE_SIZE];
+  memcpy(entry.text, command, length + 1);
+  entry.timeoutMs = timeout;
+  entry.callback = callback;
+  entry.context = context;
+  entry.finalLine = finalLine;
+  entry.flags = finalLine ? 0 : flags; // Own end marker: never joined
+  count++;
+  return true;
+}
+
+bool AtEngine::onUnsolicited(const char *prefix, AtLineHandler handler,
+                             void *context) {
+  if (handlerCount >= AT_URC_HANDLERS)
+    return false;
+  handlers[handlerCount].prefix = prefix;
+  handlers[handlerCount].handler = handler;
+  handlers[handlerCount].context = context;
+  handlerCount++;
+  return true;
+}
+
+void AtEngine::start() {
+  const Command &first = queue[head];
+  size_t length = strlen(first.text);
+  memcpy(current, first.text, length + 1);
+  timeoutMs = first.timeoutMs;
+  inFlight = 1;
+
+  // Pipeline independent queries on one command line
+  while ((first.flags & AT_JOIN) && inFlight < count) {
+    const Command &next = queue[(head + inFlight) % AT_QUEUE_SIZE];
+    size_t nextLength = strlen(next.text);
+    if (!(next.flags & AT_JOIN) || length + 1 + nextLength >= AT_COMMAND_MAX)
+      break;
+    current[length++] = ';';
+    memcpy(current + length, next.text, nextLength + 1);
+    length += nextLength;
+    timeoutMs = max(timeoutMs, next.timeoutMs);
+    inFlight++;
+  }
+
+  responseLength = 0;
+  response[0] = '\0';
+
+  stream->print("AT");
+  stream->print(current);
+  stream->print("\r\n");
+
+  startedAt = millis();
+  startedMicros = micros();
+  commandLines++;
+}
+
+void AtEngine::complete(AtResult result) {
+  // Round trip, across poll() calls: timed on the clock, not in cycles
+  metricRecord(METRIC_AT_COMMAND, micros() - startedMicros);
+
+  // Pop first: callbacks may queue follow-up commands
+  AtCallback callbacks[AT_QUEUE_SIZE];
+  void *contexts[AT_QUEUE_SIZE];
+  uint8_t completed = inFlight;
+  for (uint8_t i = 0; i < completed; i++) {
+    const Command &entry = queue[(head + i) % AT_QUEUE_SIZE];
+    callbacks[i] = entry.callback;
+    contexts[i] = entry.context;
+  }
+  head = (head + completed) % AT_QUEUE_SIZE;
+  count -= completed;
+  inFlight = 0;
+
+  for (uint8_t i = 0; i < completed; i++) {
+    if (callbacks[i])
+      callbacks[i](contexts[i], result, response);
+  }
+}
+
+bool AtEngine::isSolicited() const {
+  // "+CREG: 1,1" answers a command line containing "+CREG"
+  if (!inFlight || line[0] != '+')
+    return false;
+  const char *colon = strchr(line, ':');
+  if (!colon)
+    return false;
+  char token[16];
+  size_t length = min((size_t)(colon - line), sizeof(token) - 1);
+  memcpy(token, line, length);
+  token[length] = '\0';
+  return strstr(current, token) != nullptr;
+}
+
+bool AtEngine::dispatchUnsolicited() {
+  // Skip a "<n>, " link number (CIPMUX=1 socket events)
+  const char *text = line;
+  const char *p = line;
+  while (*p >= '0' && *p <= '9')
+    p++;
+  if (p != line && p[0] == ',' && p[1] == ' ')
+    text = p + 2;
+
+  for (uint8_t i = 0; i < handlerCount; i++) {
+    const UrcHandler &urc = handlers[i];
+    size_t length = strlen(urc.prefix);
+    if (!strncmp(line, urc.prefix, length) ||
+        !strncmp(text, urc.prefix, length)) {
+      unsolicited++;
+      urc.handler(urc.context, line);
+      return true;
+    }
+  }
+  return false;
+}
+
+void AtEngine::handleLine() {
+  line[lineLength] = '\0';
+  size_t length = lineLength;
+  lineLength = 0;
+
+  if (length == 0)
+    return;
+  // Command echo (until ATE0 takes effect)
+  if (length >= 2 && (line[0] == 'A' || line[0] == 'a') &&
+      (line[1] == 'T' || line[1] == 't'))
+    return;
+
+  if (inFlight) {
+    const char *finalLine = queue[head].finalLine;
+    if (!strcmp(line, "OK") || (finalLine && !strcmp(line, finalLine))) {
+      complete(AT_OK);
+      return;
+    }
+    if (!strcmp(line, "ERROR") || !strncmp(line, "+CME ERROR", 10) ||
+        !strncmp(line, "+CMS ERROR", 10)) {
+      complete(AT_ERROR);
+      return;
+    }
+  }
+
+  if (!isSolicited() && dispatchUnsolicited())
+    return;
+  if (!inFlight)
+    return; // Nobody's line (late reply after a timeout)
+
+  // Information line: keep it for the callbacks
+  if (responseLength + length + 2 <= sizeof(response)) {
+    if (responseLength > 0)
+      response[responseLength++] = '\n';
+    memcpy(response + responseLength, line, length);
+    responseLength += length;
+    response[responseLength] = '\0';
+  }
+}
+
+void AtEngine::poll() {
+  if (!stream)
+    return;
+
+  while (stream->available() > 0) {
+    char c = (char)stream->read();
+    if (c == '\r')
+      continue;
+    if (c != '\n') {
+      if (lineLength < sizeof(line) - 1)
+        line[lineLength++] = c;
+      continue;
+    }
+    handleLine();
+    // Back to back: the next command goes out as soon as this one ends
+    if (!inFlight && count > 0)
+      start();
+  }
+
+  if (inFlight && millis() - startedAt >= timeoutMs) {
+    timeouts++;
+    complete(AT_TIMEOUT);
+  }
+  if (!inFlight && count > 0)
+    start();
+}
+
+void AtEngine::abort() {
+  head = 0;
+  count = 0;
+  inFlight = 0;
+  lineLength = 0;
+}
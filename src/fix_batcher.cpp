@@ -0,0 +1,87 @@
+#include "fix_batcher.h"
+#include "fix_codec.h"
+#include "json_writer.h"
+
+#include <string.h>
+
+FixBatcher::FixBatcher() : count(0) {}
+
+bool FixBatcher::add(const GpsFix &fix, unsigned long timestamp) {
+  if (count >= MQTT_BATCH_SIZE)
+    return false;
+  entries[count].fix = fix;
+  entries[count].timestamp = timestamp;
+  count++;
+  return true;
+}
+
+bool FixBatcher::isDue(unsigned long now) const {
+  if (count == 0)
+    return false;
+  return count >= MQTT_BATCH_SIZE ||
+         now - entries[0].timestamp >= MQTT_BATCH_MAX_AGE_MS;
+}
+
+size_t FixBatcher::buildPayload(char *buffer, size_t capacity,
+                                size_t &included) const {
+  const bool asArray = MQTT_BATCH_SIZE > 1;
+  // Keep room for the closing bracket while adding elements
+  JsonWriter json(buffer, asArray && capacity > 0 ? capacity - 1 : capacity);
+  included = 0;
+
+  if (asArray)
+    json.beginArray();
+
+  for (size_t i = 0; i < count; i++) {
+    const BatchEntry &entry = entries[i];
+    const GpsFix &fix = entry.fix;
+    JsonWriter::Mark mark = json.mark();
+
+    json.beginObject();
+    json.field("latitude", fix.latitude, 6);
+    json.field("longitude", fix.longitude, 6);
+    json.field("altitude", fix.altitudeValid ? fix.altitude : 0.0, 2);
+    json.field("speed", fix.speedValid ? fix.speedKmph : 0.0, 2);
+    json.field("satellites", fix.satellites);
+    json.field("valid", true);
+    json.field("timestamp", entry.timestamp);
+    json.endObject();
+
+    if (!json.ok()) {
+      json.rewind(mark); // Truncated: this fix goes into the next payload
+      break;
+    }
+    included++;
+    if (!asArray)
+      break;
+  }
+
+  if (included == 0)
+    return 0;
+  size_t length = json.size();
+  if (asArray) {
+    buffer[length++] = ']';
+    buffer[length] = '\0';
+  }
+  return length;
+}
+
+size_t FixBatcher::buildBinaryPayload(uint8_t *buffer, size_t capacity,
+                                      size_t limit, size_t &included) const {
+  FixEncoder encoder(buffer, capacity);
+  for (size_t i = 0; i < count && i < limit; i++) {
+    if (!encoder.add(entries[i].fix, entries[i].timestamp))
+      break;
+  }
+  included = encoder.count();
+  return encoder.finish();
+}
+
+void FixBatcher::consume(size_t n) {
+  if (n >= count) {
+    count = 0;
+    return;
+  }
+  memmove(entries, entries + n, (count - n) * sizeof(BatchEntry));
+  count -= n;
+}
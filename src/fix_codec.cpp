@@ -0,0 +1,92 @@
+#include "fix_codec.h"
+
+#include <math.h>
+#include <string.h>
+
+static size_t putVarint(uint8_t *out, uint64_t value) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+static size_t putSigned(uint8_t *out, int64_t value) {
+  // Zigzag: small magnitudes of either sign stay short
+  return putVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+FixEncoder::FixEncoder(uint8_t *buffer, size_t capacity)
+    : buffer(buffer), capacity(capacity), bodyLength(0), fixCount(0),
+      baseTimestamp(0), baseUtc(0), prevTimestamp(0), prevLatitude(0),
+      prevLongitude(0), prevAltitude(0), prevSpeed(0), prevCourse(0),
+      prevSatellites(0) {}
+
+bool FixEncoder::add(const GpsFix &fix, unsigned long timestamp) {
+  if (capacity < FIX_CODEC_MAX_HEADER)
+    return false;
+
+  int32_t latitude = (int32_t)lround(fix.latitude * 1e7);
+  int32_t longitude = (int32_t)lround(fix.longitude * 1e7);
+  int32_t altitude = fix.altitudeValid ? (int32_t)lround(fix.altitude * 10) : 0;
+  int32_t speed = fix.speedValid ? (int32_t)lround(fix.speedKmph * 100) : 0;
+  int32_t course =
+      fix.courseValid ? (int32_t)lround(fix.courseDeg * 100) % 36000 : 0;
+  int32_t satellites = fix.satellites;
+
+  if (fixCount == 0) {
+    baseTimestamp = prevTimestamp = timestamp;
+    baseUtc = fix.utcSeconds();
+  }
+
+  // Course wraps: 359.9 -> 0.1 is +0.2 degrees, not -359.8
+  int32_t courseDelta = course - prevCourse;
+  if (courseDelta > 18000)
+    courseDelta -= 36000;
+  else if (courseDelta <= -18000)
+    courseDelta += 36000;
+
+  uint8_t record[FIX_CODEC_MAX_RECORD];
+  size_t n = 0;
+  n += putVarint(record + n, (uint32_t)(timestamp - prevTimestamp));
+  n += putSigned(record + n, (int64_t)latitude - prevLatitude);
+  n += putSigned(record + n, (int64_t)longitude - prevLongitude);
+  n += putSigned(record + n, (int64_t)altitude - prevAltitude);
+  n += putSigned(record + n, (int64_t)speed - prevSpeed);
+  n += putSigned(record + n, courseDelta);
+  n += putSigned(record + n, (int64_t)satellites - prevSatellites);
+
+  if (FIX_CODEC_MAX_HEADER + bodyLength + n > capacity)
+    return false;
+
+  memcpy(buffer + FIX_CODEC_MAX_HEADER + bodyLength, record, n);
+  bodyLength += n;
+  fixCount++;
+
+  prevTimestamp = timestamp;
+  prevLatitude = latitude;
+  prevLongitude = longitude;
+  prevAltitude = altitude;
+  prevSpeed = speed;
+  prevCourse = course;
+  prevSatellites = satellites;
+  return true;
+}
+
+size_t FixEncoder::finish() {
+  if (fixCount == 0)
+    return 0;
+
+  uint8_t header[FIX_CODEC_MAX_HEADER];
+  size_t n = 0;
+  header[n++] = FIX_CODEC_VERSION;
+  n += putVarint(header + n, fixCount);
+  n += putVarint(header + n, baseTimestamp);
+  n += putVarint(header + n, baseUtc);
+
+  memmove(buffer + n, buffer + FIX_CODEC_MAX_HEADER, bodyLength);
+  memcpy(buffer, header, n);
+  return n + bodyLength;
+}
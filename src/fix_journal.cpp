@@ -0,0 +1,313 @@
+#include "fix_journal.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#define RECORD_SIZE sizeof(JournalRecord)
+#define RECORDS_PER_SECTOR (SPI_FLASH_SEC_SIZE / RECORD_SIZE)
+#define SCAN_CHUNK_RECORDS 16
+
+static uint16_t crc16(const uint8_t *data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  while (length--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021)
+                           : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+static uint16_t recordCrc(const JournalRecord &record) {
+  return crc16((const uint8_t *)&record + 4, RECORD_SIZE - 4);
+}
+
+FixJournal::FixJournal()
+    : partition(nullptr), capacity(0), headIndex(0), tailIndex(0),
+      nextSequence(1), pending(0), overwritten(0) {}
+
+bool FixJournal::readRecord(uint32_t index, JournalRecord &record) {
+  return esp_partition_read(partition, index * RECORD_SIZE, &record,
+                            RECORD_SIZE) == ESP_OK;
+}
+
+bool FixJournal::isValid(const JournalRecord &record) {
+  return record.magic == JOURNAL_MAGIC && record.crc == recordCrc(record);
+}
+
+bool FixJournal::begin(const char *label) {
+  DEBUG_PRINTLN("Opening fix journal...");
+  return open(label) && scan();
+}
+
+bool FixJournal::begin(const JournalCursor &cursor, const char *label) {
+  DEBUG_PRINTLN("Opening fix journal...");
+  if (!open(label))
+    return false;
+  if (!resume(cursor)) {
+    DEBUG_PRINTLN("   Saved journal position does not match, scanning");
+    return scan();
+  }
+
+  DEBUG_PRINT("   Journal resumed, pending: ");
+  DEBUG_PRINTLN(pending);
+  return true;
+}
+
+JournalCursor FixJournal::getCursor() const {
+  JournalCursor cursor;
+  cursor.headIndex = headIndex;
+  cursor.tailIndex = tailIndex;
+  cursor.nextSequence = nextSequence;
+  cursor.pending = pending;
+  cursor.overwritten = overwritten;
+  return cursor;
+}
+
+bool FixJournal::open(const char *label) {
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                       ESP_PARTITION_SUBTYPE_ANY, label);
+  if (!partition) {
+    DEBUG_PRINT("✗ No flash partition named ");
+    DEBUG_PRINTLN(label);
+    return false;
+  }
+
+  capacity = (partition->size / SPI_FLASH_SEC_SIZE) * RECORDS_PER_SECTOR;
+  return true;
+}
+
+bool FixJournal::resume(const JournalCursor &cursor) {
+  if (cursor.headIndex >= capacity || cursor.tailIndex >= capacity ||
+      cursor.nextSequence == 0 || cursor.pending > capacity)
+    return false;
+
+  // The last append sits just before the head...
+  JournalRecord record;
+  if (cursor.nextSequence > 1) {
+    uint32_t last = (cursor.headIndex + capacity - 1) % capacity;
+    if (!readRecord(last, record) || !isValid(record) ||
+        record.sequence != cursor.nextSequence - 1)
+      return false;
+  }
+  // ...and the oldest undelivered record at the tail
+  if (cursor.pending > 0 &&
+      (!readRecord(cursor.tailIndex, record) || !isValid(record) ||
+       record.state != JOURNAL_STATE_PENDING))
+    return false;
+
+  headIndex = cursor.headIndex;
+  tailIndex = cursor.tailIndex;
+  nextSequence = cursor.nextSequence;
+  pending = cursor.pending;
+  overwritten = cursor.overwritten;
+  return true;
+}
+
+bool FixJournal::scan() {
+  // Rebuild head (after the highest sequence) and tail (lowest pending)
+  uint32_t maxSequence = 0;
+  uint32_t minPendingSequence = UINT32_MAX;
+  JournalRecord chunk[SCAN_CHUNK_RECORDS];
+  for (uint32_t base = 0; base < capacity; base += SCAN_CHUNK_RECORDS) {
+    if (esp_partition_read(partition, base * RECORD_SIZE, chunk,
+                           sizeof(chunk)) != ESP_OK) {
+      DEBUG_PRINTLN("✗ Journal read failed");
+      partition = nullptr;
+      return false;
+    }
+    for (uint32_t i = 0; i < SCAN_CHUNK_RECORDS; i++) {
+      const JournalRecord &record = chunk[i];
+      if (!isValid(record))
+        continue;
+      if (record.sequence >= maxSequence) {
+        maxSequence = record.sequence;
+        headIndex = (base + i + 1) % capacity;
+      }
+      if (record.state == JOURNAL_STATE_PENDING &&
+          record.sequence < minPendingSequence) {
+        minPendingSequence = record.sequence;
+        tailIndex = base + i;
+      }
+    }
+  }
+
+  nextSequence = maxSequence + 1;
+  if (minPendingSequence == UINT32_MAX) {
+    tailIndex = headIndex;
+    pending = 0;
+  } else {
+    pending = maxSequence - minPendingSequence + 1;
+  }
+
+  // A write torn by a reset leaves a dirty slot; continue in a fresh sector
+  JournalRecord slot;
+  readRecord(headIndex, slot);
+  const uint8_t *bytes = (const uint8_t *)&slot;
+  for (size_t i = 0; i < RECORD_SIZE; i++) {
+    if (bytes[i] != 0xFF) {
+      headIndex = ((headIndex / RECORDS_PER_SECTOR + 1) * RECORDS_PER_SECTOR) %
+                  capacity;
+      break;
+    }
+  }
+
+  DEBUG_PRINT("   Journal capacity: ");
+  DEBUG_PRINT(capacity);
+  DEBUG_PRINT(" fixes, pending: ");
+  DEBUG_PRINTLN(pending);
+
+  return true;
+}
+
+bool FixJournal::append(const GpsFix &fix) {
+  if (!partition)
+    return false;
+
+  if (headIndex % RECORDS_PER_SECTOR == 0) {
+    // Reuse the next sector; undelivered records in it are the oldest.
+    // Only records count: slots left unused by a torn write do not.
+    uint32_t sectorEnd = headIndex + RECORDS_PER_SECTOR;
+    if (pending > 0 && tailIndex >= headIndex && tailIndex < sectorEnd) {
+      uint32_t lost = 0;
+      for (uint32_t i = tailIndex; i < sectorEnd; i++) {
+        JournalRecord old;
+        if (readRecord(i, old) && isValid(old) &&
+            old.state == JOURNAL_STATE_PENDING)
+          lost++;
+      }
+      if (lost > pending)
+        lost = pending;
+      pending -= lost;
+      overwritten += lost;
+      tailIndex = sectorEnd % capacity;
+    }
+    if (esp_partition_erase_range(partition, headIndex * RECORD_SIZE,
+                                  SPI_FLASH_SEC_SIZE) != ESP_OK) {
+      DEBUG_PRINTLN("✗ Journal erase failed");
+      return false;
+    }
+  }
+
+  JournalRecord record;
+  memset(&record, 0xFF, sizeof(record));
+  record.magic = JOURNAL_MAGIC;
+  record.state = JOURNAL_STATE_PENDING;
+  record.sequence = nextSequence;
+  record.latitudeE7 = (int32_t)lround(fix.latitude * 1e7);
+  record.longitudeE7 = (int32_t)lround(fix.longitude * 1e7);
+  record.altitudeDm =
+      fix.altitudeValid ? (int32_t)lround(fix.altitude * 10) : 0;
+  record.speedCkmh =
+      fix.speedValid ? (uint16_t)lround(fix.speedKmph * 100) : 0;
+  record.courseCdeg =
+      fix.courseValid ? (uint16_t)lround(fix.courseDeg * 100) : 0;
+  record.utcSeconds = fix.utcSeconds();
+  record.satellites = fix.satellites;
+  record.crc = recordCrc(record);
+
+  if (esp_partition_write(partition, headIndex * RECORD_SIZE, &record,
+                          RECORD_SIZE) != ESP_OK) {
+    DEBUG_PRINTLN("✗ Journal write failed");
+    return false;
+  }
+
+  if (pending == 0)
+    tailIndex = headIndex;
+  headIndex = (headIndex + 1) % capacity;
+  nextSequence++;
+  pending++;
+  return true;
+}
+
+void FixJournal::advanceTail() { tailIndex = (tailIndex + 1) % capacity; }
+
+bool FixJournal::peek(JournalRecord &record) {
+  // Pending records carry consecutive sequence numbers ending just before
+  // nextSequence; the slots between them hold none and are stepped over
+  for (uint32_t skipped = 0; pending > 0 && skipped < capacity; skipped++) {
+    if (!readRecord(tailIndex, record))
+      return false;
+    uint32_t expected = nextSequence - pending;
+    if (isValid(record) && record.state == JOURNAL_STATE_PENDING &&
+        record.sequence >= expected) {
+      // Anything older than this record is gone
+      uint32_t lost = record.sequence - expected;
+      if (lost < pending) {
+        pending -= lost;
+        overwritten += lost;
+        return true;
+      }
+    }
+    // Slot left unused by a torn write, or not a deliverable record
+    advanceTail();
+  }
+
+  if (pending > 0) {
+    // Nothing deliverable anywhere: the count was wrong, start over
+    overwritten += pending;
+    pending = 0;
+    tailIndex = headIndex;
+  }
+  return false;
+}
+
+bool FixJournal::peek(uint32_t sequence, JournalRecord &record) {
+  if (!peek(record) || sequence < record.sequence || sequence >= nextSequence)
+    return false;
+  if (sequence == record.sequence)
+    return true;
+
+  // Records follow the tail in sequence order; unused slots only push a
+  // record further along, never before its place
+  uint32_t index = (tailIndex + (sequence - record.sequence)) % capacity;
+  for (uint32_t i = 0; i < capacity && index != headIndex; i++) {
+    if (!readRecord(index, record))
+      return false;
+    if (isValid(record) && record.state == JOURNAL_STATE_PENDING) {
+      if (record.sequence == sequence)
+        return true;
+      if (record.sequence > sequence)
+        return false;
+    }
+    index = (index + 1) % capacity;
+  }
+  return false;
+}
+
+bool FixJournal::markSent(const JournalRecord &record) {
+  JournalRecord current;
+  if (pending == 0 || !readRecord(tailIndex, current) ||
+      current.sequence != record.sequence)
+    return false;
+
+  uint8_t sent = JOURNAL_STATE_SENT;
+  if (esp_partition_write(partition,
+                          tailIndex * RECORD_SIZE +
+                              offsetof(JournalRecord, state),
+                          &sent, 1) != ESP_OK)
+    return false;
+
+  advanceTail();
+  pending--;
+  return true;
+}
+
+void FixJournal::toFix(const JournalRecord &record, GpsFix &fix) {
+  fix = GpsFix();
+  fix.latitude = record.latitudeE7 / 1e7;
+  fix.longitude = record.longitudeE7 / 1e7;
+  fix.locationValid = true;
+  fix.altitude = record.altitudeDm / 10.0;
+  fix.altitudeValid = true;
+  fix.speedKmph = record.speedCkmh / 100.0;
+  fix.speedValid = true;
+  fix.courseDeg = record.courseCdeg / 100.0;
+  fix.courseValid = true;
+  fix.satellites = record.satellites;
+  fix.satellitesValid = true;
+  if (record.utcSeconds) {
+    fix.setUtcSeconds(record.utcSeconds);
+  }
+}
@@ -1,7 +1,29 @@
 #include "gps.h"
+#include "json_writer.h"
+#include "metrics.h"
+#include <math.h>
+
+static_assert(!GPS_UBX_MODE || GPS_BULK_INGEST,
+              "GPS_UBX_MODE needs the GPS_BULK_INGEST read path");
+
+const char *gpsPowerStateName(GpsPowerState state) {
+  switch (state) {
+  case GPS_POWER_TRACKING:
+    return "tracking";
+  case GPS_POWER_BACKUP:
+    return "backup";
+  case GPS_POWER_ACQUIRING:
+    return "acquiring";
+  default:
+    return "unknown";
+  }
+}
 
 GPSModule::GPSModule()
-    : isInitialized(false), lastValidDataTime(0), gpsSerial(nullptr) {}
+    : fix(), gpsSerial(nullptr), isInitialized(false), lastValidDataTime(0),
+      baudRate(GPS_BAUD), ubxActive(false), configRequest(CONFIG_IDLE),
+      requestedConfig(), fixDeadline(0), powerState(GPS_POWER_TRACKING),
+      wakeAt(0), wokeAt(0), wakeToFixMs(0), backupCount(0) {}
 
 bool GPSModule::begin(HardwareSerial *serial) {
   DEBUG_PRINTLN("Setting up GPS module...");
@@ -15,12 +37,425 @@ bool GPSModule::begin(HardwareSerial *serial) {
   return true;
 }
 
+void GPSModule::sendPortConfig(unsigned long baud, uint16_t outProtocols) {
+  uint8_t payload[20] = {UBX_PORT_UART1};
+  ubxPutU32(payload + 4, UBX_PORT_MODE_8N1);
+  ubxPutU32(payload + 8, baud);
+  ubxPutU16(payload + 12, UBX_PROTO_UBX | UBX_PROTO_NMEA | UBX_PROTO_RTCM);
+  ubxPutU16(payload + 14, outProtocols);
+  ubxSend(*gpsSerial, UBX_CLASS_CFG, UBX_CFG_PRT, payload, sizeof(payload));
+  gpsSerial->flush(); // The receiver switches once the frame is in
+}
+
+bool GPSModule::verifyBaud(unsigned long timeoutMs) {
+  // Bytes from before the switch are noise at the new rate
+  while (gpsSerial->available() > 0)
+    gpsSerial->read();
+
+  bool inSentence = false;
+  bool inChecksum = false;
+  uint8_t sum = 0;
+  uint8_t expected = 0;
+  int digits = 0;
+
+#if GPS_UBX_MODE
+  // A receiver left in UBX mode (ESP32 reset) sends no NMEA at all
+  unsigned long framesBefore = ubx.getFramesParsed();
+#endif
+
+  unsigned long start = millis();
+  while (millis() - start < timeoutMs) {
+    if (gpsSerial->available() <= 0) {
+      delay(1);
+      continue;
+    }
+    char c = (char)gpsSerial->read();
+#if GPS_UBX_MODE
+    size_t space;
+    uint8_t *dst = ubx.writeSpace(space);
+    if (space > 0) {
+      *dst = (uint8_t)c;
+      ubx.commit(1);
+    }
+    ubx.process(fix, millis());
+    if (ubx.getFramesParsed() != framesBefore)
+      return true;
+#endif
+    if (c == '$') {
+      inSentence = true;
+      inChecksum = false;
+      sum = 0;
+      expected = 0;
+      digits = 0;
+    } else if (!inSentence) {
+      continue;
+    } else if (inChecksum) {
+      int value = c >= '0' && c <= '9'   ? c - '0'
+                  : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                         : -1;
+      if (value < 0) {
+        inSentence = false;
+        continue;
+      }
+      expected = (uint8_t)(expected << 4 | value);
+      if (++digits == 2) {
+        if (expected == sum)
+          return true;
+        inSentence = false;
+      }
+    } else if (c == '*') {
+      inChecksum = true;
+    } else if (c < ' ' || c > '~') {
+      inSentence = false; // Framing garbage
+    } else {
+      sum ^= (uint8_t)c;
+    }
+  }
+  return false;
+}
+
+unsigned long GPSModule::negotiateBaud(unsigned long baud) {
+  if (!isInitialized || baud == baudRate)
+    return baudRate;
+
+  DEBUG_PRINT("GPS: switching to ");
+  DEBUG_PRINT(baud);
+  DEBUG_PRINTLN(" baud...");
+
+  // The receiver may still be at the fast rate from before an ESP32 reset
+  gpsSerial->updateBaudRate(baud);
+  if (verifyBaud(GPS_BAUD_VERIFY_MS)) {
+    DEBUG_PRINTLN("GPS: receiver already at the new rate");
+    baudRate = baud;
+    return baudRate;
+  }
+
+  gpsSerial->updateBaudRate(baudRate);
+  sendPortConfig(baud);
+  delay(GPS_BAUD_SWITCH_MS);
+  gpsSerial->updateBaudRate(baud);
+  if (verifyBaud(GPS_BAUD_VERIFY_MS)) {
+    DEBUG_PRINTLN("GPS: baud rate switched");
+    baudRate = baud;
+    return baudRate;
+  }
+
+  // No valid sentence: ask for the default back (in case the receiver did
+  // switch) and stay there
+  DEBUG_PRINTLN("GPS: no data at the new rate, falling back");
+  sendPortConfig(GPS_BAUD);
+  delay(GPS_BAUD_SWITCH_MS);
+  gpsSerial->updateBaudRate(GPS_BAUD);
+  baudRate = GPS_BAUD;
+  if (!verifyBaud(GPS_BAUD_VERIFY_MS)) {
+    DEBUG_PRINTLN("GPS: no data at the default rate either");
+  }
+  return baudRate;
+}
+
+bool GPSModule::waitAck(uint8_t id) {
+  bool acknowledged = false;
+  unsigned long start = millis();
+  while (millis() - start < GPS_UBX_ACK_TIMEOUT_MS) {
+    int pending = gpsSerial->available();
+    if (pending <= 0) {
+      delay(1);
+      continue;
+    }
+    size_t space;
+    uint8_t *dst = ubx.writeSpace(space);
+    if (space > (size_t)pending)
+      space = pending;
+    ubx.commit(gpsSerial->readBytes(dst, space));
+    ubx.process(fix, millis());
+    if (ubx.takeAck(UBX_CLASS_CFG, id, acknowledged))
+      return acknowledged;
+  }
+  return false;
+}
+
+bool GPSModule::setMessageRate(uint8_t messageClass, uint8_t id,
+                               uint8_t rate) {
+  uint8_t payload[3] = {messageClass, id, rate};
+  ubxSend(*gpsSerial, UBX_CLASS_CFG, UBX_CFG_MSG, payload, sizeof(payload));
+  return waitAck(UBX_CFG_MSG);
+}
+
+bool GPSModule::applyConfig(const ReceiverConfig &config) {
+  // Unused by our parsers; GGA and RMC stay on
+  static const uint8_t EXTRA_NMEA[] = {UBX_NMEA_GLL, UBX_NMEA_GSA,
+                                       UBX_NMEA_GSV, UBX_NMEA_VTG};
+  if (!isInitialized)
+    return false;
+
+  uint8_t rate[6] = {};
+  ubxPutU16(rate, config.measurementRateMs);
+  ubxPutU16(rate + 2, 1); // One navigation solution per measurement
+  ubxPutU16(rate + 4, 1); // Aligned to GPS time
+  ubxSend(*gpsSerial, UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate));
+  if (!waitAck(UBX_CFG_RATE)) {
+    DEBUG_PRINTLN("GPS: CFG-RATE not acknowledged");
+    return false;
+  }
+
+  uint8_t nav5[36] = {};
+  ubxPutU16(nav5, UBX_NAV5_MASK_DYN);
+  nav5[2] = config.dynamicModel;
+  ubxSend(*gpsSerial, UBX_CLASS_CFG, UBX_CFG_NAV5, nav5, sizeof(nav5));
+  if (!waitAck(UBX_CFG_NAV5)) {
+    DEBUG_PRINTLN("GPS: CFG-NAV5 not acknowledged");
+    return false;
+  }
+
+  for (uint8_t id : EXTRA_NMEA) {
+    if (!setMessageRate(UBX_CLASS_NMEA, id, config.minimalMessages ? 0 : 1)) {
+      DEBUG_PRINTLN("GPS: CFG-MSG not acknowledged");
+      return false;
+    }
+  }
+
+  // Cyclic tracking follows the measurement rate
+  return setPowerSave(GPS_POWER_SAVE, config.measurementRateMs);
+}
+
+bool GPSModule::requestConfig(const ReceiverConfig &config) {
+  uint8_t state = configRequest.load(std::memory_order_acquire);
+  if (state == CONFIG_REQUESTED)
+    return false;
+  requestedConfig = config;
+  configRequest.store(CONFIG_REQUESTED, std::memory_order_release);
+  return true;
+}
+
+bool GPSModule::takeConfigResult(bool &applied) {
+  uint8_t state = configRequest.load(std::memory_order_acquire);
+  if (state != CONFIG_APPLIED && state != CONFIG_FAILED)
+    return false;
+  applied = state == CONFIG_APPLIED;
+  configRequest.store(CONFIG_IDLE, std::memory_order_relaxed);
+  return true;
+}
+
+bool GPSModule::setPowerSave(bool enabled, uint16_t updatePeriodMs) {
+  if (!isInitialized)
+    return false;
+
+  if (enabled) {
+    uint8_t pm2[44] = {1}; // Version 1
+    ubxPutU32(pm2 + 4, UBX_PM2_CYCLIC_TRACKING | UBX_PM2_UPDATE_EPH |
+                           UBX_PM2_WAIT_TIME_FIX);
+    ubxPutU32(pm2 + 8, updatePeriodMs);
+    ubxPutU32(pm2 + 12, 10000); // Retry a failed acquisition every 10 s
+    ubxSend(*gpsSerial, UBX_CLASS_CFG, UBX_CFG_PM2, pm2, sizeof(pm2));
+    if (!waitAck(UBX_CFG_PM2)) {
+      DEBUG_PRINTLN("GPS: CFG-PM2 not acknowledged");
+      return false;
+    }
+  }
+
+  uint8_t rxm[2] = {8, (uint8_t)(enabled ? UBX_RXM_POWER_SAVE
+                                          : UBX_RXM_CONTINUOUS)};
+  ubxSend(*gpsSerial, UBX_CLASS_CFG, UBX_CFG_RXM, rxm, sizeof(rxm));
+  if (!waitAck(UBX_CFG_RXM)) {
+    DEBUG_PRINTLN("GPS: CFG-RXM not acknowledged");
+    return false;
+  }
+  return true;
+}
+
+void GPSModule::sendStartHint(double latitude, double longitude,
+                              double altitude, uint32_t positionAccuracyM,
+                              uint32_t utcSeconds, uint32_t timeAccuracyMs) {
+  if (!isInitialized)
+    return;
+
+  UbxAidIni hint = {};
+  hint.lat = (int32_t)lround(latitude * 1e7);
+  hint.lon = (int32_t)lround(longitude * 1e7);
+  hint.alt = (int32_t)lround(altitude * 100);
+  hint.posAcc = positionAccuracyM * 100;
+  hint.flags = UBX_AID_INI_POS | UBX_AID_INI_LLA;
+  if (utcSeconds != 0) {
+    // GPS time: weeks since 1980-01-06, which is 7300 days before 2000
+    uint32_t gpsSeconds = utcSeconds + 7300UL * 86400 + UBX_GPS_LEAP_SECONDS;
+    hint.wn = (uint16_t)(gpsSeconds / 604800);
+    hint.tow = (gpsSeconds % 604800) * 1000;
+    hint.tAccMs = timeAccuracyMs;
+    hint.flags |= UBX_AID_INI_TIME;
+  }
+  ubxSend(*gpsSerial, UBX_CLASS_AID, UBX_AID_INI, (const uint8_t *)&hint,
+          sizeof(hint));
+}
+
+void GPSModule::requestFixBy(unsigned long deadline) {
+  fixDeadline.store(deadline, std::memory_order_relaxed);
+}
+
+unsigned long GPSModule::getPollInterval() const {
+  return getPowerState() == GPS_POWER_BACKUP ? GPS_BACKUP_POLL_MS
+                                             : GPS_TASK_DELAY_MS;
+}
+
+bool GPSModule::getBackupEnd(unsigned long &end) const {
+  if (powerState.load(std::memory_order_acquire) != GPS_POWER_BACKUP)
+    return false;
+  end = wakeAt;
+  return true;
+}
+
+void GPSModule::enterBackup(unsigned long durationMs) {
+  uint8_t payload[8];
+  ubxPutU32(payload, durationMs);
+  ubxPutU32(payload + 4, UBX_PMREQ_BACKUP);
+  ubxSend(*gpsSerial, UBX_CLASS_RXM, UBX_RXM_PMREQ, payload, sizeof(payload));
+  gpsSerial->flush(); // Not acknowledged; the output just stops
+}
+
+void GPSModule::wakeUp(unsigned long now) {
+  gpsSerial->write((uint8_t)0xFF);
+  gpsSerial->flush();
+  wokeAt = now;
+}
+
+void GPSModule::managePower(unsigned long now) {
+#if GPS_BACKUP_ENABLED
+  unsigned long deadline = fixDeadline.load(std::memory_order_relaxed);
+
+  switch (getPowerState()) {
+  case GPS_POWER_TRACKING:
+    // The loop moved the deadline on: it has the fix it needed
+    if (deadline != 0 && (long)(deadline - now) >= GPS_BACKUP_MIN_MS) {
+      wakeAt = deadline - GPS_HOT_START_MS;
+      enterBackup(wakeAt - now);
+      backupCount++;
+      // Release: getBackupEnd() reads wakeAt after seeing this
+      powerState.store(GPS_POWER_BACKUP, std::memory_order_release);
+      DEBUG_PRINT("GPS: backup for ");
+      DEBUG_PRINT((wakeAt - now) / 1000);
+      DEBUG_PRINTLN(" s");
+    }
+    break;
+
+  case GPS_POWER_BACKUP:
+    // Timed out, a fix is wanted sooner than planned, or a settings change
+    // is waiting
+    if (deadline == 0 || (long)(now - wakeAt) >= 0 ||
+        (long)(deadline - GPS_HOT_START_MS - wakeAt) < 0 ||
+        configRequest.load(std::memory_order_relaxed) == CONFIG_REQUESTED) {
+      wakeUp(now);
+      // On schedule, the receiver's own timer started it at wakeAt
+      if ((long)(now - wakeAt) >= 0)
+        wokeAt = wakeAt;
+      powerState.store(GPS_POWER_ACQUIRING, std::memory_order_relaxed);
+    }
+    break;
+
+  case GPS_POWER_ACQUIRING:
+    if (fix.locationValid && (long)(fix.locationMillis - wokeAt) > 0) {
+      wakeToFixMs = now - wokeAt;
+      powerState.store(GPS_POWER_TRACKING, std::memory_order_relaxed);
+      DEBUG_PRINT("GPS: fix ");
+      DEBUG_PRINT(wakeToFixMs);
+      DEBUG_PRINTLN(" ms after wake-up");
+    } else if (now - wokeAt >= GPS_ACQUIRE_TIMEOUT_MS) {
+      DEBUG_PRINTLN("GPS: no fix after wake-up");
+      powerState.store(GPS_POWER_TRACKING, std::memory_order_relaxed);
+    }
+    break;
+  }
+#else
+  (void)now;
+#endif
+}
+
+#if GPS_UBX_MODE
+bool GPSModule::configureUbx() {
+  static const uint8_t NAV_MESSAGES[] = {UBX_NAV_POSLLH, UBX_NAV_SOL,
+                                         UBX_NAV_VELNED, UBX_NAV_TIMEUTC};
+  if (!isInitialized)
+    return false;
+
+  DEBUG_PRINTLN("GPS: switching to UBX output...");
+
+  // Drop an answer left over from the baud rate negotiation
+  bool acknowledged;
+  ubx.takeAck(UBX_CLASS_CFG, UBX_CFG_PRT, acknowledged);
+
+  bool ok = true;
+  for (uint8_t id : NAV_MESSAGES)
+    ok = ok && setMessageRate(UBX_CLASS_NAV, id, 1);
+
+  // CFG-PRT at the current rate: only the output protocol changes
+  if (ok) {
+    sendPortConfig(baudRate, UBX_PROTO_UBX);
+    ok = waitAck(UBX_CFG_PRT);
+  }
+
+  if (!ok) {
+    // Old firmware or a one-way link: keep (or restore) NMEA output
+    DEBUG_PRINTLN("GPS: UBX configuration not acknowledged, staying on NMEA");
+    sendPortConfig(baudRate);
+    for (uint8_t id : NAV_MESSAGES)
+      setMessageRate(UBX_CLASS_NAV, id, 0);
+    ubxActive = false;
+    return false;
+  }
+
+  DEBUG_PRINTLN("GPS: UBX NAV output enabled");
+  ubxActive = true;
+  return true;
+}
+#endif
+
 void GPSModule::update() {
   if (!isInitialized)
     return;
+  StageTimer timer(METRIC_GPS_UPDATE);
+
+  // Settings change from the network loop (MQTT command). The receiver
+  // only answers once awake: managePower() ends a backup early for it and
+  // the change waits until the hot start is over.
+  if (configRequest.load(std::memory_order_acquire) == CONFIG_REQUESTED &&
+      getPowerState() == GPS_POWER_TRACKING) {
+    bool applied = applyConfig(requestedConfig);
+    configRequest.store(applied ? CONFIG_APPLIED : CONFIG_FAILED,
+                        std::memory_order_release);
+  }
 
-  // Read available GPS data
   unsigned long startTime = millis();
+  managePower(startTime);
+
+#if GPS_BULK_INGEST
+  // Drain the UART in blocks straight into the parser's buffer
+  int pending;
+  while ((pending = gpsSerial->available()) > 0 &&
+         (millis() - startTime) < GPS_READ_DURATION_MS) {
+    size_t space;
+#if GPS_UBX_MODE
+    if (ubxActive) {
+      uint8_t *dst = ubx.writeSpace(space);
+      if (space > (size_t)pending)
+        space = pending;
+      ubx.commit(gpsSerial->readBytes(dst, space));
+      ubx.process(fix, millis());
+      continue;
+    }
+#endif
+    uint8_t *dst = nmea.writeSpace(space);
+    if (space > (size_t)pending)
+      space = pending;
+    size_t received = gpsSerial->readBytes(dst, space);
+
+// Debug: Print raw NMEA data (optional, can be disabled for performance)
+#if ENABLE_DEBUG && 0 // Set to 1 to enable NMEA output
+    DEBUG_SERIAL.write(dst, received);
+#endif
+
+    nmea.commit(received);
+    nmea.process(fix, millis());
+  }
+#else
+  // Read available GPS data
   while (gpsSerial->available() > 0 &&
          (millis() - startTime) < GPS_READ_DURATION_MS) {
     char c = gpsSerial->read();
@@ -32,82 +467,156 @@ void GPSModule::update() {
 #endif
   }
 
+  syncFix();
+#endif
+
+  fix.charsProcessed = getCharsProcessed();
+
   // Update last valid data time if location is valid
-  if (gps.location.isValid()) {
+  if (fix.locationValid) {
     lastValidDataTime = millis();
   }
 }
 
+#if !GPS_BULK_INGEST
+void GPSModule::syncFix() {
+  if (gps.location.isUpdated()) {
+    fix.latitude = gps.location.lat();
+    fix.longitude = gps.location.lng();
+    fix.locationValid = gps.location.isValid();
+    fix.locationMillis = millis() - gps.location.age();
+  }
+  if (gps.altitude.isUpdated()) {
+    fix.altitude = gps.altitude.meters();
+    fix.altitudeValid = gps.altitude.isValid();
+  }
+  if (gps.speed.isUpdated()) {
+    fix.speedKmph = gps.speed.kmph();
+    fix.speedValid = gps.speed.isValid();
+  }
+  if (gps.course.isUpdated()) {
+    fix.courseDeg = gps.course.deg();
+    fix.courseValid = gps.course.isValid();
+  }
+  if (gps.satellites.isUpdated()) {
+    fix.satellites = (uint8_t)gps.satellites.value();
+    fix.satellitesValid = gps.satellites.isValid();
+  }
+  if (gps.hdop.isUpdated()) {
+    fix.hdop = gps.hdop.hdop();
+    fix.hdopValid = gps.hdop.isValid();
+  }
+  if (gps.date.isUpdated()) {
+    fix.year = gps.date.year();
+    fix.month = gps.date.month();
+    fix.day = gps.date.day();
+    fix.dateValid = gps.date.isValid();
+  }
+  if (gps.time.isUpdated()) {
+    fix.hour = gps.time.hour();
+    fix.minute = gps.time.minute();
+    fix.second = gps.time.second();
+    fix.centisecond = gps.time.centisecond();
+    fix.timeValid = gps.time.isValid();
+  }
+}
+#endif
+
 bool GPSModule::hasValidLocation() {
   if (!isInitialized)
     return false;
 
-  return gps.location.isValid() &&
-         gps.location.age() <
-             GPS_DATA_MAX_AGE_MS; // Data less than 2 seconds old
+  return fix.hasLocation(millis()); // Data less than 2 seconds old
 }
 
 double GPSModule::getLatitude() {
   if (hasValidLocation()) {
-    return gps.location.lat();
+    return fix.latitude;
   }
   return 0.0;
 }
 
 double GPSModule::getLongitude() {
   if (hasValidLocation()) {
-    return gps.location.lng();
+    return fix.longitude;
   }
   return 0.0;
 }
 
 double GPSModule::getAltitude() {
-  if (gps.altitude.isValid()) {
-    return gps.altitude.meters();
+  if (fix.altitudeValid) {
+    return fix.altitude;
   }
   return 0.0;
 }
 
 double GPSModule::getSpeed() {
-  if (gps.speed.isValid()) {
-    return gps.speed.kmph();
+  if (fix.speedValid) {
+    return fix.speedKmph;
   }
   return 0.0;
 }
 
 int GPSModule::getSatellites() {
-  if (gps.satellites.isValid()) {
-    return gps.satellites.value();
+  if (fix.satellitesValid) {
+    return fix.satellites;
   }
   return 0;
 }
 
-unsigned long GPSModule::getCharsProcessed() { return gps.charsProcessed(); }
+unsigned long GPSModule::getCharsProcessed() {
+#if GPS_BULK_INGEST
+  return nmea.getCharsProcessed() + ubx.getBytesProcessed();
+#else
+  return gps.charsProcessed() + ubx.getBytesProcessed();
+#endif
+}
+
+unsigned long GPSModule::getDroppedSentences() {
+#if GPS_BULK_INGEST
+  return nmea.getChecksumFailures() + ubx.getChecksumFailures();
+#else
+  return gps.failedChecksum() + ubx.getChecksumFailures();
+#endif
+}
+
+unsigned long GPSModule::getDroppedBytes() {
+#if GPS_BULK_INGEST
+  return nmea.getDroppedBytes() + ubx.getDroppedBytes();
+#else
+  return ubx.getDroppedBytes();
+#endif
+}
 
-String GPSModule::getDateTime() {
-  if (gps.date.isValid() && gps.time.isValid()) {
-    char datetime[32];
-    sprintf(datetime, "%04d-%02d-%02d %02d:%02d:%02d", gps.date.year(),
-            gps.date.month(), gps.date.day(), gps.time.hour(),
-            gps.time.minute(), gps.time.second());
-    return String(datetime);
+size_t GPSModule::getDateTime(char *buffer, size_t capacity) {
+  int written;
+  if (fix.dateValid && fix.timeValid) {
+    written = snprintf(buffer, capacity, "%04d-%02d-%02d %02d:%02d:%02d",
+                       fix.year, fix.month, fix.day, fix.hour, fix.minute,
+                       fix.second);
+  } else {
+    written = snprintf(buffer, capacity, "Invalid");
   }
-  return "Invalid";
+  return (written > 0 && (size_t)written < capacity) ? (size_t)written : 0;
 }
 
-String GPSModule::getLocationJSON() {
-  String json = "{";
-  json += "\"latitude\":" + String(getLatitude(), 6) + ",";
-  json += "\"longitude\":" + String(getLongitude(), 6) + ",";
-  json += "\"altitude\":" + String(getAltitude(), 2) + ",";
-  json += "\"speed\":" + String(getSpeed(), 2) + ",";
-  json += "\"satellites\":" + String(getSatellites()) + ",";
-  json += "\"datetime\":\"" + getDateTime() + "\",";
-  json += "\"valid\":" + String(hasValidLocation() ? "true" : "false");
-  json += "}";
-  return json;
+size_t GPSModule::getLocationJSON(char *buffer, size_t capacity) {
+  char datetime[24];
+  getDateTime(datetime, sizeof(datetime));
+
+  JsonWriter json(buffer, capacity);
+  json.beginObject();
+  json.field("latitude", getLatitude(), 6);
+  json.field("longitude", getLongitude(), 6);
+  json.field("altitude", getAltitude(), 2);
+  json.field("speed", getSpeed(), 2);
+  json.field("satellites", getSatellites());
+  json.field("datetime", datetime);
+  json.field("valid", hasValidLocation());
+  json.endObject();
+  return json.ok() ? json.size() : 0;
 }
 
 bool GPSModule::isReady() {
-  return isInitialized && gps.charsProcessed() > GPS_MIN_CHARS_PROCESSED;
+  return isInitialized && getCharsProcessed() > GPS_MIN_CHARS_PROCESSED;
 }
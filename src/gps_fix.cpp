@@ -0,0 +1,44 @@
+#include "gps_fix.h"
+
+// Days since 2000-01-01 for a Gregorian date (Howard Hinnant's algorithm)
+static int32_t daysFromCivil(int year, unsigned month, unsigned day) {
+  year -= month <= 2;
+  int32_t era = (year >= 0 ? year : year - 399) / 400;
+  unsigned yoe = (unsigned)(year - era * 400);
+  unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int32_t)doe - 730425;
+}
+
+static void civilFromDays(int32_t days, uint16_t &year, uint8_t &month,
+                          uint8_t &day) {
+  days += 730425;
+  int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+  unsigned doe = (unsigned)(days - era * 146097);
+  unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  unsigned mp = (5 * doy + 2) / 153;
+  day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+  month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+  year = (uint16_t)(yoe + era * 400 + (month <= 2));
+}
+
+uint32_t GpsFix::utcSeconds() const {
+  if (!dateValid || !timeValid)
+    return 0;
+  int32_t days = daysFromCivil(year, month, day);
+  if (days < 0)
+    return 0;
+  return (uint32_t)days * 86400UL + hour * 3600UL + minute * 60UL + second;
+}
+
+void GpsFix::setUtcSeconds(uint32_t seconds) {
+  civilFromDays((int32_t)(seconds / 86400), year, month, day);
+  uint32_t secondOfDay = seconds % 86400;
+  hour = (uint8_t)(secondOfDay / 3600);
+  minute = (uint8_t)(secondOfDay / 60 % 60);
+  second = (uint8_t)(secondOfDay % 60);
+  centisecond = 0;
+  dateValid = true;
+  timeValid = true;
+}
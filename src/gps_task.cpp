@@ -0,0 +1,67 @@
+#include "gps_task.h"
+
+#if defined(ESP32)
+
+#include <esp_task_wdt.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+struct GPSTaskContext {
+  GPSModule *gps;
+  FixSnapshot *snapshot;
+};
+
+static GPSTaskContext taskContext;
+static TaskHandle_t gpsTaskHandle = nullptr;
+
+static void gpsTask(void *param) {
+  GPSTaskContext *ctx = (GPSTaskContext *)param;
+
+  // Subscribe to the task watchdog; update() is bounded by
+  // GPS_READ_DURATION_MS so one period never comes close to the timeout
+  bool watched = esp_task_wdt_add(nullptr) == ESP_OK;
+
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;) {
+    ctx->gps->update();
+    ctx->snapshot->publish(ctx->gps->getFix());
+
+    if (watched) {
+      esp_task_wdt_reset();
+    }
+    // Slower while the receiver is in backup and sends nothing
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(ctx->gps->getPollInterval()));
+  }
+}
+
+bool startGPSTask(GPSModule *gps, FixSnapshot *snapshot) {
+  if (gpsTaskHandle) {
+    return true;
+  }
+
+  taskContext.gps = gps;
+  taskContext.snapshot = snapshot;
+
+  BaseType_t result = xTaskCreatePinnedToCore(
+      gpsTask, "gps_ingest", GPS_TASK_STACK_SIZE, &taskContext,
+      GPS_TASK_PRIORITY, &gpsTaskHandle, GPS_TASK_CORE);
+
+  if (result != pdPASS) {
+    gpsTaskHandle = nullptr;
+    DEBUG_PRINTLN("✗ Failed to create GPS task");
+    return false;
+  }
+
+  return true;
+}
+
+#else
+
+// No scheduler on the host build; loop() ingests inline instead
+bool startGPSTask(GPSModule *gps, FixSnapshot *snapshot) {
+  (void)gps;
+  (void)snapshot;
+  return false;
+}
+
+#endif
@@ -1,8 +1,101 @@
 #include "gsm.h"
 
+// One command of the GPRS attach sequence (GSM_ATTACHING)
+struct AttachStep {
+  const char *command; // nullptr: built at runtime (AT+CSTT with the APN)
+  unsigned long timeoutMs;
+  const char *finalLine;
+};
+
+// Timeouts are the SIM800 maximum response times
+static const AttachStep ATTACH_STEPS[] = {
+    {"+CIPSHUT", 65000, "SHUT OK"},
+    {"+CGATT=1", 75000, nullptr},
+    {"+CIPMUX=1", 1000, nullptr},
+    {"+CIPQSEND=1", 1000, nullptr},
+    {"+CIPRXGET=1", 1000, nullptr},
+    {nullptr, 60000, nullptr},
+    {"+CIICR", 85000, nullptr},
+    // ";E0" makes the modem end the bare address line with an OK
+    {"+CIFSR;E0", 10000, nullptr},
+};
+#define ATTACH_STEP_COUNT (sizeof(ATTACH_STEPS) / sizeof(ATTACH_STEPS[0]))
+
+// GSM_CONFIGURING: echo off, modem info, then the URCs that report link
+// health (+CREG: <stat> on registration changes, +CSQN: on signal changes)
+static const char *const CONFIGURE_COMMANDS[] = {"E0", "I", "+CREG=1",
+                                                 "+EXUNSOL=\"SQ\",1"};
+#define CONFIGURE_COMMAND_COUNT                                                \
+  (sizeof(CONFIGURE_COMMANDS) / sizeof(CONFIGURE_COMMANDS[0]))
+
+const char *gsmStateName(GsmState state) {
+  switch (state) {
+  case GSM_OFF:
+    return "off";
+  case GSM_RESUMING:
+    return "resuming";
+  case GSM_RESETTING:
+    return "resetting";
+  case GSM_BOOTING:
+    return "booting";
+  case GSM_PROBING:
+    return "probing";
+  case GSM_SWITCHING_BAUD:
+    return "switching baud";
+  case GSM_CONFIGURING:
+    return "configuring";
+  case GSM_SIM_CHECK:
+    return "sim check";
+  case GSM_SIGNAL_CHECK:
+    return "signal check";
+  case GSM_REGISTERING:
+    return "registering";
+  case GSM_ATTACHING:
+    return "attaching";
+  case GSM_READY:
+    return "ready";
+  case GSM_FAILED:
+    return "failed";
+  }
+  return "?";
+}
+
+const char *gsmErrorName(GsmError error) {
+  switch (error) {
+  case GSM_ERROR_NONE:
+    return "none";
+  case GSM_ERROR_NO_MODEM:
+    return "modem not responding";
+  case GSM_ERROR_NO_SIM:
+    return "SIM not ready";
+  case GSM_ERROR_NO_SIGNAL:
+    return "no signal";
+  case GSM_ERROR_DENIED:
+    return "registration denied";
+  case GSM_ERROR_REGISTRATION:
+    return "registration timeout";
+  case GSM_ERROR_ATTACH:
+    return "GPRS attach failed";
+  case GSM_ERROR_LINK_LOST:
+    return "link lost";
+  }
+  return "?";
+}
+
 GSMModule::GSMModule()
-    : isInitialized(false), isConnected(false), lastConnectionAttempt(0),
-      gsmSerial(nullptr), modem(nullptr), client(nullptr) {}
+    : modem(nullptr), client(nullptr), gsmSerial(nullptr),
+      isInitialized(false), state(GSM_OFF), lastError(GSM_ERROR_NONE),
+      stateSince(0), nextActionAt(0), commandSent(false),
+      exchangeResult(AT_PENDING), step(0), consecutiveFailures(0),
+      retryInterval(GSM_RETRY_INTERVAL_MS), baudRate(GSM_BAUD),
+      baudFallback(false), health(),
+      statusQueryPending(false), statusTimeouts(0), lastStatusQuery(0),
+      linkLost(false), socketClosed(false), dataPending(false),
+      sleepRequested(false), modemAsleep(false) {
+  command[0] = '\0';
+  reply[0] = '\0';
+  health.signalQuality = 99;
+}
 
 GSMModule::~GSMModule() {
   if (client)
@@ -13,185 +106,659 @@ GSMModule::~GSMModule() {
 }
 
 void GSMModule::hardwareReset() {
-  DEBUG_PRINTLN("Performing hardware reset of SIM800L...");
-  DEBUG_PRINT("Reset pin: ");
-  DEBUG_PRINTLN(SIM800L_RESET_PIN);
+  DEBUG_PRINT("Resetting SIM800L (pin ");
+  DEBUG_PRINT(SIM800L_RESET_PIN);
+  DEBUG_PRINTLN(")...");
 
   pinMode(SIM800L_RESET_PIN, OUTPUT);
-  digitalWrite(SIM800L_RESET_PIN, HIGH);
-  delay(100);
   digitalWrite(SIM800L_RESET_PIN, LOW);
-  delay(200);
-  digitalWrite(SIM800L_RESET_PIN, HIGH);
-
-  DEBUG_PRINTLN("Waiting for SIM800L to boot (5 seconds)...");
-  delay(5000); // Wait longer for module to boot
+  at.abort();
 
-  DEBUG_PRINTLN("SIM800L hardware reset complete");
+  // AT+IPR is not saved: the modem comes back at its default rate
+  if (gsmSerial && baudRate != GSM_BAUD) {
+    gsmSerial->updateBaudRate(GSM_BAUD);
+    baudRate = GSM_BAUD;
+  }
+  enter(GSM_RESETTING);
 }
 
-bool GSMModule::begin(HardwareSerial *serial) {
+bool GSMModule::begin(HardwareSerial *serial, bool warm) {
   DEBUG_PRINTLN("Setting up GSM module...");
 
   gsmSerial = serial;
   // UART is already initialized in main.cpp
 
-  // Perform hardware reset
-  hardwareReset();
-
   // Create modem instance
   modem = new TinyGsm(*gsmSerial);
-  client = new TinyGsmClient(*modem);
+  client = new GsmDataClient(*modem);
+  at.begin(gsmSerial);
 
-  // Check if modem is responding (try multiple times)
-  DEBUG_PRINTLN("Testing modem communication...");
+  // Link health comes from the modem's own reports, not from polling
+  at.onUnsolicited("+CREG:", onRegistrationUrc, this);
+  at.onUnsolicited("+CSQN:", onSignalUrc, this);
+  at.onUnsolicited("+PDP: DEACT", onBearerUrc, this);
+  at.onUnsolicited("CLOSED", onSocketClosedUrc, this);
+  at.onUnsolicited("+CIPRXGET:", onDataUrc, this);
+  at.onUnsolicited("RDY", onModemRestartUrc, this);
 
-  String modemInfo = "";
-  for (int retry = 0; retry < 5; retry++) {
-    DEBUG_PRINT("Attempt ");
-    DEBUG_PRINT(retry + 1);
-    DEBUG_PRINTLN("/5...");
-
-    // Try AT command first
-    modem->testAT();
-    delay(500);
+  isInitialized = true;
 
-    modemInfo = modem->getModemInfo();
-    if (modemInfo.length() > 0) {
-      break;
+  // The rest of bring-up runs from poll()
+  if (warm) {
+    // AT+IPR is kept while the modem runs: try the fast rate first
+    if (GSM_BAUD_FAST != GSM_BAUD) {
+      gsmSerial->updateBaudRate(GSM_BAUD_FAST);
+      baudRate = GSM_BAUD_FAST;
     }
-    delay(1000);
+    enter(GSM_RESUMING);
+  } else {
+    hardwareReset();
+  }
+  return true;
+}
+
+void GSMModule::enter(GsmState next) {
+  state = next;
+  stateSince = millis();
+  nextActionAt = stateSince;
+  commandSent = false;
+  step = 0;
+
+  DEBUG_PRINT("GSM: ");
+  DEBUG_PRINTLN(gsmStateName(next));
+
+  // The bearer exists only in GSM_READY
+  if ((next == GSM_READY) != health.gprsAttached)
+    updateAttach(next == GSM_READY);
+  if (next != GSM_READY && health.socketOpen)
+    setSocketOpen(false);
+
+  // A reset or new bring-up leaves the modem awake with CSCLK=0
+  modemAsleep = false;
+
+  if (next == GSM_READY) {
+    lastError = GSM_ERROR_NONE;
+    consecutiveFailures = 0;
+    retryInterval = GSM_RETRY_INTERVAL_MS;
+    linkLost = false;
+    socketClosed = false;
+    statusQueryPending = false;
+    statusTimeouts = 0;
+    lastStatusQuery = stateSince;
   }
+}
 
-  DEBUG_PRINT("Modem Info: ");
-  DEBUG_PRINTLN(modemInfo);
+void GSMModule::fail(GsmError error) {
+  at.abort();
+  lastError = error;
+  if (consecutiveFailures < 255)
+    consecutiveFailures++;
+
+  DEBUG_PRINT("✗ GSM bring-up failed: ");
+  DEBUG_PRINT(gsmErrorName(error));
+  DEBUG_PRINT(", retry in ");
+  DEBUG_PRINT(retryInterval / 1000);
+  DEBUG_PRINTLN(" s");
+
+  enter(GSM_FAILED);
+  nextActionAt = stateSince + retryInterval;
+  retryInterval =
+      min(retryInterval * 2, (unsigned long)GSM_RETRY_MAX_INTERVAL_MS);
+}
 
-  if (modemInfo.length() == 0) {
-    DEBUG_PRINTLN("✗ Modem not responding!");
-    DEBUG_PRINTLN("Check: Power supply (3.7-4.2V, 2A), UART pins, antenna");
+void GSMModule::onExchange(void *context, AtResult result,
+                           const char *response) {
+  GSMModule *gsm = (GSMModule *)context;
+  gsm->exchangeResult = result;
+  strncpy(gsm->reply, response, sizeof(gsm->reply) - 1);
+  gsm->reply[sizeof(gsm->reply) - 1] = '\0';
+}
+
+bool GSMModule::exchange(const char *cmd, unsigned long timeout,
+                         AtResult &result, const char *finalLine) {
+  if (!commandSent) {
+    exchangeResult = AT_PENDING;
+    commandSent = at.submit(cmd, timeout, onExchange, this, 0, finalLine);
     return false;
   }
+  if (exchangeResult == AT_PENDING)
+    return false;
+  result = exchangeResult;
+  commandSent = false;
+  return true;
+}
 
-  isInitialized = true;
-  DEBUG_PRINTLN("✓ GSM module initialized on UART1");
+GsmState GSMModule::poll() {
+  // Replies, URCs and queued commands move on every call
+  at.poll();
 
-  return true;
+  // Acted on here rather than in the callbacks, outside at.poll()
+  if (socketClosed && !at.isBusy()) {
+    socketClosed = false;
+    if (state == GSM_READY && client) {
+      DEBUG_PRINTLN("GSM: socket closed by the network");
+      client->stop();
+    }
+  }
+  if (linkLost) {
+    linkLost = false;
+    if (state > GSM_PROBING && state <= GSM_READY)
+      fail(GSM_ERROR_LINK_LOST);
+  }
+
+  unsigned long now = millis();
+  if ((long)(now - nextActionAt) < 0)
+    return state;
+
+  switch (state) {
+  case GSM_OFF:
+    break;
+
+  case GSM_READY:
+    // commandSent: a sleep or wake exchange is still in flight
+    if (sleepRequested != modemAsleep || commandSent)
+      pollSleep();
+    else if (!modemAsleep && now - lastStatusQuery >= GSM_STATUS_QUERY_MS)
+      queryStatus();
+    break;
+
+  case GSM_RESETTING:
+    if (now - stateSince >= SIM800L_RESET_PULSE_MS) {
+      digitalWrite(SIM800L_RESET_PIN, HIGH);
+      enter(GSM_BOOTING);
+      nextActionAt = stateSince + SIM800L_BOOT_MS;
+    }
+    break;
+
+  case GSM_BOOTING:
+    enter(GSM_PROBING);
+    break;
+
+  case GSM_RESUMING:
+    pollResume(now);
+    break;
+
+  case GSM_PROBING:
+    pollProbe(now);
+    break;
+
+  case GSM_SWITCHING_BAUD:
+    pollBaudSwitch(now);
+    break;
+
+  case GSM_CONFIGURING:
+    pollConfigure();
+    break;
+
+  case GSM_SIM_CHECK:
+    pollSimCheck(now);
+    break;
+
+  case GSM_SIGNAL_CHECK:
+    pollSignalCheck(now);
+    break;
+
+  case GSM_REGISTERING:
+    pollRegistration(now);
+    break;
+
+  case GSM_ATTACHING:
+    pollAttach(now);
+    break;
+
+  case GSM_FAILED:
+    // Repeated failures start over from a hardware reset
+    if (consecutiveFailures >= GSM_RESET_AFTER_FAILURES ||
+        lastError == GSM_ERROR_NO_MODEM) {
+      consecutiveFailures = 0;
+      hardwareReset();
+    } else {
+      enter(GSM_PROBING);
+    }
+    break;
+  }
+  return state;
 }
 
-bool GSMModule::connectGPRS() {
-  if (!isInitialized) {
-    DEBUG_PRINTLN("GSM not initialized!");
-    return false;
+void GSMModule::pollResume(unsigned long now) {
+  AtResult result;
+  if (step == 0) {
+    // Retried: a modem left in AT+CSCLK=2 sleep loses the first character
+    if (!exchange("", 300, result))
+      return;
+    if (result == AT_OK) {
+      step = 1;
+    } else if (now - stateSince >= GSM_RESUME_TIMEOUT_MS) {
+      DEBUG_PRINTLN("GSM: no answer from a running modem, resetting");
+      hardwareReset();
+    } else if (now - stateSince >= GSM_RESUME_TIMEOUT_MS / 2 &&
+               baudRate != GSM_BAUD) {
+      // It may have fallen back to the default rate last time
+      gsmSerial->updateBaudRate(GSM_BAUD);
+      baudRate = GSM_BAUD;
+    }
+    return;
   }
 
-  // Don't attempt to reconnect too frequently
-  if (millis() - lastConnectionAttempt < MQTT_RECONNECT_INTERVAL) {
-    return isConnected;
+  if (step == 1) {
+    if (!exchange("+CSCLK=0;+CSQ;+CREG?;+CGATT?", 1000, result))
+      return;
+    const char *signal = atFind(reply, "+CSQ:");
+    if (signal)
+      updateSignal(atoi(signal));
+    const char *value = atFind(reply, "+CREG:");
+    const char *comma = value ? strchr(value, ',') : nullptr;
+    int status = comma ? atoi(comma + 1) : -1;
+    if (status >= 0)
+      updateRegistration(status);
+    const char *attach = atFind(reply, "+CGATT:");
+
+    if (result != AT_OK || (status != 1 && status != 5)) {
+      enter(GSM_PROBING); // Bring-up starts over, without the reset
+    } else if (!attach || atoi(attach) != 1) {
+      enter(GSM_ATTACHING);
+    } else {
+      step = 2;
+    }
+    return;
   }
 
-  lastConnectionAttempt = millis();
+  // Registered and attached: the bearer may still hold its address
+  if (!exchange("+CIFSR;E0", 10000, result))
+    return;
+  if (result == AT_OK && reply[0] >= '0' && reply[0] <= '9') {
+    DEBUG_PRINT("✓ Warm start: bearer kept, IP: ");
+    DEBUG_PRINTLN(reply);
+    enter(GSM_READY);
+  } else {
+    enter(GSM_ATTACHING);
+  }
+}
 
-  // Check SIM card status first
-  DEBUG_PRINTLN("Checking SIM card status...");
-  int simStatus = modem->getSimStatus();
-  DEBUG_PRINT("SIM Status: ");
-  DEBUG_PRINTLN(simStatus);
+void GSMModule::pollProbe(unsigned long now) {
+  AtResult result;
+  if (!exchange("", 500, result))
+    return;
 
-  if (simStatus != 1 && simStatus != 5) {
-    DEBUG_PRINTLN("✗ SIM card not ready!");
-    DEBUG_PRINTLN("  Possible issues:");
-    DEBUG_PRINTLN("  - SIM card not inserted");
-    DEBUG_PRINTLN("  - SIM card not detected");
-    DEBUG_PRINTLN("  - PIN code required");
-    return false;
+  if (result == AT_OK) {
+    bool faster = GSM_BAUD_FAST != GSM_BAUD && !baudFallback &&
+                  baudRate != GSM_BAUD_FAST;
+    enter(faster ? GSM_SWITCHING_BAUD : GSM_CONFIGURING);
+  } else if (now - stateSince >= GSM_PROBE_TIMEOUT_MS) {
+    DEBUG_PRINTLN("Check: Power supply (3.7-4.2V, 2A), UART pins, antenna");
+    fail(GSM_ERROR_NO_MODEM);
+  } else {
+    nextActionAt = now + 500;
   }
-  DEBUG_PRINTLN("✓ SIM card detected");
+}
 
-  // Check signal strength before registration
-  int signalBefore = modem->getSignalQuality();
-  DEBUG_PRINT("Signal strength: ");
-  DEBUG_PRINT(signalBefore);
-  DEBUG_PRINTLN(" (0-31, 99=unknown)");
+void GSMModule::pollBaudSwitch(unsigned long now) {
+  AtResult result;
+  if (step == 0) {
+    snprintf(command, sizeof(command), "+IPR=%lu",
+             (unsigned long)GSM_BAUD_FAST);
+    if (!exchange(command, 1000, result))
+      return;
+    if (result != AT_OK) {
+      DEBUG_PRINTLN("GSM: AT+IPR rejected, staying at default baud");
+      baudFallback = true;
+      enter(GSM_CONFIGURING);
+      return;
+    }
+    // The OK came at the old rate; everything after it at the new one
+    gsmSerial->updateBaudRate(GSM_BAUD_FAST);
+    baudRate = GSM_BAUD_FAST;
+    step = 1;
+    return;
+  }
 
-  if (signalBefore == 0 || signalBefore == 99) {
-    DEBUG_PRINTLN("✗ No signal! Check antenna connection");
-    return false;
+  if (!exchange("", 200, result))
+    return;
+  if (result == AT_OK) {
+    DEBUG_PRINT("GSM: link at ");
+    DEBUG_PRINT(baudRate);
+    DEBUG_PRINTLN(" baud");
+    enter(GSM_CONFIGURING);
+  } else if (now - stateSince >= GSM_BAUD_VERIFY_MS) {
+    // Modem state unknown: a reset brings it back to the default rate
+    DEBUG_PRINTLN("GSM: no answer at the new rate, falling back");
+    baudFallback = true;
+    fail(GSM_ERROR_NO_MODEM);
+  } else {
+    nextActionAt = now + 200;
   }
+}
 
-  DEBUG_PRINTLN("Waiting for network registration...");
-  DEBUG_PRINTLN("This may take 15-60 seconds...");
+void GSMModule::pollConfigure() {
+  AtResult result;
+  if (!exchange(CONFIGURE_COMMANDS[step], 1000, result))
+    return;
 
-  // Wait for network
-  if (!modem->waitForNetwork(GSM_TIMEOUT)) {
-    DEBUG_PRINTLN("✗ Network registration failed!");
-    DEBUG_PRINTLN("  Troubleshooting:");
-    DEBUG_PRINTLN("  1. Check antenna is properly connected");
-    DEBUG_PRINTLN("  2. Verify SIM card is activated");
-    DEBUG_PRINTLN("  3. Move to area with better signal");
-    DEBUG_PRINTLN("  4. Check SIM card has credit/active plan");
-    DEBUG_PRINTLN("  5. Try increasing GSM_TIMEOUT in config.h");
+  // Failures are not fatal: without URCs the status queries still run
+  if (step == 1 && result == AT_OK) {
+    DEBUG_PRINT("Modem Info: ");
+    DEBUG_PRINTLN(reply);
+  }
+  if (++step >= CONFIGURE_COMMAND_COUNT)
+    enter(GSM_SIM_CHECK);
+}
+
+void GSMModule::pollSimCheck(unsigned long now) {
+  AtResult result;
+  if (!exchange("+CPIN?", 5000, result))
+    return;
+
+  const char *status = atFind(reply, "+CPIN:");
+  if (result == AT_OK && status && !strncmp(status, "READY", 5)) {
+    DEBUG_PRINTLN("✓ SIM card detected");
+    enter(GSM_SIGNAL_CHECK);
+  } else if (now - stateSince >= GSM_SIM_TIMEOUT_MS) {
+    DEBUG_PRINTLN("  SIM not inserted, not detected or PIN required");
+    fail(GSM_ERROR_NO_SIM);
+  } else {
+    nextActionAt = now + 1000;
+  }
+}
 
-    // Try to get operator name even if not registered
-    String cop = modem->getOperator();
-    DEBUG_PRINT("  Operator detected: ");
-    DEBUG_PRINTLN(cop.length() > 0 ? cop : "None");
+void GSMModule::pollSignalCheck(unsigned long now) {
+  AtResult result;
+  if (!exchange("+CSQ", 1000, result))
+    return;
+
+  const char *value = atFind(reply, "+CSQ:");
+  if (result == AT_OK && value)
+    updateSignal(atoi(value));
+
+  int signalQuality = health.signalQuality;
+  if (signalQuality > 0 && signalQuality != 99) {
+    DEBUG_PRINT("Signal strength: ");
+    DEBUG_PRINT(signalQuality);
+    DEBUG_PRINTLN(" (0-31)");
+    enter(GSM_REGISTERING);
+  } else if (now - stateSince >= GSM_SIGNAL_TIMEOUT_MS) {
+    DEBUG_PRINTLN("  Check antenna connection");
+    fail(GSM_ERROR_NO_SIGNAL);
+  } else {
+    nextActionAt = now + 1000;
+  }
+}
 
-    return false;
+void GSMModule::pollRegistration(unsigned long now) {
+  AtResult result;
+  if (!exchange("+CREG?", 1000, result))
+    return;
+
+  // "+CREG: <n>,<stat>": 1 home, 5 roaming, 3 denied
+  const char *value = atFind(reply, "+CREG:");
+  const char *comma = value ? strchr(value, ',') : nullptr;
+  int status = comma ? atoi(comma + 1) : -1;
+  if (status >= 0)
+    updateRegistration(status);
+
+  if (result == AT_OK && (status == 1 || status == 5)) {
+    DEBUG_PRINTLN(status == 5 ? "✓ Network registered (roaming)"
+                              : "✓ Network registered");
+    enter(GSM_ATTACHING);
+  } else if (status == 3) {
+    fail(GSM_ERROR_DENIED);
+  } else if (now - stateSince >= GSM_TIMEOUT) {
+    DEBUG_PRINTLN("  Check antenna, SIM activation and credit, coverage");
+    fail(GSM_ERROR_REGISTRATION);
+  } else {
+    nextActionAt = now + 1000;
+  }
+}
+
+void GSMModule::pollAttach(unsigned long now) {
+  const AttachStep &attach = ATTACH_STEPS[step];
+  const char *cmd = attach.command;
+  if (!cmd) {
+    snprintf(command, sizeof(command), "+CSTT=\"%s\",\"%s\",\"%s\"", APN,
+             GPRS_USER, GPRS_PASS);
+    cmd = command;
   }
 
-  DEBUG_PRINTLN("✓ Network registered");
+  AtResult result;
+  if (!exchange(cmd, attach.timeoutMs, result, attach.finalLine))
+    return;
 
-  // Show network info
-  String networkOperator = modem->getOperator();
-  DEBUG_PRINT("Operator: ");
-  DEBUG_PRINTLN(networkOperator);
+  if (result != AT_OK) {
+    DEBUG_PRINT("  AT");
+    DEBUG_PRINT(cmd);
+    DEBUG_PRINTLN(result == AT_TIMEOUT ? " timed out" : " failed");
+    fail(GSM_ERROR_ATTACH);
+    return;
+  }
 
-  // Get signal quality
-  int signal = modem->getSignalQuality();
-  DEBUG_PRINT("Signal quality: ");
-  DEBUG_PRINT(signal);
-  DEBUG_PRINTLN("/31");
+  if ((size_t)step + 1 < ATTACH_STEP_COUNT) {
+    step++;
+    if (now - stateSince >= GSM_ATTACH_TIMEOUT_MS)
+      fail(GSM_ERROR_ATTACH);
+    return;
+  }
 
-  DEBUG_PRINT("Connecting to APN: ");
-  DEBUG_PRINTLN(APN);
+  // Last step: the response is the local address
+  const char *ip = reply;
+  if (*ip < '0' || *ip > '9') {
+    fail(GSM_ERROR_ATTACH);
+    return;
+  }
+  DEBUG_PRINT("GPRS connected! IP: ");
+  DEBUG_PRINTLN(ip);
+  enter(GSM_READY);
+}
 
-  if (!modem->gprsConnect(APN, GPRS_USER, GPRS_PASS)) {
-    DEBUG_PRINTLN("GPRS connection failed!");
-    isConnected = false;
+bool GSMModule::connectGPRS() {
+  if (!isInitialized) {
+    DEBUG_PRINTLN("GSM not initialized!");
     return false;
   }
 
-  DEBUG_PRINTLN("GPRS connected!");
-  isConnected = true;
-
-  return true;
+  if (state == GSM_READY)
+    return true;
+  if (state == GSM_OFF) {
+    enter(GSM_PROBING);
+  } else if (state == GSM_FAILED) {
+    nextActionAt = millis(); // Skip the rest of the back-off
+  }
+  return false;
 }
 
 void GSMModule::disconnectGPRS() {
-  if (isInitialized && isConnected) {
+  if (state == GSM_READY) {
+    at.abort(); // TinyGsm needs the UART to itself
     modem->gprsDisconnect();
-    isConnected = false;
     DEBUG_PRINTLN("GPRS disconnected");
   }
+  at.abort();
+  enter(GSM_OFF);
 }
 
 bool GSMModule::isGPRSConnected() {
-  if (!isInitialized)
-    return false;
+  // Lost links are reported by URCs and status queries; see poll()
+  return state == GSM_READY;
+}
+
+void GSMModule::pollSleep() {
+  AtResult result;
+  if (!modemAsleep) {
+    // Let a status query finish first
+    if (!commandSent && at.isBusy())
+      return;
+    if (!exchange("+CSCLK=2", 1000, result))
+      return;
+    modemAsleep = result == AT_OK;
+    if (!modemAsleep) {
+      DEBUG_PRINTLN("GSM: AT+CSCLK=2 rejected, modem stays awake");
+      sleepRequested = false;
+    }
+    return;
+  }
+
+  // The modem loses the character that wakes it: a bare AT goes first and
+  // whatever it gets back is ignored
+  if (step == 0) {
+    if (exchange("", GSM_WAKE_PROBE_MS, result))
+      step = 1;
+    return;
+  }
+  if (!exchange("+CSCLK=0", 1000, result))
+    return;
+  step = 0;
+  if (result == AT_OK) {
+    modemAsleep = false;
+  } else {
+    DEBUG_PRINTLN("GSM: modem did not wake from sleep");
+    fail(GSM_ERROR_NO_MODEM);
+  }
+}
+
+void GSMModule::queryStatus() {
+  if (state != GSM_READY || statusQueryPending)
+    return;
+
+  // Independent queries: one command line, one round trip
+  bool queued = at.submit("+CSQ", 1000, onSignalReply, this, AT_JOIN) &&
+                at.submit("+CREG?", 1000, onRegistrationReply, this,
+                          AT_JOIN) &&
+                at.submit("+CGATT?", 1000, onAttachReply, this, AT_JOIN);
+  statusQueryPending = queued;
+  lastStatusQuery = millis();
+}
+
+void GSMModule::onSignalReply(void *context, AtResult result,
+                              const char *response) {
+  GSMModule *gsm = (GSMModule *)context;
+  const char *value = atFind(response, "+CSQ:");
+  if (result == AT_OK && value)
+    gsm->updateSignal(atoi(value));
+}
+
+void GSMModule::onRegistrationReply(void *context, AtResult result,
+                                    const char *response) {
+  GSMModule *gsm = (GSMModule *)context;
+  const char *value = atFind(response, "+CREG:");
+  if (result != AT_OK || !value)
+    return;
+  const char *comma = strchr(value, ',');
+  gsm->updateRegistration(atoi(comma ? comma + 1 : value));
+}
+
+void GSMModule::onAttachReply(void *context, AtResult result,
+                              const char *response) {
+  // Last of the pipelined status queries
+  GSMModule *gsm = (GSMModule *)context;
+  gsm->statusQueryPending = false;
+
+  if (result == AT_TIMEOUT) {
+    // Twice in a row: the modem has stopped answering
+    if (++gsm->statusTimeouts >= 2)
+      gsm->linkLost = true;
+    return;
+  }
+  gsm->statusTimeouts = 0;
+
+  const char *value = atFind(response, "+CGATT:");
+  if (result != AT_OK || !value)
+    return;
+  if (atoi(value) == 1) {
+    gsm->updateAttach(true); // Refresh the timestamp
+  } else if (gsm->state == GSM_READY) {
+    DEBUG_PRINTLN("GSM: GPRS detached");
+    gsm->linkLost = true;
+  }
+}
+
+void GSMModule::updateSignal(int quality) {
+  health.signalQuality = quality;
+  health.signalMillis = millis();
+}
+
+void GSMModule::updateAttach(bool attached) {
+  health.gprsAttached = attached;
+  health.gprsMillis = millis();
+}
+
+void GSMModule::setSocketOpen(bool open) {
+  health.socketOpen = open;
+  health.socketMillis = millis();
+}
+
+void GSMModule::updateRegistration(int status) {
+  bool wasRegistered = health.isRegistered();
+  health.registration = status;
+  health.registrationMillis = millis();
+  if (state == GSM_READY && wasRegistered && !health.isRegistered()) {
+    DEBUG_PRINT("GSM: network registration lost (+CREG ");
+    DEBUG_PRINT(status);
+    DEBUG_PRINTLN(")");
+    linkLost = true;
+  }
+}
+
+void GSMModule::onRegistrationUrc(void *context, const char *line) {
+  // "+CREG: <stat>" (AT+CREG=1)
+  ((GSMModule *)context)->updateRegistration(atoi(atFind(line, "+CREG:")));
+}
+
+void GSMModule::onSignalUrc(void *context, const char *line) {
+  // "+CSQN: <rssi>,<ber>" (AT+EXUNSOL="SQ",1)
+  ((GSMModule *)context)->updateSignal(atoi(atFind(line, "+CSQN:")));
+}
+
+void GSMModule::onBearerUrc(void *context, const char *line) {
+  (void)line;
 
-  isConnected = modem->isGprsConnected();
-  return isConnected;
+  GSMModule *gsm = (GSMModule *)context;
+  if (gsm->state == GSM_READY) {
+    DEBUG_PRINTLN("GSM: PDP context deactivated by the network");
+    gsm->linkLost = true;
+  }
+}
+
+void GSMModule::onSocketClosedUrc(void *context, const char *line) {
+  (void)line;
+
+  // "<n>, CLOSED"
+  GSMModule *gsm = (GSMModule *)context;
+  gsm->socketClosed = true;
+  gsm->setSocketOpen(false);
 }
 
-int GSMModule::getSignalQuality() {
-  if (!isInitialized)
-    return 0;
+void GSMModule::onDataUrc(void *context, const char *line) {
+  // "+CIPRXGET: 1,<mux>"; mode 2 lines are replies to TinyGSM's own reads
+  const char *mode = atFind(line, "+CIPRXGET:");
+  if (!mode || atoi(mode) != 1)
+    return;
 
-  return modem->getSignalQuality();
+  GSMModule *gsm = (GSMModule *)context;
+  gsm->dataPending = true;
+}
+
+void GSMModule::onModemRestartUrc(void *context, const char *line) {
+  (void)line;
+
+  // The modem rebooted on its own (brown-out): echo and URCs are back to
+  // defaults, so bring-up starts again
+  GSMModule *gsm = (GSMModule *)context;
+  if (gsm->state > GSM_PROBING) {
+    DEBUG_PRINTLN("GSM: modem restarted");
+    gsm->linkLost = true;
+  }
 }
 
 TinyGsmClient *GSMModule::getClient() { return client; }
 
+bool GSMModule::takeDataNotice() {
+  if (!dataPending)
+    return false;
+
+  dataPending = false;
+  if (client)
+    client->notifyData();
+  return true;
+}
+
 bool GSMModule::sendHTTPPost(const char *url, const char *data) {
   if (!isGPRSConnected()) {
     DEBUG_PRINTLN("No GPRS connection for HTTP!");
@@ -210,11 +777,8 @@ bool GSMModule::sendHTTPPost(const char *url, const char *data) {
   return true;
 }
 
-bool GSMModule::isModemReady() {
-  if (!isInitialized)
-    return false;
-
-  return modem->testAT();
+bool GSMModule::isModemReady() const {
+  return state > GSM_PROBING && state <= GSM_READY;
 }
 
 bool GSMModule::checkAntennaConnection() {
@@ -226,7 +790,7 @@ bool GSMModule::checkAntennaConnection() {
   DEBUG_PRINTLN("\n=== Antenna Connection Test ===");
 
   // Test 1: Get signal quality
-  int signal = modem->getSignalQuality();
+  int signal = getSignalQuality();
   DEBUG_PRINT("Signal Quality: ");
   DEBUG_PRINT(signal);
   DEBUG_PRINT("/31 ");
@@ -263,8 +827,6 @@ bool GSMModule::checkAntennaConnection() {
 void GSMModule::restart() {
   if (isInitialized) {
     DEBUG_PRINTLN("Restarting modem...");
-    modem->restart();
-    delay(5000);
-    isConnected = false;
+    hardwareReset();
   }
 }
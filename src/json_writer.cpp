@@ -0,0 +1,194 @@
+#include "json_writer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const uint64_t POW10[] = {1,         10,         100,       1000,
+                                 10000,     100000,     1000000,   10000000,
+                                 100000000, 1000000000};
+
+// Decimal digits of n into out; returns the count
+static size_t formatUnsigned(char *out, uint64_t n) {
+  char scratch[20];
+  size_t count = 0;
+  do {
+    scratch[count++] = (char)('0' + n % 10);
+    n /= 10;
+  } while (n);
+  for (size_t i = 0; i < count; i++) {
+    out[i] = scratch[count - 1 - i];
+  }
+  return count;
+}
+
+size_t formatFixed(char *out, size_t room, double v, uint8_t decimals) {
+  if (decimals > 9)
+    decimals = 9;
+  char text[40];
+  size_t n = 0;
+
+  double magnitude = fabs(v) * (double)POW10[decimals];
+  if (magnitude >= 9.0e18) {
+    // Beyond 64-bit fixed point; not a coordinate, speed or altitude
+    int written = snprintf(text, sizeof(text), "%.*f", decimals, v);
+    n = (written > 0 && (size_t)written < sizeof(text)) ? (size_t)written : 0;
+  } else {
+    uint64_t scaled = (uint64_t)llround(magnitude);
+    if (v < 0 && scaled != 0)
+      text[n++] = '-';
+    n += formatUnsigned(text + n, scaled / POW10[decimals]);
+    if (decimals > 0) {
+      text[n++] = '.';
+      uint64_t fraction = scaled % POW10[decimals];
+      for (int i = decimals - 1; i >= 0; i--) {
+        text[n + i] = (char)('0' + fraction % 10);
+        fraction /= 10;
+      }
+      n += decimals;
+    }
+  }
+
+  if (n == 0 || n > room)
+    return 0;
+  memcpy(out, text, n);
+  return n;
+}
+
+JsonWriter::JsonWriter(char *buffer, size_t capacity)
+    : buffer(buffer), capacity(capacity), length(0), needComma(false),
+      overflow(capacity == 0) {
+  if (capacity > 0)
+    buffer[0] = '\0';
+}
+
+void JsonWriter::put(char c) { put(&c, 1); }
+
+void JsonWriter::put(const char *text, size_t n) {
+  if (overflow)
+    return;
+  if (length + n >= capacity) {
+    overflow = true;
+    return;
+  }
+  memcpy(buffer + length, text, n);
+  length += n;
+  buffer[length] = '\0';
+}
+
+void JsonWriter::separator() {
+  if (needComma)
+    put(',');
+}
+
+void JsonWriter::quoted(const char *text) {
+  put('"');
+  for (const char *p = text; *p; p++) {
+    char c = *p;
+    if (c == '"' || c == '\\') {
+      char escaped[2] = {'\\', c};
+      put(escaped, 2);
+    } else if ((unsigned char)c < 0x20) {
+      char escaped[7];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+      put(escaped, 6);
+    } else {
+      put(c);
+    }
+  }
+  put('"');
+}
+
+void JsonWriter::beginObject() {
+  separator();
+  put('{');
+  needComma = false;
+}
+
+void JsonWriter::endObject() {
+  put('}');
+  needComma = true;
+}
+
+void JsonWriter::beginArray() {
+  separator();
+  put('[');
+  needComma = false;
+}
+
+void JsonWriter::endArray() {
+  put(']');
+  needComma = true;
+}
+
+void JsonWriter::key(const char *name) {
+  separator();
+  quoted(name);
+  put(':');
+  needComma = false;
+}
+
+void JsonWriter::value(const char *text) {
+  separator();
+  quoted(text);
+  needComma = true;
+}
+
+void JsonWriter::value(bool b) {
+  separator();
+  if (b)
+    put("true", 4);
+  else
+    put("false", 5);
+  needComma = true;
+}
+
+void JsonWriter::value(long n) {
+  separator();
+  char text[24];
+  size_t count = 0;
+  uint64_t magnitude = (uint64_t)n;
+  if (n < 0) {
+    text[count++] = '-';
+    magnitude = 0 - magnitude;
+  }
+  count += formatUnsigned(text + count, magnitude);
+  put(text, count);
+  needComma = true;
+}
+
+void JsonWriter::value(unsigned long n) {
+  separator();
+  char text[24];
+  put(text, formatUnsigned(text, n));
+  needComma = true;
+}
+
+void JsonWriter::value(double v, uint8_t decimals) {
+  if (!isfinite(v)) {
+    null(); // JSON has no NaN/Infinity
+    return;
+  }
+  separator();
+  char text[40];
+  size_t n = formatFixed(text, sizeof(text), v, decimals);
+  if (n == 0)
+    overflow = true;
+  put(text, n);
+  needComma = true;
+}
+
+void JsonWriter::null() {
+  separator();
+  put("null", 4);
+  needComma = true;
+}
+
+void JsonWriter::rewind(const Mark &m) {
+  if (m.length >= capacity)
+    return;
+  length = m.length;
+  needComma = m.needComma;
+  overflow = false;
+  buffer[length] = '\0';
+}
@@ -1,7 +1,18 @@
 #include "config.h"
+#include "fix_batcher.h"
+#include "fix_journal.h"
+#include "fix_snapshot.h"
 #include "gps.h"
+#include "gps_task.h"
 #include "gsm.h"
+#include "json_writer.h"
+#include "metrics.h"
 #include "mqtt_client.h"
+#include "payload_codec.h"
+#include "publish_scheduler.h"
+#include "receiver_config.h"
+#include "sleep_manager.h"
+#include "track_simplifier.h"
 #include <Arduino.h>
 
 // ============================================
@@ -12,6 +23,34 @@ GPSModule gps;
 GSMModule gsm;
 MQTTClientModule *mqttClient = nullptr;
 
+// Latest fix, written by the GPS ingest task and read by loop()
+FixSnapshot fixSnapshot;
+
+// Fixes held in flash while the broker is unreachable
+FixJournal journal;
+
+// Fixes waiting to go out together in one location message
+FixBatcher batcher;
+
+#if MQTT_PUBLISH_COMPRESSED
+// Working memory for compressing location batches (4866 bytes by default)
+PayloadCompressor compressor;
+#endif
+
+// Picks which fixes are reported (PUBLISH_POLICY)
+PublishScheduler scheduler;
+
+// Sleeps between parked position checks (SLEEP_ENABLED)
+SleepManager sleeper;
+
+#if TRACK_SIMPLIFY_ENABLED
+static_assert(PUBLISH_POLICY == PUBLISH_POLICY_ADAPTIVE,
+              "Track simplification needs the ADAPTIVE publish policy");
+
+// Drops fixes that lie on the line between reported ones
+TrackSimplifier simplifier;
+#endif
+
 // Separate UARTs for GPS and GSM (Dual UART Architecture)
 HardwareSerial gpsSerial(GPS_UART_NUM); // UART0 for GPS
 HardwareSerial gsmSerial(GSM_UART_NUM); // UART1 for GSM
@@ -23,16 +62,46 @@ HardwareSerial gsmSerial(GSM_UART_NUM); // UART1 for GSM
 bool gpsInitialized = false;
 bool gsmInitialized = false;
 bool mqttInitialized = false;
+bool gpsTaskRunning = false;
+bool journalInitialized = false;
 
 unsigned long lastGPSRead = 0;
 unsigned long lastMQTTPublish = 0;
+unsigned long lastMQTTLoop = 0;
 unsigned long lastConnectivityCheck = 0;
+unsigned long lastJournalDrain = 0;
+
+// Journal replays in the MQTT queue, and the sequence number to send next.
+// A record is marked sent only once the broker has acknowledged it.
+uint32_t replaysQueued = 0;
+uint32_t nextReplaySequence = 0;
+unsigned long lastMetricsPublish = 0;
+
+// Boot to the first location sent (millis()), 0 until then
+unsigned long bootPublishMs = 0;
+
+// Receiver settings in effect, and a change waiting for the GPS task
+ReceiverConfig receiverConfig = ReceiverConfig::defaults();
+ReceiverConfig pendingReceiverConfig;
 
 // ============================================
 // FUNCTION DECLARATIONS
 // ============================================
 
 void initializeModules();
+void journalFix(const GpsFix &fix);
+void reportFix(const GpsFix &fix, unsigned long timestamp);
+void flushBatch(unsigned long now, bool force);
+void drainJournal();
+void onLocationDelivered(void *context, uint32_t tag);
+void handleCommand(void *context, const char *payload, size_t length);
+void reportReceiverConfig(bool applied);
+void manageSleep(unsigned long now);
+void saveRetainedState(unsigned long now);
+void restoreRetainedState();
+void sendStartHint();
+void reportBootMetrics();
+void publishMetrics(unsigned long now);
 
 // ============================================
 // SETUP FUNCTION
@@ -41,15 +110,24 @@ void initializeModules();
 void setup() {
   // Initialize debug serial
   DEBUG_SERIAL.begin(DEBUG_BAUD);
-  delay(2000);
 
   DEBUG_PRINTLN("\n\n========================================");
   DEBUG_PRINTLN("ESP32-S3 GPS Tracker");
   DEBUG_PRINTLN("Dual UART: GPS on UART0, GSM on UART1");
   DEBUG_PRINTLN("========================================\n");
 
+  // Reset reason, and parked state, journal position and MQTT session
+  // from a deep sleep
+  sleeper.begin();
+  DEBUG_PRINT("Boot: ");
+  DEBUG_PRINT(sleeper.getResetReasonName());
+  DEBUG_PRINTLN(sleeper.isWarmBoot() ? " (warm)" : " (cold)");
+
   // Initialize all modules
   initializeModules();
+  if (sleeper.isResumed()) {
+    restoreRetainedState();
+  }
 
   DEBUG_PRINTLN("\n========================================");
   DEBUG_PRINTLN("System Ready!");
@@ -63,115 +141,185 @@ void setup() {
 void loop() {
   unsigned long currentTime = millis();
 
-  // Read GPS data every 100ms
-  if (currentTime - lastGPSRead >= GPS_TASK_DELAY_MS) {
-    lastGPSRead = currentTime;
-
-    if (gpsInitialized) {
-      // Check if data is available on GPS serial port
-      static unsigned long lastSerialCheck = 0;
-      if (currentTime - lastSerialCheck >= 10000) { // Every 10 seconds
-        lastSerialCheck = currentTime;
-        DEBUG_PRINT("GPS Serial available bytes: ");
-        DEBUG_PRINTLN(gpsSerial.available());
-        if (gpsSerial.available() == 0) {
-          DEBUG_PRINTLN("WARNING: No data from GPS module!");
-          DEBUG_PRINTLN("Check: 1) GPS TX connected to ESP32 RX pin 44");
-          DEBUG_PRINTLN("       2) GPS power (3.3V or 5V depending on module)");
-          DEBUG_PRINTLN("       3) GPS antenna connected");
-          DEBUG_PRINTLN("       4) GPS has clear view of sky");
-        }
+  // Advance GSM bring-up by at most one AT exchange
+  if (gsmInitialized) {
+    static GsmState lastGsmState = GSM_OFF;
+    GsmState gsmState = gsm.poll();
+    if (gsmState != lastGsmState) {
+      lastGsmState = gsmState;
+      // Connect right away instead of at the next connectivity check
+      if (gsmState == GSM_READY && mqttInitialized && mqttClient) {
+        mqttClient->connect();
       }
+    }
+  }
+
+  // Outcome of a receiver change requested over MQTT
+  bool receiverApplied;
+  if (gps.takeConfigResult(receiverApplied)) {
+    if (receiverApplied) {
+      receiverConfig = pendingReceiverConfig;
+    }
+    reportReceiverConfig(receiverApplied);
+  }
+
+  // Read GPS data every 100ms (the GPS task does this when it is running)
+  if (currentTime - lastGPSRead >= gps.getPollInterval()) {
+    lastGPSRead = currentTime;
 
+    if (gpsInitialized && !gpsTaskRunning) {
       gps.update();
+      fixSnapshot.publish(gps.getFix());
+    }
+  }
 
-      if (gps.hasValidLocation()) {
-        DEBUG_PRINT("GPS - Lat: ");
-        DEBUG_PRINT(gps.getLatitude(), 6);
-        DEBUG_PRINT(", Lon: ");
-        DEBUG_PRINT(gps.getLongitude(), 6);
-        DEBUG_PRINT(", Sats: ");
-        DEBUG_PRINTLN(gps.getSatellites());
+  GpsFix fix;
+  fixSnapshot.read(fix);
+  bool hasFix = gpsInitialized && fix.hasLocation(millis());
+  // In backup or hot starting: no data and no fix are expected
+  bool gpsAwake = gps.getPowerState() == GPS_POWER_TRACKING;
+
+  if (gpsInitialized) {
+    // Check that the GPS parser is still receiving data
+    static unsigned long lastSerialCheck = 0;
+    static unsigned long lastCharsProcessed = 0;
+    if (currentTime - lastSerialCheck >= 10000) { // Every 10 seconds
+      lastSerialCheck = currentTime;
+      DEBUG_PRINT("GPS bytes received: ");
+      DEBUG_PRINTLN(fix.charsProcessed - lastCharsProcessed);
+      if (fix.charsProcessed == lastCharsProcessed && gpsAwake) {
+        DEBUG_PRINTLN("WARNING: No data from GPS module!");
+        DEBUG_PRINTLN("Check: 1) GPS TX connected to ESP32 RX pin 44");
+        DEBUG_PRINTLN("       2) GPS power (3.3V or 5V depending on module)");
+        DEBUG_PRINTLN("       3) GPS antenna connected");
+        DEBUG_PRINTLN("       4) GPS has clear view of sky");
       }
+      lastCharsProcessed = fix.charsProcessed;
+    }
+
+    static unsigned long lastFixLog = 0;
+    if (hasFix && currentTime - lastFixLog >= GPS_TASK_DELAY_MS) {
+      lastFixLog = currentTime;
+      DEBUG_PRINT("GPS - Lat: ");
+      DEBUG_PRINT(fix.latitude, 6);
+      DEBUG_PRINT(", Lon: ");
+      DEBUG_PRINT(fix.longitude, 6);
+      DEBUG_PRINT(", Sats: ");
+      DEBUG_PRINTLN(fix.satellites);
     }
   }
 
-  // Handle MQTT and publish every 5 seconds
-  if (currentTime - lastMQTTPublish >= GPS_UPDATE_INTERVAL) {
-    lastMQTTPublish = currentTime;
+  // Decide which fresh fixes go into the next location message
+  static unsigned long lastFixMillis = 0;
+  if (hasFix && fix.locationMillis != lastFixMillis) {
+    lastFixMillis = fix.locationMillis;
+    sleeper.recordFix(fix, scheduler.isParked());
+
+#if TRACK_SIMPLIFY_ENABLED
+    // Parked fixes are wander, not track; the scheduler handles those
+    if (scheduler.isMoving()) {
+      GpsFix keyFix;
+      unsigned long keyTime;
+      if (simplifier.add(fix, currentTime, keyFix, keyTime)) {
+        DEBUG_PRINTLN("Reporting fix (shape)");
+        scheduler.markReported(keyFix, keyTime);
+        reportFix(keyFix, keyTime);
+      }
+    }
+#endif
+
+    PublishReason reason = scheduler.update(fix, currentTime);
+    if (reason != PUBLISH_NONE) {
+      DEBUG_PRINT("Reporting fix (");
+      DEBUG_PRINT(publishReasonName(reason));
+      DEBUG_PRINTLN(")");
+      reportFix(fix, currentTime);
+#if TRACK_SIMPLIFY_ENABLED
+      simplifier.reset(fix);
+#endif
+    }
 
-    // Handle MQTT loop
+    // Parked: the receiver may sleep until the next position check or
+    // heartbeat, whichever comes first
+    unsigned long deadline = scheduler.nextFixDeadline();
+    unsigned long checkInterval = sleeper.getParkedCheckInterval(currentTime);
+    if (deadline != 0 && (long)(deadline - currentTime) > (long)checkInterval) {
+      deadline = currentTime + checkInterval;
+    }
+    gps.requestFixBy(deadline);
+  }
+
+  // Handle MQTT traffic (PUBACKs keep the QoS 1 window moving); a data
+  // notice from the modem is read on this pass rather than the next tick
+  if (currentTime - lastMQTTLoop >= MQTT_LOOP_INTERVAL_MS ||
+      gsm.hasDataPending()) {
+    lastMQTTLoop = currentTime;
     if (mqttInitialized && mqttClient) {
+      StageTimer timer(METRIC_MQTT_LOOP);
       mqttClient->loop();
     }
+  }
 
-    // Publish GPS data if available
-    if (gpsInitialized && gps.hasValidLocation()) {
-      if (mqttInitialized && mqttClient && mqttClient->isConnectedToBroker()) {
-        // Create JSON
-        char locationJSON[MQTT_BUFFER_SIZE];
-        snprintf(locationJSON, sizeof(locationJSON),
-                 "{"
-                 "\"latitude\":%.6f,"
-                 "\"longitude\":%.6f,"
-                 "\"altitude\":%.2f,"
-                 "\"speed\":%.2f,"
-                 "\"satellites\":%d,"
-                 "\"valid\":true,"
-                 "\"timestamp\":%lu"
-                 "}",
-                 gps.getLatitude(), gps.getLongitude(), gps.getAltitude(),
-                 gps.getSpeed(), gps.getSatellites(), currentTime);
-
-        if (mqttClient->publishLocation(String(locationJSON))) {
-          DEBUG_PRINTLN("✓ Location published");
-        } else {
-          DEBUG_PRINTLN("✗ Failed to publish");
-        }
-      } else {
-        DEBUG_PRINTLN("MQTT not connected");
-      }
-    } else {
+  // Report missing fixes every 5 seconds
+  if (currentTime - lastMQTTPublish >= GPS_UPDATE_INTERVAL) {
+    lastMQTTPublish = currentTime;
+
+    if (!hasFix && gpsAwake) {
       // GPS fix not available - publish status
       static unsigned long lastGPSStatusLog = 0;
       if (currentTime - lastGPSStatusLog >= 5000) {
         lastGPSStatusLog = currentTime;
         DEBUG_PRINT("Waiting for GPS fix... Satellites: ");
-        DEBUG_PRINT(gps.getSatellites());
+        DEBUG_PRINT(fix.satellites);
         DEBUG_PRINT(", Chars processed: ");
-        DEBUG_PRINTLN(gps.getCharsProcessed());
+        DEBUG_PRINTLN(fix.charsProcessed);
 
         // Publish GPS status to MQTT
         if (mqttInitialized && mqttClient &&
             mqttClient->isConnectedToBroker()) {
           char statusJSON[256];
-          snprintf(statusJSON, sizeof(statusJSON),
-                   "{"
-                   "\"status\":\"waiting_for_fix\","
-                   "\"satellites\":%d,"
-                   "\"chars_processed\":%lu,"
-                   "\"valid\":false,"
-                   "\"timestamp\":%lu"
-                   "}",
-                   gps.getSatellites(), gps.getCharsProcessed(), currentTime);
-          mqttClient->publishLocation(String(statusJSON));
+          JsonWriter json(statusJSON, sizeof(statusJSON));
+          json.beginObject();
+          json.field("status", "waiting_for_fix");
+          json.field("satellites", fix.satellites);
+          json.field("chars_processed", fix.charsProcessed);
+          json.field("valid", false);
+          json.field("timestamp", currentTime);
+          json.endObject();
+          mqttClient->publishStatus(json.c_str(), json.size(),
+                                    MQTT_STATUS_GPS_FIX);
         }
       }
     }
   }
 
+  // Send the pending batch once it is full or old enough
+  flushBatch(currentTime, false);
+
+  // Replay journaled fixes at a bounded rate once the broker is back
+  if (currentTime - lastJournalDrain >= JOURNAL_DRAIN_INTERVAL_MS) {
+    lastJournalDrain = currentTime;
+    drainJournal();
+  }
+
+#if METRICS_ENABLED
+  // Stage latencies of the last window and error counters
+  if (currentTime - lastMetricsPublish >= METRICS_PUBLISH_INTERVAL_MS &&
+      mqttInitialized && mqttClient && mqttClient->isConnectedToBroker()) {
+    publishMetrics(currentTime);
+  }
+#endif
+
   // Check connectivity every 10 seconds
   if (currentTime - lastConnectivityCheck >= CONNECTIVITY_CHECK_MS) {
     lastConnectivityCheck = currentTime;
 
-    // Check GPRS connection
-    if (gsmInitialized && !gsm.isGPRSConnected()) {
-      DEBUG_PRINTLN("GPRS disconnected, reconnecting...");
-      gsm.connectGPRS();
-    }
+    // GPRS needs no check here: URCs and status queries report a lost
+    // link to GSMModule::poll(), which brings it up again
 
     // Check MQTT connection
-    if (mqttInitialized && mqttClient && !mqttClient->isConnectedToBroker()) {
+    if (gsm.isReady() && mqttInitialized && mqttClient &&
+        !mqttClient->isConnectedToBroker()) {
       DEBUG_PRINTLN("MQTT disconnected, reconnecting...");
       mqttClient->reconnect();
     }
@@ -182,37 +330,96 @@ void loop() {
     DEBUG_PRINT(gpsInitialized ? "OK" : "FAIL");
     if (gpsInitialized) {
       DEBUG_PRINT(" | Fix: ");
-      DEBUG_PRINT(gps.hasValidLocation() ? "Valid" : "No fix");
+      DEBUG_PRINT(hasFix ? "Valid" : "No fix");
       DEBUG_PRINT(" | Satellites: ");
-      DEBUG_PRINTLN(gps.getSatellites());
+      DEBUG_PRINT(fix.satellites);
+      DEBUG_PRINT(" | Power: ");
+      DEBUG_PRINT(gpsPowerStateName(gps.getPowerState()));
+      if (gps.getWakeToFixMs() > 0) {
+        DEBUG_PRINT(" (last hot start ");
+        DEBUG_PRINT(gps.getWakeToFixMs());
+        DEBUG_PRINT(" ms)");
+      }
+      DEBUG_PRINTLN();
+      DEBUG_PRINT("  GPS task: ");
+      DEBUG_PRINTLN(gpsTaskRunning ? "Running" : "Inline in loop()");
     } else {
       DEBUG_PRINTLN();
     }
 
     DEBUG_PRINT("  GSM: ");
-    DEBUG_PRINT(gsmInitialized ? "OK" : "FAIL");
+    DEBUG_PRINT(gsmInitialized ? gsmStateName(gsm.getState()) : "FAIL");
+    if (gsm.getState() == GSM_FAILED) {
+      DEBUG_PRINT(" (");
+      DEBUG_PRINT(gsmErrorName(gsm.getLastError()));
+      DEBUG_PRINT(")");
+    }
     if (gsmInitialized) {
+      // Snapshot kept by URCs and status queries: no modem round trips
+      const ModemHealth &health = gsm.getHealth();
       DEBUG_PRINT(" | Signal: ");
-      DEBUG_PRINT(gsm.getSignalQuality());
+      DEBUG_PRINT(health.signalQuality);
+      if (health.signalMillis) {
+        DEBUG_PRINT(" (");
+        DEBUG_PRINT(health.rssiDbm());
+        DEBUG_PRINT(" dBm, ");
+        DEBUG_PRINT(ModemHealth::age(health.signalMillis, currentTime) / 1000);
+        DEBUG_PRINT(" s ago)");
+      }
+      DEBUG_PRINT(" | Network: ");
+      DEBUG_PRINT(health.registration == 5   ? "Roaming"
+                  : health.isRegistered()    ? "Home"
+                  : health.registration == 3 ? "Denied"
+                                             : "Searching");
       DEBUG_PRINT(" | GPRS: ");
-      DEBUG_PRINTLN(gsm.isGPRSConnected() ? "Connected" : "Disconnected");
+      DEBUG_PRINT(health.gprsAttached ? "Connected" : "Disconnected");
+      DEBUG_PRINT(" | Socket: ");
+      DEBUG_PRINTLN(health.socketOpen ? "Open" : "Closed");
     } else {
       DEBUG_PRINTLN();
     }
 
     DEBUG_PRINT("  MQTT: ");
     if (mqttInitialized && mqttClient) {
-      DEBUG_PRINTLN(mqttClient->isConnectedToBroker() ? "Connected"
-                                                      : "Disconnected");
+      DEBUG_PRINT(mqttClient->isConnectedToBroker() ? "Connected"
+                                                    : "Disconnected");
+      DEBUG_PRINT(" | Unacknowledged: ");
+      DEBUG_PRINTLN((unsigned long)mqttClient->getPendingCount());
     } else {
       DEBUG_PRINTLN("Not initialized");
     }
 
+    DEBUG_PRINT("  Journal: ");
+    if (journalInitialized) {
+      DEBUG_PRINT(journal.getPending());
+      DEBUG_PRINT(" pending, ");
+      DEBUG_PRINT(journal.getOverwritten());
+      DEBUG_PRINTLN(" lost to wrap-around");
+    } else {
+      DEBUG_PRINTLN("Not available");
+    }
+
+#if SLEEP_ENABLED
+    DEBUG_PRINT("  Sleep: ");
+    DEBUG_PRINT(sleeper.getLightSleeps());
+    DEBUG_PRINT(" light (");
+    DEBUG_PRINT(sleeper.getLightSleepMs() / 1000);
+    DEBUG_PRINT(" s), ");
+    DEBUG_PRINT(sleeper.getDeepSleeps());
+    DEBUG_PRINT(" deep | Modem: ");
+    DEBUG_PRINTLN(gsm.isAsleep() ? "Asleep" : "Awake");
+#endif
+
     DEBUG_PRINT("  Free Heap: ");
     DEBUG_PRINT(ESP.getFreeHeap());
     DEBUG_PRINTLN(" bytes\n");
   }
 
+#if SLEEP_ENABLED
+  // Parked with nothing to send: sleep until the receiver's hot start
+  manageSleep(currentTime);
+#endif
+
   // Small delay to prevent tight looping
   delay(10);
 }
@@ -226,7 +433,14 @@ void initializeModules() {
 
   // Initialize UART0 for GPS (NEO-6M)
   DEBUG_PRINTLN("1. Initializing UART0 for GPS...");
+  gpsSerial.setRxBufferSize(GPS_UART_RX_BUFFER_SIZE); // Must precede begin()
   gpsSerial.begin(GPS_BAUD, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
+#if METRICS_ENABLED
+  gpsSerial.onReceiveError([](hardwareSerial_error_t error) {
+    if (error == UART_BUFFER_FULL_ERROR || error == UART_FIFO_OVF_ERROR)
+      metricCount(METRIC_GPS_UART_OVERRUN);
+  });
+#endif
   delay(100);
   DEBUG_PRINTLN("   ✓ UART0 initialized");
 
@@ -235,6 +449,37 @@ void initializeModules() {
   gpsInitialized = gps.begin(&gpsSerial);
   if (gpsInitialized) {
     DEBUG_PRINTLN("   ✓ GPS initialized successfully");
+
+    // More bandwidth for fix rates above 1 Hz
+    unsigned long gpsBaud = gps.negotiateBaud(GPS_BAUD_FAST);
+    DEBUG_PRINT("   GPS UART at ");
+    DEBUG_PRINT(gpsBaud);
+    DEBUG_PRINTLN(" baud");
+
+#if GPS_UBX_MODE
+    // Binary NAV messages: about half the bytes of the NMEA set per fix
+    DEBUG_PRINTLN(gps.configureUbx() ? "   GPS output: UBX NAV"
+                                     : "   GPS output: NMEA");
+#endif
+
+    // Fix rate, dynamic model and message set (changed later over MQTT)
+    bool configured = gps.applyConfig(receiverConfig);
+    DEBUG_PRINT("   GPS receiver: ");
+    DEBUG_PRINT(receiverConfig.measurementRateMs);
+    DEBUG_PRINT(" ms, ");
+    DEBUG_PRINT(receiverModelName(receiverConfig.dynamicModel));
+    DEBUG_PRINTLN(configured ? "" : " (not acknowledged)");
+
+#if GPS_START_HINT
+    sendStartHint();
+#endif
+
+#if GPS_TASK_ENABLED
+    // Start ingest before the GSM set-up below
+    gpsTaskRunning = startGPSTask(&gps, &fixSnapshot);
+    DEBUG_PRINTLN(gpsTaskRunning ? "   ✓ GPS task started"
+                                 : "   GPS ingest runs inline in loop()");
+#endif
   } else {
     DEBUG_PRINTLN("   ✗ GPS initialization failed");
   }
@@ -246,61 +491,451 @@ void initializeModules() {
   DEBUG_PRINT("   RX1 Pin: ");
   DEBUG_PRINTLN(GSM_RX_PIN);
   DEBUG_PRINT("   Baud: ");
-  DEBUG_PRINTLN(GSM_BAUD);
+  DEBUG_PRINT(GSM_BAUD);
+  DEBUG_PRINTLN(GSM_BAUD_FAST != GSM_BAUD ? " (raised during bring-up)" : "");
   gsmSerial.begin(GSM_BAUD, SERIAL_8N1, GSM_RX_PIN, GSM_TX_PIN);
+#if METRICS_ENABLED
+  gsmSerial.onReceiveError([](hardwareSerial_error_t error) {
+    if (error == UART_BUFFER_FULL_ERROR || error == UART_FIFO_OVF_ERROR)
+      metricCount(METRIC_GSM_UART_OVERRUN);
+  });
+#endif
   delay(100);
   DEBUG_PRINTLN("   ✓ UART1 initialized");
 
-  // Initialize GSM module
+  // Start GSM bring-up; poll() in loop() takes it to GPRS
   DEBUG_PRINTLN("\n4. Initializing GSM module...");
-  DEBUG_PRINTLN("   This may take up to 15 seconds...");
-  gsmInitialized = gsm.begin(&gsmSerial);
+  // After a reset of the ESP32 alone the modem may still be online
+  gsmInitialized = gsm.begin(&gsmSerial, sleeper.isWarmBoot());
   if (gsmInitialized) {
-    DEBUG_PRINTLN("   ✓ GSM initialized successfully");
-
-    // Test antenna connection
-    gsm.checkAntennaConnection();
+    DEBUG_PRINTLN("   ✓ GSM bring-up started (continues in loop())");
   } else {
     DEBUG_PRINTLN("   ✗ GSM initialization failed");
-    DEBUG_PRINTLN("");
-    DEBUG_PRINTLN("   TROUBLESHOOTING TIPS:");
-    DEBUG_PRINTLN("   1. Check SIM800L power: 3.7-4.2V with 2A capability");
-    DEBUG_PRINTLN("   2. Verify antenna is connected");
-    DEBUG_PRINTLN("   3. Check UART connections (TX1<->RX, RX1<->TX)");
-    DEBUG_PRINTLN("   4. Ensure reset pin (GPIO 5) is connected");
-    DEBUG_PRINTLN("   5. Try external power supply (not USB power)");
   }
 
-  // Connect to GPRS
+  // MQTT connects once GPRS is up
   if (gsmInitialized) {
-    DEBUG_PRINTLN("\n5. Connecting to GPRS...");
-    if (gsm.connectGPRS()) {
-      DEBUG_PRINTLN("   ✓ GPRS connected successfully");
-
-      // Initialize MQTT
-      DEBUG_PRINTLN("\n6. Initializing MQTT client...");
-      mqttClient = new MQTTClientModule(&gsm);
-      mqttInitialized = mqttClient->begin();
-
-      if (mqttInitialized) {
-        DEBUG_PRINTLN("   ✓ MQTT initialized successfully");
-
-        // Connect to MQTT broker
-        DEBUG_PRINTLN("\n7. Connecting to MQTT broker...");
-        if (mqttClient->connect()) {
-          DEBUG_PRINTLN("   ✓ MQTT connected successfully");
-        } else {
-          DEBUG_PRINTLN("   ✗ MQTT connection failed");
-        }
-      } else {
-        DEBUG_PRINTLN("   ✗ MQTT initialization failed");
-      }
+    DEBUG_PRINTLN("\n5. Initializing MQTT client...");
+    mqttClient = new MQTTClientModule(&gsm);
+    mqttInitialized = mqttClient->begin();
+
+    if (mqttInitialized) {
+      mqttClient->onCommand(handleCommand, nullptr);
+      mqttClient->onDelivered(onLocationDelivered, nullptr);
+      DEBUG_PRINTLN("   ✓ MQTT initialized successfully");
     } else {
-      DEBUG_PRINTLN("   ✗ GPRS connection failed");
+      DEBUG_PRINTLN("   ✗ MQTT initialization failed");
     }
   }
 
+#if JOURNAL_ENABLED
+  DEBUG_PRINTLN("\n6. Opening fix journal...");
+  const RetainedState &retained = sleeper.retained();
+  journalInitialized = sleeper.isResumed() && retained.journalValid
+                           ? journal.begin(retained.journal)
+                           : journal.begin();
+  if (journalInitialized) {
+    DEBUG_PRINTLN("   ✓ Journal ready");
+  } else {
+    DEBUG_PRINTLN("   ✗ Journal unavailable (check partition table)");
+  }
+#endif
+
   DEBUG_PRINTLN("\n========================================");
   DEBUG_PRINTLN("Module initialization complete!");
   DEBUG_PRINTLN("========================================\n");
 }
+
+void journalFix(const GpsFix &fix) {
+  if (!journalInitialized)
+    return;
+
+  if (journal.append(fix)) {
+    DEBUG_PRINT("Fix journaled (");
+    DEBUG_PRINT(journal.getPending());
+    DEBUG_PRINTLN(" pending)");
+  }
+}
+
+void reportFix(const GpsFix &fix, unsigned long timestamp) {
+  if (mqttInitialized && mqttClient && mqttClient->isConnectedToBroker()) {
+    if (!batcher.add(fix, timestamp)) {
+      flushBatch(timestamp, true);
+      batcher.add(fix, timestamp);
+    }
+  } else {
+    DEBUG_PRINTLN("MQTT not connected");
+    journalFix(fix);
+  }
+}
+
+static_assert(MQTT_PUBLISH_JSON || MQTT_PUBLISH_BINARY ||
+                  MQTT_PUBLISH_COMPRESSED,
+              "Enable at least one location encoding");
+
+// Topics each batch is published on; it goes out on all of them or none
+#define LOCATION_ENCODINGS                                                     \
+  ((MQTT_PUBLISH_JSON ? 1 : 0) + (MQTT_PUBLISH_BINARY ? 1 : 0) +               \
+   (MQTT_PUBLISH_COMPRESSED ? 1 : 0))
+
+#if MQTT_PUBLISH_COMPRESSED
+// Leaves room for the marker byte should the JSON go out stored
+#define JSON_PAYLOAD_CAPACITY                                                 \
+  (MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS_Z) - PAYLOAD_CODEC_HEADER + 1)
+#else
+#define JSON_PAYLOAD_CAPACITY (MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS) + 1)
+#endif
+
+void flushBatch(unsigned long now, bool force) {
+  if (batcher.size() == 0 || (!force && !batcher.isDue(now)))
+    return;
+
+  bool connected =
+      mqttInitialized && mqttClient && mqttClient->isConnectedToBroker();
+
+  while (connected && batcher.size() > 0) {
+    size_t included = batcher.size();
+    bool published = true;
+
+    // Queued on one topic but not another would send the batch twice once
+    // it is replayed from the journal
+    if (mqttClient->getLocationRoom() < LOCATION_ENCODINGS) {
+      DEBUG_PRINTLN("✗ MQTT queue full");
+      break;
+    }
+
+#if MQTT_PUBLISH_JSON || MQTT_PUBLISH_COMPRESSED
+    char payload[JSON_PAYLOAD_CAPACITY];
+    size_t length;
+    {
+      StageTimer timer(METRIC_JSON_BUILD);
+      length = batcher.buildPayload(payload, sizeof(payload), included);
+    }
+    if (length == 0)
+      break;
+#endif
+
+#if MQTT_PUBLISH_COMPRESSED
+    // The same JSON, compressed
+    uint8_t compressed[MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS_Z)];
+    size_t compressedLength = compressor.compress(
+        (const uint8_t *)payload, length, compressed, sizeof(compressed));
+    if (compressedLength == 0)
+      break;
+#endif
+
+#if MQTT_PUBLISH_BINARY
+    // Same fixes as the JSON message so the topics stay in step
+    uint8_t binary[MQTT_MAX_PAYLOAD(MQTT_TOPIC_GPS_BIN)];
+    size_t encoded = 0;
+    size_t binaryLength = batcher.buildBinaryPayload(binary, sizeof(binary),
+                                                     included, encoded);
+    if (binaryLength == 0)
+      break;
+#if !MQTT_PUBLISH_JSON && !MQTT_PUBLISH_COMPRESSED
+    included = encoded;
+#endif
+#endif
+
+    // Every payload is built and the queue has room for all of them
+#if MQTT_PUBLISH_JSON
+    published = published && mqttClient->publishLocation(payload, length);
+#endif
+#if MQTT_PUBLISH_COMPRESSED
+    published = published && mqttClient->publishLocationCompressed(
+                                 compressed, compressedLength);
+#endif
+#if MQTT_PUBLISH_BINARY
+    published = published &&
+                mqttClient->publishLocationBinary(binary, binaryLength);
+#endif
+
+    if (!published) {
+      DEBUG_PRINTLN("✗ Failed to publish");
+      break;
+    }
+
+    DEBUG_PRINT("✓ Location published (");
+    DEBUG_PRINT((unsigned long)included);
+    DEBUG_PRINTLN(included == 1 ? " fix)" : " fixes)");
+#if METRICS_ENABLED
+    unsigned long publishedAt = millis();
+    for (size_t i = 0; i < included; i++) {
+      unsigned long age = publishedAt - batcher.at(i).fix.locationMillis;
+      metricRecord(METRIC_FIX_TO_PUBLISH,
+                   age < UINT32_MAX / 1000 ? age * 1000 : UINT32_MAX);
+    }
+#endif
+    batcher.consume(included);
+
+    if (bootPublishMs == 0) {
+      bootPublishMs = millis();
+      reportBootMetrics();
+    }
+  }
+
+  // Whatever could not be sent is kept in flash
+  for (size_t i = 0; i < batcher.size(); i++) {
+    journalFix(batcher.at(i).fix);
+  }
+  batcher.consume(batcher.size());
+}
+
+void drainJournal() {
+  if (!journalInitialized || journal.getPending() == 0)
+    return;
+  if (!mqttInitialized || !mqttClient || !mqttClient->isConnectedToBroker())
+    return;
+
+  // Nothing of the journal in the queue (or what is there was overwritten):
+  // start again from the oldest record. Records passed over by a PUBACK out
+  // of order go out again this way.
+  JournalRecord record;
+  if (!journal.peek(record))
+    return;
+  if (replaysQueued == 0 || nextReplaySequence < record.sequence)
+    nextReplaySequence = record.sequence;
+
+  while (replaysQueued < JOURNAL_DRAIN_BATCH) {
+    if (!journal.peek(nextReplaySequence, record))
+      break;
+
+    char replayJSON[MQTT_BUFFER_SIZE];
+    JsonWriter json(replayJSON, sizeof(replayJSON));
+    json.beginObject();
+    json.field("latitude", record.latitudeE7 / 1e7, 7);
+    json.field("longitude", record.longitudeE7 / 1e7, 7);
+    json.field("altitude", record.altitudeDm / 10.0, 1);
+    json.field("speed", record.speedCkmh / 100.0, 2);
+    json.field("satellites", (unsigned int)record.satellites);
+    json.field("valid", true);
+    json.field("utc", (unsigned long)record.utcSeconds);
+    json.field("seq", (unsigned long)record.sequence);
+    json.field("replay", true);
+    json.endObject();
+
+    // Marked sent from onLocationDelivered(), which may run before this
+    // returns; until then the record stays in flash, so a reset before the
+    // PUBACK does not lose it
+    replaysQueued++;
+    if (!mqttClient->publishLocation(json.c_str(), json.size(),
+                                     record.sequence)) {
+      replaysQueued--;
+      break; // Keep the record; retry on the next drain tick
+    }
+    nextReplaySequence++;
+  }
+}
+
+void onLocationDelivered(void *context, uint32_t tag) {
+  (void)context;
+
+  // Tags are journal sequence numbers. PUBACKs come in the order the
+  // records were sent; one that does not match the oldest record is left
+  // for the next pass of drainJournal().
+  if (replaysQueued > 0)
+    replaysQueued--;
+  JournalRecord record;
+  if (!journal.peek(record) || record.sequence != tag)
+    return;
+  journal.markSent(record);
+
+  if (journal.getPending() == 0) {
+    DEBUG_PRINTLN("✓ Journal drained");
+  }
+}
+
+void handleCommand(void *context, const char *payload, size_t length) {
+  (void)context;
+
+  ReceiverConfig requested = receiverConfig;
+  if (!gpsInitialized || !parseReceiverCommand(payload, length, requested)) {
+    DEBUG_PRINTLN("Command ignored");
+    return;
+  }
+  // Sent to the receiver by the GPS task; the result is reported in loop()
+  if (!gps.requestConfig(requested)) {
+    DEBUG_PRINTLN("Receiver change already pending, command ignored");
+    return;
+  }
+  pendingReceiverConfig = requested;
+}
+
+void reportReceiverConfig(bool applied) {
+  DEBUG_PRINTLN(applied ? "✓ Receiver settings applied"
+                        : "✗ Receiver rejected the new settings");
+  if (!mqttInitialized || !mqttClient)
+    return;
+
+  char statusJSON[160];
+  JsonWriter json(statusJSON, sizeof(statusJSON));
+  json.beginObject();
+  json.field("command", "gps_config");
+  json.field("applied", applied);
+  json.field("gps_rate_ms", (unsigned int)receiverConfig.measurementRateMs);
+  json.field("gps_model", receiverModelName(receiverConfig.dynamicModel));
+  json.field("gps_messages",
+             receiverConfig.minimalMessages ? "minimal" : "full");
+  json.endObject();
+  if (json.ok()) {
+    mqttClient->publishStatus(json.c_str(), json.size(),
+                              MQTT_STATUS_GPS_CONFIG);
+  }
+}
+
+void manageSleep(unsigned long now) {
+  bool parked = scheduler.isParked();
+  sleeper.update(parked, now);
+
+  // The receiver's backup sets the wake-up; nothing may be left to send
+  // while the broker is reachable
+  bool connected =
+      mqttInitialized && mqttClient && mqttClient->isConnectedToBroker();
+  unsigned long wakeAt = 0;
+  bool idle = parked && gps.getBackupEnd(wakeAt) && batcher.size() == 0 &&
+              (!mqttClient || mqttClient->getPendingCount() == 0) &&
+              !(connected && journalInitialized && journal.getPending() > 0);
+  SleepMode mode = idle ? sleeper.plan(now, wakeAt) : SLEEP_NONE;
+  if (mode == SLEEP_NONE) {
+    gsm.setSleep(false); // Wake the modem if it was put to sleep
+    return;
+  }
+
+  // Broker unreachable: try again first (reconnect() paces the attempts)
+  if (!connected && gsm.isLinkFree() && mqttClient && mqttClient->reconnect())
+    return;
+
+  if (gsm.isReady()) {
+    // Deep sleep restarts the client: end the session cleanly first (the
+    // broker keeps it, MQTT_CLEAN_SESSION is false)
+    if (mode == SLEEP_DEEP && connected) {
+      if (gsm.isLinkFree())
+        mqttClient->disconnect();
+      return;
+    }
+    // AT+CSCLK=2 over the next loop() passes; registration is kept
+    gsm.setSleep(true);
+    if (!gsm.isAsleep())
+      return;
+  } else if (gsmInitialized && gsm.getState() != GSM_FAILED) {
+    return; // Bring-up in progress
+  }
+
+  if (mode == SLEEP_DEEP) {
+    saveRetainedState(now);
+    sleeper.deepSleep(wakeAt - now);
+  }
+  sleeper.lightSleep(wakeAt - now);
+}
+
+void saveRetainedState(unsigned long now) {
+  RetainedState &state = sleeper.retained();
+
+  state.reportLatitudeE7 = (int32_t)lround(scheduler.getLastLatitude() * 1e7);
+  state.reportLongitudeE7 =
+      (int32_t)lround(scheduler.getLastLongitude() * 1e7);
+  state.reportAgeMs = now - scheduler.getLastReportTime();
+
+  state.journalValid = journalInitialized;
+  if (journalInitialized) {
+    state.journal = journal.getCursor();
+  }
+  state.nextPacketId = mqttClient ? mqttClient->getNextPacketId() : 0;
+}
+
+void restoreRetainedState() {
+  const RetainedState &state = sleeper.retained();
+
+  // Still parked where the last report was made; the heartbeat stays due
+  // on its old schedule
+  scheduler.restoreParked(state.reportLatitudeE7 / 1e7,
+                          state.reportLongitudeE7 / 1e7,
+                          sleeper.getSleepStart() - state.reportAgeMs);
+  if (mqttClient) {
+    mqttClient->resumeSession(state.nextPacketId);
+  }
+}
+
+void sendStartHint() {
+  if (!sleeper.hasRetainedFix())
+    return;
+  unsigned long age = sleeper.getRetainedFixAgeMs();
+  if (age > GPS_HINT_MAX_AGE_MS)
+    return;
+
+  // A parked fix is still good; otherwise the vehicle may have moved on
+  const RetainedState &state = sleeper.retained();
+  uint32_t positionAccuracy =
+      state.fixParked ? 100 : 100 + age / 1000 * GPS_HINT_DRIFT_M_PER_S;
+  uint32_t utc = state.fixUtcSeconds ? state.fixUtcSeconds + age / 1000 : 0;
+  gps.sendStartHint(state.fixLatitudeE7 / 1e7, state.fixLongitudeE7 / 1e7,
+                    state.fixAltitudeDm / 10.0, positionAccuracy, utc,
+                    1000 + age / 20);
+
+  DEBUG_PRINT("   GPS start hint: fix from ");
+  DEBUG_PRINT(age / 1000);
+  DEBUG_PRINT(" s ago, ±");
+  DEBUG_PRINT(positionAccuracy);
+  DEBUG_PRINTLN(" m");
+}
+
+void reportBootMetrics() {
+  unsigned long connectMs = mqttClient->getFirstConnectTime();
+  DEBUG_PRINT("Boot to broker: ");
+  DEBUG_PRINT(connectMs);
+  DEBUG_PRINT(" ms, to first location: ");
+  DEBUG_PRINT(bootPublishMs);
+  DEBUG_PRINTLN(" ms");
+
+  char statusJSON[160];
+  JsonWriter json(statusJSON, sizeof(statusJSON));
+  json.beginObject();
+  json.field("status", "boot");
+  json.field("reset", sleeper.getResetReasonName());
+  json.field("warm", sleeper.isWarmBoot());
+  json.field("connect_ms", connectMs);
+  json.field("first_publish_ms", bootPublishMs);
+  json.endObject();
+  if (json.ok()) {
+    mqttClient->publishStatus(json.c_str(), json.size());
+  }
+}
+
+void publishMetrics(unsigned long now) {
+  // One array per stage: [samples, p50, p99, max] in microseconds
+  char metricsJSON[512];
+  JsonWriter json(metricsJSON, sizeof(metricsJSON));
+  json.beginObject();
+  json.field("status", "metrics");
+  json.field("window_s", (now - lastMetricsPublish) / 1000);
+  for (int i = 0; i < METRIC_STAGE_COUNT; i++) {
+    MetricStage stage = (MetricStage)i;
+    LatencySummary summary = metricSummary(stage, true);
+    json.key(metricStageName(stage));
+    json.beginArray();
+    json.value((unsigned long)summary.count);
+    json.value((unsigned long)summary.p50Us);
+    json.value((unsigned long)summary.p99Us);
+    json.value((unsigned long)summary.maxUs);
+    json.endArray();
+  }
+  json.field("gps_overruns",
+             (unsigned long)metricCounterValue(METRIC_GPS_UART_OVERRUN));
+  json.field("gsm_overruns",
+             (unsigned long)metricCounterValue(METRIC_GSM_UART_OVERRUN));
+  json.field("gps_bad_checksum", gps.getDroppedSentences());
+  json.field("gps_dropped_bytes", gps.getDroppedBytes());
+  json.field("free_heap", (unsigned long)ESP.getFreeHeap());
+  json.field("queue_dropped_status",
+             mqttClient->getDroppedCount(MQTT_PRIORITY_STATUS));
+  json.field("queue_dropped_metrics",
+             mqttClient->getDroppedCount(MQTT_PRIORITY_METRICS));
+  json.endObject();
+  lastMetricsPublish = now;
+
+  if (json.ok()) {
+    DEBUG_PRINT("Metrics: ");
+    DEBUG_PRINTLN(json.c_str());
+    mqttClient->publishMetrics(json.c_str(), json.size());
+  }
+}
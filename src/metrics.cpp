@@ -0,0 +1,117 @@
+#include "metrics.h"
+
+static LatencyHistogram histograms[METRIC_STAGE_COUNT];
+static std::atomic<uint32_t> counters[METRIC_COUNTER_COUNT];
+
+const char *metricStageName(MetricStage stage) {
+  switch (stage) {
+  case METRIC_GPS_UPDATE:
+    return "gps_update";
+  case METRIC_JSON_BUILD:
+    return "json_build";
+  case METRIC_PUBLISH:
+    return "publish";
+  case METRIC_MQTT_LOOP:
+    return "mqtt_loop";
+  case METRIC_AT_COMMAND:
+    return "at_command";
+  case METRIC_FIX_TO_PUBLISH:
+    return "fix_to_publish";
+  default:
+    return "unknown";
+  }
+}
+
+LatencyHistogram::LatencyHistogram() : maxUs(0) {
+  for (auto &bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint8_t LatencyHistogram::bucketOf(uint32_t us) {
+  if (us < METRIC_SUB_BUCKETS)
+    return (uint8_t)us;
+  // Octave from the leading bit, then the two bits below it
+  int octave = 31 - __builtin_clz(us);
+  int index = METRIC_SUB_BUCKETS * (octave - 1) + ((us >> (octave - 2)) & 3);
+  return index < METRIC_BUCKETS ? (uint8_t)index : METRIC_BUCKETS - 1;
+}
+
+uint32_t LatencyHistogram::bucketLimit(uint8_t index) {
+  if (index < METRIC_SUB_BUCKETS)
+    return index;
+  int octave = index / METRIC_SUB_BUCKETS + 1;
+  uint32_t sub = index % METRIC_SUB_BUCKETS;
+  return ((METRIC_SUB_BUCKETS + 1 + sub) << (octave - 2)) - 1;
+}
+
+void LatencyHistogram::record(uint32_t us) {
+  buckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+  uint32_t seen = maxUs.load(std::memory_order_relaxed);
+  while (us > seen &&
+         !maxUs.compare_exchange_weak(seen, us, std::memory_order_relaxed)) {
+  }
+}
+
+LatencySummary LatencyHistogram::summarize(bool reset) {
+  // Copy first: a record() landing in between counts in either window
+  uint32_t copy[METRIC_BUCKETS];
+  LatencySummary summary = {};
+  for (int i = 0; i < METRIC_BUCKETS; i++) {
+    copy[i] = reset ? buckets[i].exchange(0, std::memory_order_relaxed)
+                    : buckets[i].load(std::memory_order_relaxed);
+    summary.count += copy[i];
+  }
+  summary.maxUs = reset ? maxUs.exchange(0, std::memory_order_relaxed)
+                        : maxUs.load(std::memory_order_relaxed);
+  if (summary.count == 0)
+    return summary;
+
+  // Nearest rank: the smallest bucket holding at least p % of the samples
+  uint32_t rank50 = (summary.count + 1) / 2;
+  uint32_t rank99 = summary.count - summary.count / 100;
+  uint32_t seen = 0;
+  for (int i = 0; i < METRIC_BUCKETS; i++) {
+    if (copy[i] == 0)
+      continue;
+    uint32_t before = seen;
+    seen += copy[i];
+    // The last bucket also holds everything beyond its range
+    uint32_t limit = i == METRIC_BUCKETS - 1 ? summary.maxUs : bucketLimit(i);
+    if (limit > summary.maxUs)
+      limit = summary.maxUs;
+    if (before < rank50 && seen >= rank50)
+      summary.p50Us = limit;
+    if (before < rank99 && seen >= rank99) {
+      summary.p99Us = limit;
+      break;
+    }
+  }
+  return summary;
+}
+
+void metricRecord(MetricStage stage, uint32_t us) {
+#if METRICS_ENABLED
+  histograms[stage].record(us);
+#else
+  (void)stage;
+  (void)us;
+#endif
+}
+
+void metricRecordCycles(MetricStage stage, uint32_t cycles) {
+  static const uint32_t cyclesPerUs = ESP.getCpuFreqMHz();
+  metricRecord(stage, cycles / cyclesPerUs);
+}
+
+void metricCount(MetricCounter counter) {
+  counters[counter].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t metricCounterValue(MetricCounter counter) {
+  return counters[counter].load(std::memory_order_relaxed);
+}
+
+LatencySummary metricSummary(MetricStage stage, bool reset) {
+  return histograms[stage].summarize(reset);
+}
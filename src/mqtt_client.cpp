@@ -1,15 +1,23 @@
 #include "mqtt_client.h"
+#include "metrics.h"
+
+MQTTClientModule *MQTTClientModule::instance = nullptr;
 
 MQTTClientModule::MQTTClientModule(GSMModule *gsm)
     : gsmModule(gsm), isConnected(false), lastReconnectAttempt(0),
-      reconnectInterval(MQTT_RECONNECT_INTERVAL), reconnectAttempts(0) {
+      reconnectInterval(MQTT_RECONNECT_INTERVAL), reconnectAttempts(0),
+      firstConnectTime(0), commandHandler(nullptr), commandContext(nullptr) {
   mqttClient = nullptr;
+  instance = this;
 }
 
 MQTTClientModule::~MQTTClientModule() {
   if (mqttClient) {
     delete mqttClient;
   }
+  if (instance == this) {
+    instance = nullptr;
+  }
 }
 
 bool MQTTClientModule::begin() {
@@ -26,8 +34,10 @@ bool MQTTClientModule::begin() {
     return true;
   }
 
-  // Create MQTT client with GSM client
-  mqttClient = new PubSubClient(*gsmModule->getClient());
+  // Create MQTT client on the GSM socket, through the wire tap
+  wireTap.attach(gsmModule->getClient());
+  mqttClient = new PubSubClient(wireTap);
+  outbox.begin(&wireTap);
 
   // Set MQTT broker
   mqttClient->setServer(MQTT_BROKER, MQTT_PORT);
@@ -38,6 +48,9 @@ bool MQTTClientModule::begin() {
   // Increase buffer size for larger messages
   mqttClient->setBufferSize(MQTT_BUFFER_SIZE);
 
+  // Long enough that a light sleep while parked does not drop the session
+  mqttClient->setKeepAlive(MQTT_KEEPALIVE_S);
+
   DEBUG_PRINTLN("MQTT client initialized");
 
   return true;
@@ -53,6 +66,10 @@ bool MQTTClientModule::connect() {
     DEBUG_PRINTLN("No GPRS connection for MQTT!");
     return false;
   }
+  if (!gsmModule->isLinkFree()) {
+    DEBUG_PRINTLN("Modem busy, MQTT connect deferred");
+    return false;
+  }
 
   DEBUG_PRINT("Connecting to MQTT broker: ");
   DEBUG_PRINTLN(MQTT_BROKER);
@@ -60,38 +77,66 @@ bool MQTTClientModule::connect() {
   // Attempt connection
   bool connected = false;
 
-  if (strlen(MQTT_USER) > 0) {
-    connected = mqttClient->connect(MQTT_CLIENT_ID, MQTT_USER, MQTT_PASS);
-  } else {
-    connected = mqttClient->connect(MQTT_CLIENT_ID);
-  }
+  // cleanSession=false keeps the broker's QoS 1 state for this client ID
+  const char *user = strlen(MQTT_USER) > 0 ? MQTT_USER : nullptr;
+  const char *pass = strlen(MQTT_USER) > 0 ? MQTT_PASS : nullptr;
+  connected = mqttClient->connect(MQTT_CLIENT_ID, user, pass, nullptr, 0,
+                                  false, nullptr, MQTT_CLEAN_SESSION);
 
   if (connected) {
     DEBUG_PRINTLN("MQTT connected!");
     isConnected = true;
+    gsmModule->setSocketOpen(true);
+    if (firstConnectTime == 0) {
+      firstConnectTime = millis() | 1; // Never 0 once set
+    }
 
     // Reset backoff on successful connection
     reconnectAttempts = 0;
     reconnectInterval = MQTT_RECONNECT_INTERVAL;
 
+    // Unacknowledged messages from the previous connection go out again
+    outbox.requeueInFlight();
+    if (outbox.pending() > 0) {
+      DEBUG_PRINT("Resending ");
+      DEBUG_PRINT((unsigned long)outbox.pending());
+      DEBUG_PRINT(" queued messages (session present: ");
+      DEBUG_PRINT(wireTap.wasSessionPresent() ? "yes" : "no");
+      DEBUG_PRINTLN(")");
+    }
+
     // Publish connection status
-    publishStatus("{\"status\":\"connected\",\"device\":\"" MQTT_CLIENT_ID
-                  "\"}");
+    static const char connectedStatus[] =
+        "{\"status\":\"connected\",\"device\":\"" MQTT_CLIENT_ID "\"}";
+    publishStatus(connectedStatus, sizeof(connectedStatus) - 1,
+                  MQTT_STATUS_CONNECTION);
+
+    if (commandHandler) {
+      subscribe(MQTT_TOPIC_COMMAND);
+    }
 
     return true;
   } else {
     DEBUG_PRINT("MQTT connection failed, rc=");
     DEBUG_PRINTLN(mqttClient->state());
     isConnected = false;
+    gsmModule->setSocketOpen(false);
     return false;
   }
 }
 
 void MQTTClientModule::disconnect() {
   if (mqttClient && isConnected) {
-    publishStatus("{\"status\":\"disconnecting\"}");
+    // Written directly: nothing would service the queue after this
+    static const char disconnectingStatus[] = "{\"status\":\"disconnecting\"}";
+    if (gsmModule->isLinkFree()) {
+      mqttClient->publish(MQTT_TOPIC_STATUS,
+                          (const uint8_t *)disconnectingStatus,
+                          sizeof(disconnectingStatus) - 1, false);
+    }
     mqttClient->disconnect();
     isConnected = false;
+    gsmModule->setSocketOpen(false);
     DEBUG_PRINTLN("MQTT disconnected");
   }
 }
@@ -100,11 +145,17 @@ bool MQTTClientModule::isConnectedToBroker() {
   if (!mqttClient)
     return false;
 
-  isConnected = mqttClient->connected();
+  // Cached: connect(), loop() and the modem's CLOSED report keep it
+  // current, so checking it costs no modem round trip
+  if (isConnected &&
+      (!gsmModule->isReady() || !gsmModule->getHealth().socketOpen)) {
+    isConnected = false;
+  }
   return isConnected;
 }
 
-bool MQTTClientModule::publishLocation(const String &locationData) {
+bool MQTTClientModule::publishLocation(const char *payload, size_t length,
+                                       uint32_t tag) {
   if (!isConnectedToBroker()) {
     DEBUG_PRINTLN("Not connected to MQTT broker!");
     return false;
@@ -112,10 +163,13 @@ bool MQTTClientModule::publishLocation(const String &locationData) {
 
   DEBUG_PRINT("Publishing to topic: ");
   DEBUG_PRINTLN(MQTT_TOPIC_GPS);
-  DEBUG_PRINTLN(locationData);
+#if ENABLE_DEBUG
+  DEBUG_SERIAL.write((const uint8_t *)payload, length);
+  DEBUG_PRINTLN();
+#endif
 
-  bool result =
-      mqttClient->publish(MQTT_TOPIC_GPS, locationData.c_str(), false);
+  bool result = publishData(MQTT_TOPIC_GPS, (const uint8_t *)payload, length,
+                            MQTT_PRIORITY_FIX, MQTT_QOS, 0, tag);
 
   if (result) {
     DEBUG_PRINTLN("Location published successfully");
@@ -126,12 +180,88 @@ bool MQTTClientModule::publishLocation(const String &locationData) {
   return result;
 }
 
-bool MQTTClientModule::publishStatus(const String &statusData) {
+bool MQTTClientModule::publishLocationBinary(const uint8_t *payload,
+                                             unsigned int length) {
+  if (!isConnectedToBroker()) {
+    DEBUG_PRINTLN("Not connected to MQTT broker!");
+    return false;
+  }
+
+  DEBUG_PRINT("Publishing ");
+  DEBUG_PRINT(length);
+  DEBUG_PRINT(" bytes to topic: ");
+  DEBUG_PRINTLN(MQTT_TOPIC_GPS_BIN);
+
+  bool result = publishData(MQTT_TOPIC_GPS_BIN, payload, length,
+                            MQTT_PRIORITY_FIX, MQTT_QOS);
+  if (!result) {
+    DEBUG_PRINTLN("Failed to publish binary location");
+  }
+  return result;
+}
+
+bool MQTTClientModule::publishLocationCompressed(const uint8_t *payload,
+                                                 unsigned int length) {
+  if (!isConnectedToBroker()) {
+    DEBUG_PRINTLN("Not connected to MQTT broker!");
+    return false;
+  }
+
+  DEBUG_PRINT("Publishing ");
+  DEBUG_PRINT(length);
+  DEBUG_PRINT(" bytes to topic: ");
+  DEBUG_PRINTLN(MQTT_TOPIC_GPS_Z);
+
+  bool result = publishData(MQTT_TOPIC_GPS_Z, payload, length,
+                            MQTT_PRIORITY_FIX, MQTT_QOS);
+  if (!result) {
+    DEBUG_PRINTLN("Failed to publish compressed location");
+  }
+  return result;
+}
+
+bool MQTTClientModule::publishData(const char *topic, const uint8_t *payload,
+                                   size_t length, MqttPriority priority,
+                                   uint8_t qos, uint8_t key, uint32_t tag) {
+  StageTimer timer(METRIC_PUBLISH);
+  // Accepted means queued; the outbox delivers it
+  if (!outbox.enqueue(topic, payload, length, priority, qos, key, millis(),
+                      tag))
+    return false;
+  if (gsmModule->isLinkFree())
+    outbox.service(millis());
+  return true;
+}
+
+bool MQTTClientModule::publishStatus(const char *payload, size_t length,
+                                     MqttStatusKind kind) {
   if (!isConnectedToBroker()) {
     return false;
   }
 
-  return mqttClient->publish(MQTT_TOPIC_STATUS, statusData.c_str(), false);
+  return publishData(MQTT_TOPIC_STATUS, (const uint8_t *)payload, length,
+                     MQTT_PRIORITY_STATUS, 0, kind);
+}
+
+bool MQTTClientModule::publishMetrics(const char *payload, size_t length) {
+  if (!isConnectedToBroker()) {
+    return false;
+  }
+
+  return publishData(MQTT_TOPIC_STATUS, (const uint8_t *)payload, length,
+                     MQTT_PRIORITY_METRICS, 0);
+}
+
+bool MQTTClientModule::publishAlarm(const char *payload, size_t length) {
+  // Queued even while disconnected: sent first once the broker is back
+  DEBUG_PRINT("Alarm: ");
+#if ENABLE_DEBUG
+  DEBUG_SERIAL.write((const uint8_t *)payload, length);
+#endif
+  DEBUG_PRINTLN();
+
+  return publishData(MQTT_TOPIC_ALARM, (const uint8_t *)payload, length,
+                     MQTT_PRIORITY_ALARM, 1);
 }
 
 bool MQTTClientModule::subscribe(const char *topic) {
@@ -139,6 +269,8 @@ bool MQTTClientModule::subscribe(const char *topic) {
     DEBUG_PRINTLN("Cannot subscribe - not connected!");
     return false;
   }
+  if (!gsmModule->isLinkFree())
+    return false;
 
   DEBUG_PRINT("Subscribing to topic: ");
   DEBUG_PRINTLN(topic);
@@ -146,18 +278,49 @@ bool MQTTClientModule::subscribe(const char *topic) {
   return mqttClient->subscribe(topic);
 }
 
+void MQTTClientModule::onCommand(MqttCommandHandler handler, void *context) {
+  commandHandler = handler;
+  commandContext = context;
+  if (handler && isConnectedToBroker()) {
+    subscribe(MQTT_TOPIC_COMMAND);
+  }
+}
+
 void MQTTClientModule::loop() {
-  if (mqttClient && isConnected) {
-    mqttClient->loop();
+  // Skipped while an AT command is in flight; the next tick catches up
+  if (mqttClient && isConnected && gsmModule->isLinkFree()) {
+    // +CIPRXGET: 1 arrived: PUBACKs or commands are waiting on the modem
+    gsmModule->takeDataNotice();
+
+    // false: keep-alive or socket failed and PubSubClient closed it
+    if (!mqttClient->loop()) {
+      DEBUG_PRINTLN("MQTT connection lost");
+      isConnected = false;
+      gsmModule->setSocketOpen(false);
+      return;
+    }
+    outbox.service(millis());
   }
 }
 
+uint16_t MQTTClientModule::getNextPacketId() const {
+  return outbox.getNextPacketId();
+}
+
+void MQTTClientModule::resumeSession(uint16_t nextPacketId) {
+  outbox.setNextPacketId(nextPacketId);
+}
+
 bool MQTTClientModule::reconnect() {
   // Don't attempt to reconnect too frequently (use exponential backoff)
   unsigned long now = millis();
   if (now - lastReconnectAttempt < reconnectInterval) {
     return false;
   }
+  // Modem mid-command or waking from sleep: not an attempt, try again soon
+  if (gsmModule->isReady() && !gsmModule->isLinkFree()) {
+    return false;
+  }
 
   lastReconnectAttempt = now;
   reconnectAttempts++;
@@ -166,21 +329,12 @@ bool MQTTClientModule::reconnect() {
   DEBUG_PRINT(reconnectAttempts);
   DEBUG_PRINTLN(")...");
 
-  // First ensure GPRS is connected
-  if (!gsmModule->isGPRSConnected()) {
-    DEBUG_PRINTLN("GPRS not connected, attempting to connect...");
-    if (!gsmModule->connectGPRS()) {
-      DEBUG_PRINTLN("GPRS connection failed!");
-
-      // Increase backoff interval (exponential backoff with cap)
-      reconnectInterval = min(reconnectInterval * 2,
-                              (unsigned long)MQTT_RECONNECT_MAX_INTERVAL);
-      DEBUG_PRINT("Next retry in ");
-      DEBUG_PRINT(reconnectInterval / 1000);
-      DEBUG_PRINTLN(" seconds");
-
-      return false;
-    }
+  // GPRS comes up in the background (GSMModule::poll())
+  if (!gsmModule->connectGPRS()) {
+    DEBUG_PRINT("GPRS not up yet (");
+    DEBUG_PRINT(gsmStateName(gsmModule->getState()));
+    DEBUG_PRINTLN(")");
+    return false;
   }
 
   // Then connect to MQTT
@@ -209,6 +363,9 @@ void MQTTClientModule::messageCallback(char *topic, byte *payload,
   }
   DEBUG_PRINTLN();
 
-  // Handle incoming messages here
-  // You can add custom logic based on topic and payload
+  if (instance && instance->commandHandler &&
+      !strcmp(topic, MQTT_TOPIC_COMMAND)) {
+    instance->commandHandler(instance->commandContext, (const char *)payload,
+                             length);
+  }
 }
@@ -0,0 +1,281 @@
+#include "mqtt_outbox.h"
+
+#include <string.h>
+
+static_assert(MQTT_INFLIGHT_WINDOW >= 1 &&
+                  MQTT_INFLIGHT_WINDOW <= MQTT_OUTBOX_SLOTS,
+              "MQTT_INFLIGHT_WINDOW must be 1..MQTT_OUTBOX_SLOTS");
+static_assert(MQTT_INFLIGHT_WINDOW <= MQTT_TAP_ACK_QUEUE,
+              "In-flight window larger than the PUBACK queue");
+static_assert(MQTT_OUTBOX_ALARM_SLOTS < MQTT_OUTBOX_SLOTS,
+              "MQTT_OUTBOX_ALARM_SLOTS leaves no slot for other messages");
+
+#define MQTT_PUBLISH 0x30 // PUBLISH, QoS 0, no retain
+#define MQTT_PUBLISH_QOS1 0x02
+#define MQTT_PUBLISH_DUP 0x08
+
+const char *mqttPriorityName(MqttPriority priority) {
+  switch (priority) {
+  case MQTT_PRIORITY_ALARM:
+    return "alarm";
+  case MQTT_PRIORITY_FIX:
+    return "fix";
+  case MQTT_PRIORITY_STATUS:
+    return "status";
+  case MQTT_PRIORITY_METRICS:
+    return "metrics";
+  default:
+    return "unknown";
+  }
+}
+
+// Status and metrics may be dropped to keep the link for what matters
+static bool isDisposable(MqttPriority priority) {
+  return priority >= MQTT_PRIORITY_STATUS;
+}
+
+MqttOutbox::MqttOutbox()
+    : tap(nullptr), nextPacketId(1), nextOrder(0),
+      deliveredHandler(nullptr), deliveredContext(nullptr), acknowledged(0),
+      retransmits(0), coalesced(0) {
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    slots[i].state = SLOT_FREE;
+  }
+  for (size_t i = 0; i < MQTT_PRIORITY_COUNT; i++) {
+    dropped[i] = 0;
+  }
+}
+
+MqttOutbox::Slot *MqttOutbox::findQueued(MqttPriority priority, uint8_t key) {
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    if (slots[i].state == SLOT_QUEUED && slots[i].priority == priority &&
+        slots[i].key == key)
+      return &slots[i];
+  }
+  return nullptr;
+}
+
+void MqttOutbox::drop(Slot &slot) {
+  dropped[slot.priority]++;
+  slot.state = SLOT_FREE;
+}
+
+void MqttOutbox::release(Slot &slot) {
+  slot.state = SLOT_FREE;
+  if (slot.tag != 0 && deliveredHandler)
+    deliveredHandler(deliveredContext, slot.tag);
+}
+
+MqttOutbox::Slot *MqttOutbox::acquire(MqttPriority priority) {
+  size_t freeCount = 0;
+  Slot *freeSlot = nullptr;
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    if (slots[i].state == SLOT_FREE) {
+      freeCount++;
+      freeSlot = &slots[i];
+    }
+  }
+  size_t reserved =
+      priority == MQTT_PRIORITY_ALARM ? 0 : MQTT_OUTBOX_ALARM_SLOTS;
+  if (freeCount > reserved)
+    return freeSlot;
+
+  // Oldest queued message of the least valuable class below this one
+  Slot *victim = nullptr;
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    Slot &slot = slots[i];
+    if (slot.state != SLOT_QUEUED || slot.priority <= priority ||
+        !isDisposable(slot.priority))
+      continue;
+    if (!victim || slot.priority > victim->priority ||
+        (slot.priority == victim->priority &&
+         (int32_t)(slot.order - victim->order) < 0))
+      victim = &slot;
+  }
+  if (!victim)
+    return nullptr;
+  drop(*victim);
+  return victim;
+}
+
+bool MqttOutbox::enqueue(const char *topic, const uint8_t *payload,
+                         size_t length, MqttPriority priority, uint8_t qos,
+                         uint8_t key, unsigned long now, uint32_t tag) {
+  size_t topicLength = strlen(topic);
+  size_t remaining = 2 + topicLength + (qos > 0 ? 2 : 0) + length;
+  uint8_t header[5];
+  size_t headerLength = 0;
+  header[headerLength++] = MQTT_PUBLISH | (qos > 0 ? MQTT_PUBLISH_QOS1 : 0);
+  size_t value = remaining;
+  do {
+    uint8_t digit = value % 128;
+    value /= 128;
+    header[headerLength++] = digit | (value > 0 ? 0x80 : 0);
+  } while (value > 0 && headerLength < sizeof(header));
+
+  if (headerLength + remaining > MQTT_OUTBOX_PACKET_SIZE)
+    return false;
+
+  // A newer status of the same kind takes the queued one's place in line
+  Slot *slot = key != 0 ? findQueued(priority, key) : nullptr;
+  if (slot) {
+    coalesced++;
+  } else {
+    slot = acquire(priority);
+    if (!slot)
+      return false;
+    slot->order = nextOrder++;
+  }
+
+  uint16_t packetId = 0;
+  if (qos > 0) {
+    // Packet identifier 0 is not allowed
+    packetId = nextPacketId++;
+    if (nextPacketId == 0)
+      nextPacketId = 1;
+  }
+
+  uint8_t *out = slot->packet;
+  memcpy(out, header, headerLength);
+  out += headerLength;
+  *out++ = (uint8_t)(topicLength >> 8);
+  *out++ = (uint8_t)topicLength;
+  memcpy(out, topic, topicLength);
+  out += topicLength;
+  if (qos > 0) {
+    *out++ = (uint8_t)(packetId >> 8);
+    *out++ = (uint8_t)packetId;
+  }
+  memcpy(out, payload, length);
+
+  slot->length = (uint16_t)(headerLength + remaining);
+  slot->packetId = packetId;
+  slot->queuedAt = now;
+  slot->attempts = 0;
+  slot->key = key;
+  slot->tag = tag;
+  slot->priority = priority;
+  slot->state = SLOT_QUEUED;
+  return true;
+}
+
+MqttOutbox::Slot *MqttOutbox::findByPacketId(uint16_t packetId) {
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    if (slots[i].state != SLOT_FREE && slots[i].packetId == packetId)
+      return &slots[i];
+  }
+  return nullptr;
+}
+
+MqttOutbox::Slot *MqttOutbox::nextQueued() {
+  Slot *next = nullptr;
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    Slot &slot = slots[i];
+    if (slot.state != SLOT_QUEUED)
+      continue;
+    if (!next || slot.priority < next->priority ||
+        (slot.priority == next->priority &&
+         (int32_t)(slot.order - next->order) < 0))
+      next = &slot;
+  }
+  return next;
+}
+
+bool MqttOutbox::send(Slot &slot, unsigned long now) {
+  if (slot.attempts > 0) {
+    slot.packet[0] |= MQTT_PUBLISH_DUP;
+    retransmits++;
+  }
+  if (tap->write(slot.packet, slot.length) != slot.length)
+    return false;
+  if (slot.packetId == 0) {
+    release(slot); // QoS 0: done once written
+    return true;
+  }
+  slot.state = SLOT_IN_FLIGHT;
+  slot.sentAt = now;
+  if (slot.attempts < 255)
+    slot.attempts++;
+  return true;
+}
+
+void MqttOutbox::service(unsigned long now) {
+  if (!tap)
+    return;
+
+  uint16_t packetId;
+  while (packetId = 0, tap->takeAck(packetId)) {
+    Slot *slot = packetId ? findByPacketId(packetId) : nullptr;
+    if (slot) {
+      acknowledged++;
+      release(*slot);
+    }
+  }
+
+  // Status nobody has seen for this long no longer describes the device
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    if (slots[i].state == SLOT_QUEUED && isDisposable(slots[i].priority) &&
+        now - slots[i].queuedAt >= MQTT_STATUS_MAX_AGE_MS)
+      drop(slots[i]);
+  }
+
+  if (!tap->connected())
+    return;
+
+  // Stale messages go back in line ahead of newer ones (order is kept)
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    if (slots[i].state == SLOT_IN_FLIGHT &&
+        now - slots[i].sentAt >= MQTT_RETRY_INTERVAL_MS)
+      slots[i].state = SLOT_QUEUED;
+  }
+
+  // Strictly by priority: a QoS 1 message waiting for the window holds
+  // back everything behind it
+  while (Slot *slot = nextQueued()) {
+    if (slot->packetId != 0 && inFlight() >= MQTT_INFLIGHT_WINDOW)
+      break;
+    if (!send(*slot, now))
+      break;
+  }
+}
+
+void MqttOutbox::requeueInFlight() {
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    if (slots[i].state == SLOT_IN_FLIGHT)
+      slots[i].state = SLOT_QUEUED;
+  }
+}
+
+size_t MqttOutbox::room(MqttPriority priority) const {
+  size_t freeCount = 0;
+  size_t victims = 0;
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    const Slot &slot = slots[i];
+    if (slot.state == SLOT_FREE)
+      freeCount++;
+    else if (slot.state == SLOT_QUEUED && slot.priority > priority &&
+             isDisposable(slot.priority))
+      victims++;
+  }
+  size_t reserved =
+      priority == MQTT_PRIORITY_ALARM ? 0 : MQTT_OUTBOX_ALARM_SLOTS;
+  return (freeCount > reserved ? freeCount - reserved : 0) + victims;
+}
+
+size_t MqttOutbox::pending() const {
+  size_t n = 0;
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    if (slots[i].state != SLOT_FREE)
+      n++;
+  }
+  return n;
+}
+
+size_t MqttOutbox::inFlight() const {
+  size_t n = 0;
+  for (size_t i = 0; i < MQTT_OUTBOX_SLOTS; i++) {
+    if (slots[i].state == SLOT_IN_FLIGHT)
+      n++;
+  }
+  return n;
+}
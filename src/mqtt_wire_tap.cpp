@@ -0,0 +1,110 @@
+#include "mqtt_wire_tap.h"
+
+#define MQTT_PACKET_CONNACK 2
+#define MQTT_PACKET_PUBACK 4
+
+MqttWireTap::MqttWireTap()
+    : inner(nullptr), frameState(FRAME_HEADER), packetType(0), remaining(0),
+      lengthMultiplier(1), bodyCount(0), ackHead(0), ackCount(0),
+      droppedAcks(0), sessionPresent(false) {}
+
+void MqttWireTap::observe(uint8_t byte) {
+  switch (frameState) {
+  case FRAME_HEADER:
+    packetType = byte >> 4;
+    remaining = 0;
+    lengthMultiplier = 1;
+    bodyCount = 0;
+    frameState = FRAME_LENGTH;
+    break;
+
+  case FRAME_LENGTH:
+    remaining += (byte & 0x7F) * lengthMultiplier;
+    lengthMultiplier <<= 7;
+    if (byte & 0x80)
+      break;
+    if (remaining == 0) {
+      packetComplete();
+      frameState = FRAME_HEADER;
+    } else {
+      frameState = FRAME_BODY;
+    }
+    break;
+
+  case FRAME_BODY:
+    if (bodyCount < sizeof(body))
+      body[bodyCount++] = byte;
+    if (--remaining == 0) {
+      packetComplete();
+      frameState = FRAME_HEADER;
+    }
+    break;
+  }
+}
+
+void MqttWireTap::packetComplete() {
+  if (packetType == MQTT_PACKET_CONNACK && bodyCount >= 1) {
+    sessionPresent = body[0] & 0x01;
+  } else if (packetType == MQTT_PACKET_PUBACK && bodyCount == 2) {
+    if (ackCount == MQTT_TAP_ACK_QUEUE) {
+      droppedAcks++; // The message will be resent and acknowledged again
+      return;
+    }
+    acks[(ackHead + ackCount) % MQTT_TAP_ACK_QUEUE] =
+        (uint16_t)(body[0] << 8 | body[1]);
+    ackCount++;
+  }
+}
+
+bool MqttWireTap::takeAck(uint16_t &packetId) {
+  if (ackCount == 0)
+    return false;
+  packetId = acks[ackHead];
+  ackHead = (ackHead + 1) % MQTT_TAP_ACK_QUEUE;
+  ackCount--;
+  return true;
+}
+
+int MqttWireTap::connect(IPAddress ip, uint16_t port) {
+  // A new connection starts on a packet boundary
+  frameState = FRAME_HEADER;
+  return inner->connect(ip, port);
+}
+
+int MqttWireTap::connect(const char *host, uint16_t port) {
+  frameState = FRAME_HEADER;
+  return inner->connect(host, port);
+}
+
+size_t MqttWireTap::write(uint8_t b) { return inner->write(b); }
+
+size_t MqttWireTap::write(const uint8_t *buf, size_t size) {
+  return inner->write(buf, size);
+}
+
+int MqttWireTap::available() { return inner->available(); }
+
+int MqttWireTap::read() {
+  int c = inner->read();
+  if (c >= 0)
+    observe((uint8_t)c);
+  return c;
+}
+
+int MqttWireTap::read(uint8_t *buf, size_t size) {
+  int n = inner->read(buf, size);
+  for (int i = 0; i < n; i++) {
+    observe(buf[i]);
+  }
+  return n;
+}
+
+int MqttWireTap::peek() { return inner->peek(); }
+
+void MqttWireTap::flush() { inner->flush(); }
+
+void MqttWireTap::stop() { inner->stop(); }
+
+uint8_t MqttWireTap::connected() { return inner ? inner->connected() : 0; }
+
+MqttWireTap::operator bool() { return inner && (bool)*inner; }
@@ -0,0 +1,281 @@
+#include "nmea_parser.h"
+
+#include <string.h>
+
+#define RING_MASK (GPS_RING_BUFFER_SIZE - 1)
+#define NMEA_MAX_FIELDS 20
+#define KMPH_PER_KNOT 1.852
+
+static_assert((GPS_RING_BUFFER_SIZE & RING_MASK) == 0,
+              "GPS_RING_BUFFER_SIZE must be a power of two");
+
+static const double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5,
+                               1e6, 1e7, 1e8, 1e9, 1e10};
+
+// Parse an unsigned decimal such as "3648.38330"; empty fields fail
+static bool parseDecimal(const char *s, double &out) {
+  if (*s == '\0')
+    return false;
+  bool negative = (*s == '-');
+  if (negative)
+    s++;
+  uint64_t mantissa = 0;
+  int decimals = -1;
+  for (; *s; s++) {
+    if (*s == '.' && decimals < 0) {
+      decimals = 0;
+    } else if (*s >= '0' && *s <= '9') {
+      if (decimals < 10) {
+        mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+        if (decimals >= 0)
+          decimals++;
+      }
+    } else {
+      return false;
+    }
+  }
+  out = (double)mantissa / POW10[decimals < 0 ? 0 : decimals];
+  if (negative)
+    out = -out;
+  return true;
+}
+
+static bool parseUnsigned(const char *s, uint32_t &out) {
+  if (*s < '0' || *s > '9')
+    return false;
+  uint32_t value = 0;
+  for (; *s >= '0' && *s <= '9'; s++)
+    value = value * 10 + (uint32_t)(*s - '0');
+  out = value;
+  return true;
+}
+
+static int twoDigits(const char *s) { return (s[0] - '0') * 10 + (s[1] - '0'); }
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+// "ddmm.mmmm" / "dddmm.mmmm" plus hemisphere to signed degrees
+static bool parseCoordinate(const char *value, const char *hemisphere,
+                            double &out) {
+  double raw;
+  if (!parseDecimal(value, raw) || *hemisphere == '\0')
+    return false;
+  int degrees = (int)(raw / 100.0);
+  double result = degrees + (raw - degrees * 100.0) / 60.0;
+  if (*hemisphere == 'S' || *hemisphere == 'W')
+    result = -result;
+  out = result;
+  return true;
+}
+
+// "hhmmss.ss"
+static bool parseTime(const char *s, GpsFix &fix) {
+  if (strlen(s) < 6)
+    return false;
+  fix.hour = (uint8_t)twoDigits(s);
+  fix.minute = (uint8_t)twoDigits(s + 2);
+  fix.second = (uint8_t)twoDigits(s + 4);
+  fix.centisecond = (s[6] == '.' && s[7]) ? (uint8_t)((s[7] - '0') * 10 +
+                                                      (s[8] ? s[8] - '0' : 0))
+                                          : 0;
+  fix.timeValid = true;
+  return true;
+}
+
+NmeaParser::NmeaParser()
+    : head(0), tail(0), scanned(0), charsProcessed(0), sentencesParsed(0),
+      sentencesIgnored(0), checksumFailures(0), droppedBytes(0) {}
+
+uint8_t *NmeaParser::writeSpace(size_t &length) {
+  size_t used = head - tail;
+  if (used == GPS_RING_BUFFER_SIZE) {
+    // A full ring without a line feed is line noise; start over
+    droppedBytes += used;
+    charsProcessed += used;
+    tail = scanned = head;
+    used = 0;
+  }
+  size_t offset = head & RING_MASK;
+  size_t free = GPS_RING_BUFFER_SIZE - used;
+  size_t contiguous = GPS_RING_BUFFER_SIZE - offset;
+  length = free < contiguous ? free : contiguous;
+  return &ring[offset];
+}
+
+void NmeaParser::commit(size_t length) { head += length; }
+
+void NmeaParser::process(GpsFix &fix, unsigned long now) {
+  while (scanned < head) {
+    size_t offset = scanned & RING_MASK;
+    size_t length = head - scanned;
+    if (length > GPS_RING_BUFFER_SIZE - offset)
+      length = GPS_RING_BUFFER_SIZE - offset;
+
+    const uint8_t *lf = (const uint8_t *)memchr(&ring[offset], '\n', length);
+    if (!lf) {
+      scanned += length;
+      continue;
+    }
+
+    size_t end = scanned + (size_t)(lf - &ring[offset]);
+    handleSentence(tail, end, fix, now);
+    charsProcessed += end + 1 - tail;
+    tail = scanned = end + 1;
+  }
+}
+
+void NmeaParser::handleSentence(size_t start, size_t end, GpsFix &fix,
+                                unsigned long now) {
+  while (start < end && ring[start & RING_MASK] != '$')
+    start++;
+  if (end > start && ring[(end - 1) & RING_MASK] == '\r')
+    end--;
+
+  size_t length = end - start; // From '$' up to the checksum digits
+  if (length < 10 || length >= NMEA_MAX_SENTENCE) {
+    checksumFailures++;
+    return;
+  }
+
+  // "$GPGGA" / "$GNRMC": talker is ignored, the type decides
+  char t0 = ring[(start + 3) & RING_MASK];
+  char t1 = ring[(start + 4) & RING_MASK];
+  char t2 = ring[(start + 5) & RING_MASK];
+  bool isGGA = (t0 == 'G' && t1 == 'G' && t2 == 'A');
+  bool isRMC = (t0 == 'R' && t1 == 'M' && t2 == 'C');
+  bool isVTG = (t0 == 'V' && t1 == 'T' && t2 == 'G');
+  if (!isGGA && !isRMC && !isVTG) {
+    sentencesIgnored++;
+    return;
+  }
+
+  // Copy out of the ring and checksum in the same pass
+  uint8_t checksum = 0;
+  size_t n = 0;
+  size_t i = start + 1;
+  for (; i < end; i++) {
+    char c = ring[i & RING_MASK];
+    if (c == '*')
+      break;
+    checksum ^= (uint8_t)c;
+    sentence[n++] = c;
+  }
+  sentence[n] = '\0';
+  if (end - i != 3) { // '*' and two hex digits
+    checksumFailures++;
+    return;
+  }
+  int hi = hexDigit(ring[(i + 1) & RING_MASK]);
+  int lo = hexDigit(ring[(i + 2) & RING_MASK]);
+  if (hi < 0 || lo < 0 || checksum != (uint8_t)((hi << 4) | lo)) {
+    checksumFailures++;
+    return;
+  }
+
+  char *fields[NMEA_MAX_FIELDS];
+  int count = 0;
+  char *p = sentence;
+  fields[count++] = p;
+  for (; *p; p++) {
+    if (*p == ',') {
+      *p = '\0';
+      if (count < NMEA_MAX_FIELDS)
+        fields[count++] = p + 1;
+    }
+  }
+
+  bool decoded = isGGA   ? decodeGGA(fields, count, fix, now)
+                 : isRMC ? decodeRMC(fields, count, fix, now)
+                         : decodeVTG(fields, count, fix);
+  if (decoded)
+    sentencesParsed++;
+  else
+    sentencesIgnored++;
+}
+
+// $--GGA,time,lat,N,lon,E,quality,numSV,hdop,alt,M,sep,M,age,station
+bool NmeaParser::decodeGGA(char **fields, int count, GpsFix &fix,
+                           unsigned long now) {
+  if (count < 10)
+    return false;
+
+  uint32_t satellites;
+  if (parseUnsigned(fields[7], satellites)) {
+    fix.satellites = (uint8_t)satellites;
+    fix.satellitesValid = true;
+  }
+
+  uint32_t quality;
+  if (!parseUnsigned(fields[6], quality) || quality == 0)
+    return true; // No fix yet; satellites still count
+
+  parseTime(fields[1], fix);
+  double latitude, longitude;
+  if (parseCoordinate(fields[2], fields[3], latitude) &&
+      parseCoordinate(fields[4], fields[5], longitude)) {
+    fix.latitude = latitude;
+    fix.longitude = longitude;
+    fix.locationValid = true;
+    fix.locationMillis = now;
+  }
+  if (parseDecimal(fields[8], fix.hdop))
+    fix.hdopValid = true;
+  if (parseDecimal(fields[9], fix.altitude))
+    fix.altitudeValid = true;
+  return true;
+}
+
+// $--RMC,time,status,lat,N,lon,E,speedKnots,course,ddmmyy,magvar,E,mode
+bool NmeaParser::decodeRMC(char **fields, int count, GpsFix &fix,
+                           unsigned long now) {
+  if (count < 10)
+    return false;
+  if (fields[2][0] != 'A')
+    return true; // Receiver reports no valid fix
+
+  parseTime(fields[1], fix);
+  double latitude, longitude;
+  if (parseCoordinate(fields[3], fields[4], latitude) &&
+      parseCoordinate(fields[5], fields[6], longitude)) {
+    fix.latitude = latitude;
+    fix.longitude = longitude;
+    fix.locationValid = true;
+    fix.locationMillis = now;
+  }
+  double knots;
+  if (parseDecimal(fields[7], knots)) {
+    fix.speedKmph = knots * KMPH_PER_KNOT;
+    fix.speedValid = true;
+  }
+  if (parseDecimal(fields[8], fix.courseDeg))
+    fix.courseValid = true;
+  if (strlen(fields[9]) == 6) {
+    fix.day = (uint8_t)twoDigits(fields[9]);
+    fix.month = (uint8_t)twoDigits(fields[9] + 2);
+    fix.year = (uint16_t)(2000 + twoDigits(fields[9] + 4));
+    fix.dateValid = true;
+  }
+  return true;
+}
+
+// $--VTG,courseT,T,courseM,M,speedKnots,N,speedKmph,K,mode
+bool NmeaParser::decodeVTG(char **fields, int count, GpsFix &fix) {
+  if (count < 9)
+    return false;
+  if (count > 9 && fields[9][0] == 'N')
+    return true; // Mode indicator: data not valid
+
+  if (parseDecimal(fields[1], fix.courseDeg))
+    fix.courseValid = true;
+  if (parseDecimal(fields[7], fix.speedKmph))
+    fix.speedValid = true;
+  return true;
+}
@@ -0,0 +1,216 @@
+#include "payload_codec.h"
+
+#include <string.h>
+
+static_assert(PAYLOAD_CODEC_DICT_MAX + PAYLOAD_CODEC_MAX_INPUT <= 65535,
+              "Window positions must fit in uint16_t");
+static_assert(PAYLOAD_COMPRESS_CHAIN >= 1 && PAYLOAD_COMPRESS_CHAIN <= 255,
+              "PAYLOAD_COMPRESS_CHAIN must be 1..255");
+
+// Stream tokens:
+//   0LLLLLLL                     L + 1 literal bytes follow (1..128)
+//   1LLLLOOO OOOOOOOO            match of L + 3 bytes (3..17) starting
+//                                O + 1 bytes back (1..2048)
+//   1LLLLOOO OOOOOOOO EEEEEEEE   L = 15: match of E + 18 bytes (18..273)
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (18 + 255)
+#define LZ_MAX_LITERALS 128
+
+// Two fixes as FixBatcher writes them; the keys are what repeats
+const char PAYLOAD_DICT1[] =
+    "\"satellites\":10,\"valid\":true,\"timestamp\":1000000}"
+    "{\"latitude\":0.000000,\"longitude\":0.000000,\"altitude\":0.00,"
+    "\"speed\":0.00,\"satellites\":8,\"valid\":true,\"timestamp\":100000},"
+    "[{\"latitude\":";
+const size_t PAYLOAD_DICT1_SIZE = sizeof(PAYLOAD_DICT1) - 1;
+
+static_assert(sizeof(PAYLOAD_DICT1) - 1 <= PAYLOAD_CODEC_DICT_MAX,
+              "Dictionary larger than the space kept for it");
+
+static inline uint32_t hash3(const uint8_t *p) {
+  uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+  return (v * 2654435761u) >> (32 - PAYLOAD_CODEC_HASH_BITS);
+}
+
+PayloadCompressor::PayloadCompressor(uint8_t depth, bool dictionary)
+    : chainDepth(depth ? depth : 1), useDictionary(dictionary) {}
+
+void PayloadCompressor::insert(size_t position) {
+  uint32_t h = hash3(window + position);
+  chain[position] = head[h];
+  head[h] = (uint16_t)(position + 1);
+}
+
+size_t PayloadCompressor::store(const uint8_t *input, size_t length,
+                                uint8_t *out, size_t capacity) const {
+  if (PAYLOAD_CODEC_HEADER + length > capacity)
+    return 0;
+  out[0] = PAYLOAD_STORED;
+  memcpy(out + PAYLOAD_CODEC_HEADER, input, length);
+  return PAYLOAD_CODEC_HEADER + length;
+}
+
+size_t PayloadCompressor::compress(const uint8_t *input, size_t length,
+                                   uint8_t *out, size_t capacity) {
+  if (length > PAYLOAD_CODEC_MAX_INPUT)
+    return store(input, length, out, capacity);
+
+  // Dictionary and input form one window; matches may reach back into it
+  size_t base = useDictionary ? PAYLOAD_DICT1_SIZE : 0;
+  memcpy(window, PAYLOAD_DICT1, base);
+  memcpy(window + base, input, length);
+  size_t end = base + length;
+
+  memset(head, 0, sizeof(head));
+  for (size_t p = 0; p < base && p + LZ_MIN_MATCH <= end; p++) {
+    insert(p);
+  }
+
+  // Whatever does not beat storing the input is not worth finishing
+  if (length == 0 || capacity <= PAYLOAD_CODEC_HEADER)
+    return store(input, length, out, capacity);
+  size_t room = capacity - PAYLOAD_CODEC_HEADER;
+  size_t limit = length - 1 < room ? length - 1 : room;
+  uint8_t *o = out + PAYLOAD_CODEC_HEADER;
+  uint8_t *oEnd = o + limit;
+  size_t literalStart = base;
+  size_t p = base;
+
+  while (p < end) {
+    size_t bestLength = 0;
+    size_t bestOffset = 0;
+    if (p + LZ_MIN_MATCH <= end) {
+      size_t maxLength = end - p < LZ_MAX_MATCH ? end - p : LZ_MAX_MATCH;
+      uint16_t candidate = head[hash3(window + p)];
+      for (uint8_t tries = chainDepth; candidate && tries > 0; tries--) {
+        size_t from = candidate - 1;
+        size_t offset = p - from;
+        if (offset > PAYLOAD_CODEC_MAX_OFFSET)
+          break;
+        size_t n = 0;
+        while (n < maxLength && window[from + n] == window[p + n])
+          n++;
+        if (n > bestLength) {
+          bestLength = n;
+          bestOffset = offset;
+          if (n == maxLength)
+            break;
+        }
+        candidate = chain[from];
+      }
+    }
+
+    if (bestLength < LZ_MIN_MATCH) {
+      if (p + LZ_MIN_MATCH <= end)
+        insert(p);
+      p++;
+      continue;
+    }
+
+    // Literals before the match, in runs of up to LZ_MAX_LITERALS
+    while (literalStart < p) {
+      size_t run = p - literalStart;
+      if (run > LZ_MAX_LITERALS)
+        run = LZ_MAX_LITERALS;
+      if ((size_t)(oEnd - o) < 1 + run)
+        return store(input, length, out, capacity);
+      *o++ = (uint8_t)(run - 1);
+      memcpy(o, window + literalStart, run);
+      o += run;
+      literalStart += run;
+    }
+
+    size_t code = bestLength - LZ_MIN_MATCH;
+    size_t needed = code >= 15 ? 3 : 2;
+    if ((size_t)(oEnd - o) < needed)
+      return store(input, length, out, capacity);
+    size_t offsetCode = bestOffset - 1;
+    *o++ = (uint8_t)(0x80 | ((code >= 15 ? 15 : code) << 3) |
+                     (offsetCode >> 8));
+    *o++ = (uint8_t)offsetCode;
+    if (code >= 15)
+      *o++ = (uint8_t)(code - 15);
+
+    for (size_t i = 0; i < bestLength; i++, p++) {
+      if (p + LZ_MIN_MATCH <= end)
+        insert(p);
+    }
+    literalStart = p;
+  }
+
+  while (literalStart < end) {
+    size_t run = end - literalStart;
+    if (run > LZ_MAX_LITERALS)
+      run = LZ_MAX_LITERALS;
+    if ((size_t)(oEnd - o) < 1 + run)
+      return store(input, length, out, capacity);
+    *o++ = (uint8_t)(run - 1);
+    memcpy(o, window + literalStart, run);
+    o += run;
+    literalStart += run;
+  }
+
+  out[0] = useDictionary ? PAYLOAD_LZ_DICT1 : PAYLOAD_LZ;
+  return o - out;
+}
+
+size_t payloadDecompress(const uint8_t *payload, size_t length, uint8_t *out,
+                         size_t capacity) {
+  if (length < PAYLOAD_CODEC_HEADER)
+    return 0;
+  const uint8_t *in = payload + PAYLOAD_CODEC_HEADER;
+  const uint8_t *inEnd = payload + length;
+
+  const uint8_t *dictionary;
+  size_t dictionarySize;
+  switch (payload[0]) {
+  case PAYLOAD_STORED:
+    if ((size_t)(inEnd - in) > capacity)
+      return 0;
+    memcpy(out, in, inEnd - in);
+    return inEnd - in;
+  case PAYLOAD_LZ:
+    dictionary = nullptr;
+    dictionarySize = 0;
+    break;
+  case PAYLOAD_LZ_DICT1:
+    dictionary = (const uint8_t *)PAYLOAD_DICT1;
+    dictionarySize = PAYLOAD_DICT1_SIZE;
+    break;
+  default:
+    return 0;
+  }
+
+  size_t n = 0;
+  while (in < inEnd) {
+    uint8_t token = *in++;
+    if (!(token & 0x80)) {
+      size_t run = token + 1;
+      if ((size_t)(inEnd - in) < run || capacity - n < run)
+        return 0;
+      memcpy(out + n, in, run);
+      in += run;
+      n += run;
+      continue;
+    }
+
+    if (in == inEnd)
+      return 0;
+    size_t offset = (((token & 0x07) << 8) | *in++) + 1;
+    size_t matchLength = ((token >> 3) & 0x0F) + LZ_MIN_MATCH;
+    if (matchLength == 15 + LZ_MIN_MATCH) {
+      if (in == inEnd)
+        return 0;
+      matchLength += *in++;
+    }
+    if (offset > n + dictionarySize || capacity - n < matchLength)
+      return 0;
+
+    // Byte by byte: a match may overlap the bytes it produces
+    for (size_t i = 0; i < matchLength; i++, n++) {
+      out[n] = offset > n ? dictionary[dictionarySize - (offset - n)]
+                          : out[n - offset];
+    }
+  }
+  return n;
+}
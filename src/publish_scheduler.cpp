@@ -0,0 +1,130 @@
+#include "publish_scheduler.h"
+#include "geo.h"
+
+const char *publishReasonName(PublishReason reason) {
+  switch (reason) {
+  case PUBLISH_FIRST:
+    return "first";
+  case PUBLISH_INTERVAL:
+    return "interval";
+  case PUBLISH_DISTANCE:
+    return "distance";
+  case PUBLISH_HEADING:
+    return "heading";
+  case PUBLISH_STARTED:
+    return "started";
+  case PUBLISH_STOPPED:
+    return "stopped";
+  case PUBLISH_HEARTBEAT:
+    return "heartbeat";
+  default:
+    return "none";
+  }
+}
+
+PublishScheduler::PublishScheduler()
+    : hasReport(false), moving(false), lastLatitude(0), lastLongitude(0),
+      lastCourse(0), lastReportTime(0), slowSince(0) {}
+
+PublishReason PublishScheduler::update(const GpsFix &fix, unsigned long now) {
+  PublishReason reason = evaluate(fix, now);
+  if (reason == PUBLISH_NONE)
+    return reason;
+
+  markReported(fix, now);
+  if (reason == PUBLISH_FIRST)
+    moving = fix.speedValid && fix.speedKmph >= PUBLISH_STATIONARY_KMH;
+  else if (reason == PUBLISH_STARTED)
+    moving = true;
+  else if (reason == PUBLISH_STOPPED)
+    moving = false;
+  return reason;
+}
+
+void PublishScheduler::markReported(const GpsFix &fix, unsigned long now) {
+  hasReport = true;
+  lastLatitude = fix.latitude;
+  lastLongitude = fix.longitude;
+  lastCourse = fix.courseValid ? fix.courseDeg : lastCourse;
+  lastReportTime = now;
+}
+
+void PublishScheduler::restoreParked(double latitude, double longitude,
+                                     unsigned long reportTime) {
+  hasReport = true;
+  moving = false;
+  lastLatitude = latitude;
+  lastLongitude = longitude;
+  lastReportTime = reportTime;
+  slowSince = 0;
+}
+
+unsigned long PublishScheduler::nextFixDeadline() const {
+#if PUBLISH_POLICY == PUBLISH_POLICY_FIXED
+  return hasReport ? lastReportTime + GPS_UPDATE_INTERVAL : 0;
+#elif PUBLISH_POLICY == PUBLISH_POLICY_DISTANCE
+  return 0; // Any fix may be the one that crossed the distance
+#else
+  if (!hasReport || moving)
+    return 0;
+  return lastReportTime + PUBLISH_PARKED_INTERVAL_MS;
+#endif
+}
+
+PublishReason PublishScheduler::evaluate(const GpsFix &fix,
+                                         unsigned long now) {
+  if (!hasReport)
+    return PUBLISH_FIRST;
+
+  unsigned long elapsed = now - lastReportTime;
+
+#if PUBLISH_POLICY == PUBLISH_POLICY_FIXED
+  return elapsed >= GPS_UPDATE_INTERVAL ? PUBLISH_INTERVAL : PUBLISH_NONE;
+#else
+  if (elapsed < PUBLISH_MIN_INTERVAL_MS)
+    return PUBLISH_NONE;
+
+  double distance = geoDistanceMeters(lastLatitude, lastLongitude,
+                                      fix.latitude, fix.longitude);
+
+#if PUBLISH_POLICY == PUBLISH_POLICY_DISTANCE
+  if (distance >= PUBLISH_DISTANCE_M)
+    return PUBLISH_DISTANCE;
+  if (elapsed >= PUBLISH_PARKED_INTERVAL_MS)
+    return PUBLISH_HEARTBEAT;
+  return PUBLISH_NONE;
+#else
+  double speed = fix.speedValid ? fix.speedKmph : 0.0;
+  if (speed < PUBLISH_STATIONARY_KMH) {
+    if (slowSince == 0)
+      slowSince = now | 1; // Never 0 once set
+  } else {
+    slowSince = 0;
+  }
+
+  if (!moving) {
+    // Position wander while parked stays inside the dead-band; speed alone
+    // is too noisy to call a start
+    if (distance > PUBLISH_DEADBAND_M)
+      return PUBLISH_STARTED;
+    if (elapsed >= PUBLISH_PARKED_INTERVAL_MS)
+      return PUBLISH_HEARTBEAT;
+    return PUBLISH_NONE;
+  }
+
+  if (slowSince != 0 && now - slowSince >= PUBLISH_STOP_DWELL_MS)
+    return PUBLISH_STOPPED;
+#if !TRACK_SIMPLIFY_ENABLED
+  // Otherwise the track simplifier decides where the shape needs a point
+  if (distance >= PUBLISH_DISTANCE_M)
+    return PUBLISH_DISTANCE;
+  if (fix.courseValid && speed >= PUBLISH_CORNER_MIN_KMH &&
+      geoHeadingDelta(lastCourse, fix.courseDeg) >= PUBLISH_HEADING_DEG)
+    return PUBLISH_HEADING;
+#endif
+  if (elapsed >= PUBLISH_MAX_INTERVAL_MS)
+    return PUBLISH_INTERVAL;
+  return PUBLISH_NONE;
+#endif
+#endif
+}
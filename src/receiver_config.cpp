@@ -0,0 +1,129 @@
+#include "receiver_config.h"
+
+#include <string.h>
+
+static_assert(GPS_MEASUREMENT_RATE_MS >= RECEIVER_RATE_MIN_MS &&
+                  GPS_MEASUREMENT_RATE_MS <= RECEIVER_RATE_MAX_MS,
+              "GPS_MEASUREMENT_RATE_MS out of range");
+
+namespace {
+
+struct ModelName {
+  uint8_t model;
+  const char *name;
+};
+
+const ModelName MODEL_NAMES[] = {
+    {GPS_MODEL_PORTABLE, "portable"},
+    {GPS_MODEL_STATIONARY, "stationary"},
+    {GPS_MODEL_PEDESTRIAN, "pedestrian"},
+    {GPS_MODEL_AUTOMOTIVE, "automotive"},
+};
+
+// Start of the value of member name in a flat JSON object, or nullptr
+const char *findMember(const char *json, const char *end, const char *name) {
+  size_t nameLength = strlen(name);
+  for (const char *p = json; p + nameLength + 2 <= end; p++) {
+    if (*p != '"' || p[nameLength + 1] != '"' ||
+        memcmp(p + 1, name, nameLength) != 0)
+      continue;
+    p += nameLength + 2;
+    while (p < end && (*p == ' ' || *p == ':'))
+      p++;
+    return p < end ? p : nullptr;
+  }
+  return nullptr;
+}
+
+// Quoted string value into text; false if not a string or too long
+bool readString(const char *value, const char *end, char *text,
+                size_t capacity) {
+  if (*value != '"')
+    return false;
+  size_t length = 0;
+  for (const char *p = value + 1; p < end; p++) {
+    if (*p == '"') {
+      text[length] = '\0';
+      return true;
+    }
+    if (length + 1 >= capacity)
+      return false;
+    text[length++] = *p;
+  }
+  return false;
+}
+
+// Unsigned integer value; false if not a number
+bool readNumber(const char *value, const char *end, unsigned long &number) {
+  if (value >= end || *value < '0' || *value > '9')
+    return false;
+  number = 0;
+  for (const char *p = value; p < end && *p >= '0' && *p <= '9'; p++) {
+    number = number * 10 + (*p - '0');
+    if (number > 0xFFFF)
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+ReceiverConfig ReceiverConfig::defaults() {
+  return {GPS_MEASUREMENT_RATE_MS, GPS_DYNAMIC_MODEL, GPS_MINIMAL_MESSAGES};
+}
+
+const char *receiverModelName(uint8_t model) {
+  for (const ModelName &entry : MODEL_NAMES) {
+    if (entry.model == model)
+      return entry.name;
+  }
+  return nullptr;
+}
+
+bool parseReceiverCommand(const char *payload, size_t length,
+                          ReceiverConfig &config) {
+  const char *end = payload + length;
+  ReceiverConfig updated = config;
+  bool found = false;
+  char text[16];
+
+  if (const char *value = findMember(payload, end, "gps_rate_ms")) {
+    unsigned long rate;
+    if (!readNumber(value, end, rate) || rate < RECEIVER_RATE_MIN_MS ||
+        rate > RECEIVER_RATE_MAX_MS)
+      return false;
+    updated.measurementRateMs = (uint16_t)rate;
+    found = true;
+  }
+
+  if (const char *value = findMember(payload, end, "gps_model")) {
+    if (!readString(value, end, text, sizeof(text)))
+      return false;
+    bool known = false;
+    for (const ModelName &entry : MODEL_NAMES) {
+      if (!strcmp(text, entry.name)) {
+        updated.dynamicModel = entry.model;
+        known = true;
+      }
+    }
+    if (!known)
+      return false;
+    found = true;
+  }
+
+  if (const char *value = findMember(payload, end, "gps_messages")) {
+    if (!readString(value, end, text, sizeof(text)))
+      return false;
+    if (!strcmp(text, "minimal"))
+      updated.minimalMessages = true;
+    else if (!strcmp(text, "full"))
+      updated.minimalMessages = false;
+    else
+      return false;
+    found = true;
+  }
+
+  if (found)
+    config = updated;
+  return found;
+}
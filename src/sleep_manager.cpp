@@ -0,0 +1,194 @@
+#include "sleep_manager.h"
+
+#include <esp_attr.h>
+#include <esp_sleep.h>
+#include <esp_system.h>
+#include <math.h>
+#include <string.h>
+#include <sys/time.h>
+
+static_assert(GPS_PARKED_CHECK_MS < MQTT_KEEPALIVE_S * 1000UL,
+              "A light sleep must not outlast the MQTT keep-alive");
+static_assert(SLEEP_LIGHT_MIN_MS <= SLEEP_DEEP_MIN_MS,
+              "Gaps too short for light sleep cannot allow deep sleep");
+
+// Not initialized by the bootloader, so it also survives resets that are
+// not deep sleep wake-ups; the magic number tells whether it is valid
+static RTC_NOINIT_ATTR RetainedState retainedState;
+
+// The system time keeps counting through deep sleep and resets other than
+// power-up (RTC timer); millis() does not
+static uint64_t rtcClockMs() {
+  struct timeval now;
+  gettimeofday(&now, nullptr);
+  return (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+const char *sleepModeName(SleepMode mode) {
+  switch (mode) {
+  case SLEEP_LIGHT:
+    return "light";
+  case SLEEP_DEEP:
+    return "deep";
+  default:
+    return "none";
+  }
+}
+
+SleepManager::SleepManager()
+    : parkedSince(0), resetReason(ESP_RST_UNKNOWN), warm(false),
+      resumed(false), sleptMs(0), sleepStart(0), lightSleeps(0),
+      lightSleepMs(0) {}
+
+void SleepManager::begin() {
+  esp_reset_reason_t reason = esp_reset_reason();
+  resetReason = (uint8_t)reason;
+  warm = reason == ESP_RST_DEEPSLEEP || reason == ESP_RST_SW ||
+         reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT ||
+         reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT;
+
+  // Power-up leaves RTC memory undefined; a brown-out may have corrupted it
+  if (!warm || retainedState.magic != RETAINED_STATE_MAGIC) {
+    memset(&retainedState, 0, sizeof(retainedState));
+    retainedState.magic = RETAINED_STATE_MAGIC;
+  }
+
+  esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  resumed = reason == ESP_RST_DEEPSLEEP && retainedState.sleepStartMs != 0 &&
+            (cause == ESP_SLEEP_WAKEUP_TIMER || cause == ESP_SLEEP_WAKEUP_EXT0);
+  if (!resumed)
+    return;
+
+  sleptMs = (unsigned long)(rtcClockMs() - retainedState.sleepStartMs);
+  sleepStart = millis() - sleptMs;
+  parkedSince = (sleepStart - retainedState.parkedMs) | 1;
+
+  DEBUG_PRINT("Woke from deep sleep after ");
+  DEBUG_PRINT(sleptMs / 1000);
+  DEBUG_PRINTLN(cause == ESP_SLEEP_WAKEUP_EXT0 ? " s (wake pin)" : " s");
+}
+
+RetainedState &SleepManager::retained() { return retainedState; }
+
+const char *SleepManager::getResetReasonName() const {
+  switch (resetReason) {
+  case ESP_RST_POWERON:
+    return "power_on";
+  case ESP_RST_EXT:
+    return "external";
+  case ESP_RST_SW:
+    return "software";
+  case ESP_RST_PANIC:
+    return "panic";
+  case ESP_RST_INT_WDT:
+  case ESP_RST_TASK_WDT:
+  case ESP_RST_WDT:
+    return "watchdog";
+  case ESP_RST_DEEPSLEEP:
+    return "deep_sleep";
+  case ESP_RST_BROWNOUT:
+    return "brownout";
+  default:
+    return "unknown";
+  }
+}
+
+void SleepManager::recordFix(const GpsFix &fix, bool parked) {
+  retainedState.fixValid = fix.locationValid;
+  retainedState.fixParked = parked;
+  retainedState.fixLatitudeE7 = (int32_t)lround(fix.latitude * 1e7);
+  retainedState.fixLongitudeE7 = (int32_t)lround(fix.longitude * 1e7);
+  retainedState.fixAltitudeDm =
+      fix.altitudeValid ? (int32_t)lround(fix.altitude * 10) : 0;
+  retainedState.fixUtcSeconds = fix.utcSeconds();
+  retainedState.fixClockMs = rtcClockMs();
+}
+
+bool SleepManager::hasRetainedFix() const { return retainedState.fixValid; }
+
+unsigned long SleepManager::getRetainedFixAgeMs() const {
+  return (unsigned long)(rtcClockMs() - retainedState.fixClockMs);
+}
+
+unsigned long SleepManager::getDeepSleeps() const {
+  return retainedState.deepSleeps;
+}
+
+void SleepManager::update(bool parked, unsigned long now) {
+  if (!parked)
+    parkedSince = 0;
+  else if (parkedSince == 0)
+    parkedSince = now | 1; // Never 0 once set
+}
+
+bool SleepManager::isLongParked(unsigned long now) const {
+  return parkedSince != 0 && now - parkedSince >= SLEEP_DEEP_AFTER_MS;
+}
+
+unsigned long SleepManager::getParkedCheckInterval(unsigned long now) const {
+#if SLEEP_ENABLED
+  if (isLongParked(now))
+    return SLEEP_DEEP_CHECK_MS;
+#else
+  (void)now;
+#endif
+  return GPS_PARKED_CHECK_MS;
+}
+
+SleepMode SleepManager::plan(unsigned long now, unsigned long wakeAt) const {
+#if SLEEP_ENABLED
+  long gap = (long)(wakeAt - now);
+  if (parkedSince == 0 || gap < SLEEP_LIGHT_MIN_MS)
+    return SLEEP_NONE;
+  if (gap >= SLEEP_DEEP_MIN_MS && isLongParked(now))
+    return SLEEP_DEEP;
+  return SLEEP_LIGHT;
+#else
+  (void)now;
+  (void)wakeAt;
+  return SLEEP_NONE;
+#endif
+}
+
+void SleepManager::armWakeSources(unsigned long durationMs) {
+  esp_sleep_enable_timer_wakeup((uint64_t)durationMs * 1000);
+#if SLEEP_WAKE_PIN >= 0
+  // Movement sensor or similar: wake before the timer
+  esp_sleep_enable_ext0_wakeup((gpio_num_t)SLEEP_WAKE_PIN, SLEEP_WAKE_LEVEL);
+#endif
+}
+
+unsigned long SleepManager::lightSleep(unsigned long durationMs) {
+  DEBUG_PRINT("Light sleep for ");
+  DEBUG_PRINT(durationMs / 1000);
+  DEBUG_PRINTLN(" s");
+  DEBUG_SERIAL.flush();
+
+  armWakeSources(durationMs);
+  unsigned long start = millis();
+  esp_light_sleep_start();
+  unsigned long slept = millis() - start;
+
+  lightSleeps++;
+  lightSleepMs += slept;
+  if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT0) {
+    DEBUG_PRINTLN("Woken by wake pin");
+  }
+  return slept;
+}
+
+void SleepManager::deepSleep(unsigned long durationMs) {
+  unsigned long now = millis();
+  retainedState.magic = RETAINED_STATE_MAGIC;
+  retainedState.deepSleeps++;
+  retainedState.parkedMs = parkedSince ? now - parkedSince : 0;
+  retainedState.sleepStartMs = rtcClockMs();
+
+  DEBUG_PRINT("Deep sleep for ");
+  DEBUG_PRINT(durationMs / 1000);
+  DEBUG_PRINTLN(" s");
+  DEBUG_SERIAL.flush();
+
+  armWakeSources(durationMs);
+  esp_deep_sleep_start();
+}
@@ -0,0 +1,84 @@
+#include "track_simplifier.h"
+#include "geo.h"
+
+#include <math.h>
+
+static_assert(TRACK_WINDOW_SIZE >= 2 && TRACK_WINDOW_SIZE <= 1024,
+              "TRACK_WINDOW_SIZE out of range");
+
+// Squared distance from p to the segment a-b
+static float segmentDistanceSq(float px, float py, float ax, float ay,
+                               float bx, float by) {
+  float dx = bx - ax;
+  float dy = by - ay;
+  float lengthSq = dx * dx + dy * dy;
+  float t = 0.0f;
+  if (lengthSq > 0.0f) {
+    t = ((px - ax) * dx + (py - ay) * dy) / lengthSq;
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+  }
+  float ex = ax + t * dx - px;
+  float ey = ay + t * dy - py;
+  return ex * ex + ey * ey;
+}
+
+TrackSimplifier::TrackSimplifier(float toleranceMeters)
+    : count(0), toleranceSq(toleranceMeters * toleranceMeters),
+      hasAnchor(false), anchorLatitude(0), anchorLongitude(0),
+      metersPerDegreeLon(0), candidate(), candidateTime(0) {}
+
+TrackSimplifier::Point TrackSimplifier::project(const GpsFix &fix) const {
+  const double metersPerDegreeLat = GEO_EARTH_RADIUS_M * GEO_DEG_TO_RAD;
+  Point p;
+  p.x = (float)((fix.longitude - anchorLongitude) * metersPerDegreeLon);
+  p.y = (float)((fix.latitude - anchorLatitude) * metersPerDegreeLat);
+  return p;
+}
+
+void TrackSimplifier::setAnchor(const GpsFix &fix) {
+  hasAnchor = true;
+  anchorLatitude = fix.latitude;
+  anchorLongitude = fix.longitude;
+  metersPerDegreeLon = GEO_EARTH_RADIUS_M * GEO_DEG_TO_RAD *
+                       cos(fix.latitude * GEO_DEG_TO_RAD);
+  count = 0;
+}
+
+bool TrackSimplifier::add(const GpsFix &fix, unsigned long timestamp,
+                          GpsFix &keyFix, unsigned long &keyTime) {
+  if (!hasAnchor) {
+    setAnchor(fix);
+    return false;
+  }
+
+  Point p = project(fix);
+
+  // The anchor is at the origin
+  bool broken = count >= TRACK_WINDOW_SIZE;
+  for (uint16_t i = 0; i < count && !broken; i++) {
+    broken = segmentDistanceSq(window[i].x, window[i].y, 0.0f, 0.0f, p.x,
+                               p.y) > toleranceSq;
+  }
+
+  if (!broken) {
+    window[count++] = p;
+    candidate = fix;
+    candidateTime = timestamp;
+    return false;
+  }
+
+  keyFix = candidate;
+  keyTime = candidateTime;
+  setAnchor(candidate);
+  window[count++] = project(fix);
+  candidate = fix;
+  candidateTime = timestamp;
+  return true;
+}
+
+void TrackSimplifier::reset(const GpsFix &fix) { setAnchor(fix); }
+
+void TrackSimplifier::clear() {
+  hasAnchor = false;
+  count = 0;
+}
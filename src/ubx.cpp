@@ -0,0 +1,27 @@
+#include "ubx.h"
+
+void ubxChecksum(const uint8_t *data, size_t length, uint8_t &ckA,
+                 uint8_t &ckB) {
+  for (size_t i = 0; i < length; i++) {
+    ckA += data[i];
+    ckB += ckA;
+  }
+}
+
+size_t ubxSend(Print &port, uint8_t messageClass, uint8_t messageId,
+               const uint8_t *payload, uint16_t length) {
+  uint8_t header[UBX_HEADER_SIZE] = {UBX_SYNC_1, UBX_SYNC_2, messageClass,
+                                     messageId, 0, 0};
+  ubxPutU16(header + 4, length);
+
+  // The checksum skips the two sync bytes
+  uint8_t checksum[2] = {0, 0};
+  ubxChecksum(header + 2, UBX_HEADER_SIZE - 2, checksum[0], checksum[1]);
+  ubxChecksum(payload, length, checksum[0], checksum[1]);
+
+  size_t written = port.write(header, sizeof(header));
+  if (length > 0)
+    written += port.write(payload, length);
+  written += port.write(checksum, sizeof(checksum));
+  return written;
+}
@@ -0,0 +1,177 @@
+#include "ubx_parser.h"
+
+#include <string.h>
+
+#define EPOCH_POSITION 0x01
+#define EPOCH_SOLUTION 0x02
+#define EPOCH_VELOCITY 0x04
+
+UbxParser::UbxParser()
+    : length(0), epochTow(0), epochSeen(0), epochFixOk(false),
+      epochFix3D(false), ackPending(false), ackPositive(false), ackClass(0),
+      ackId(0), bytesProcessed(0), framesParsed(0), framesIgnored(0),
+      checksumFailures(0), droppedBytes(0) {}
+
+uint8_t *UbxParser::writeSpace(size_t &space) {
+  space = sizeof(buffer) - length;
+  return buffer + length;
+}
+
+void UbxParser::commit(size_t count) { length += count; }
+
+bool UbxParser::takeAck(uint8_t messageClass, uint8_t messageId,
+                        bool &acknowledged) {
+  if (!ackPending || ackClass != messageClass || ackId != messageId)
+    return false;
+  ackPending = false;
+  acknowledged = ackPositive;
+  return true;
+}
+
+void UbxParser::process(GpsFix &fix, unsigned long now) {
+  size_t pos = 0;
+  while (pos < length) {
+    size_t available = length - pos;
+    const uint8_t *frame = buffer + pos;
+
+    // Resynchronize on the two sync bytes (skips NMEA and line noise)
+    if (frame[0] != UBX_SYNC_1 || (available >= 2 && frame[1] != UBX_SYNC_2)) {
+      pos++;
+      continue;
+    }
+    if (available < UBX_HEADER_SIZE)
+      break;
+
+    uint16_t payloadLength = frame[4] | frame[5] << 8;
+    if (payloadLength > UBX_MAX_PAYLOAD) {
+      // Not a message we enable; find the next frame inside it
+      framesIgnored++;
+      pos++;
+      continue;
+    }
+    size_t frameLength = payloadLength + UBX_FRAME_OVERHEAD;
+    if (available < frameLength)
+      break;
+
+    uint8_t ckA = 0, ckB = 0;
+    ubxChecksum(frame + 2, payloadLength + 4, ckA, ckB);
+    if (ckA != frame[frameLength - 2] || ckB != frame[frameLength - 1]) {
+      checksumFailures++;
+      pos++;
+      continue;
+    }
+
+    handleFrame(frame[2], frame[3], frame + UBX_HEADER_SIZE, payloadLength,
+                fix, now);
+    pos += frameLength;
+  }
+
+  bytesProcessed += pos;
+  length -= pos;
+  if (length == sizeof(buffer)) {
+    // Cannot happen with valid input (frames fit); start over
+    droppedBytes += length;
+    length = 0;
+  } else if (pos > 0 && length > 0) {
+    memmove(buffer, buffer + pos, length);
+  }
+}
+
+void UbxParser::beginEpoch(uint32_t tow, GpsFix &fix, unsigned long now) {
+  if (epochSeen && tow != epochTow)
+    commitEpoch(fix, now); // Previous epoch ended without NAV-TIMEUTC
+  epochTow = tow;
+}
+
+void UbxParser::commitEpoch(GpsFix &fix, unsigned long now) {
+  // Fix quality only counts from this epoch's NAV-SOL; if that frame was
+  // lost the epoch is not trusted
+  bool solved = epochFixOk && (epochSeen & EPOCH_SOLUTION);
+  bool hasPosition = solved && (epochSeen & EPOCH_POSITION);
+  bool hasVelocity = solved && (epochSeen & EPOCH_VELOCITY);
+  fix.locationValid = hasPosition;
+  fix.altitudeValid = hasPosition && epochFix3D;
+  fix.speedValid = hasVelocity;
+  fix.courseValid = hasVelocity;
+  if (hasPosition)
+    fix.locationMillis = now;
+  epochSeen = 0;
+  epochFixOk = false;
+  epochFix3D = false;
+}
+
+void UbxParser::handleFrame(uint8_t messageClass, uint8_t messageId,
+                            const uint8_t *payload, uint16_t payloadLength,
+                            GpsFix &fix, unsigned long now) {
+  framesParsed++;
+
+  if (messageClass == UBX_CLASS_ACK && payloadLength == 2) {
+    ackPending = true;
+    ackPositive = messageId == UBX_ACK_ACK;
+    ackClass = payload[0];
+    ackId = payload[1];
+    return;
+  }
+  if (messageClass != UBX_CLASS_NAV) {
+    framesIgnored++;
+    return;
+  }
+
+  switch (messageId) {
+  case UBX_NAV_POSLLH: {
+    if (payloadLength != sizeof(UbxNavPosllh))
+      break;
+    const UbxNavPosllh *pos = (const UbxNavPosllh *)payload;
+    beginEpoch(pos->iTOW, fix, now);
+    fix.latitude = pos->lat * 1e-7;
+    fix.longitude = pos->lon * 1e-7;
+    fix.altitude = pos->hMSL / 1000.0;
+    epochSeen |= EPOCH_POSITION;
+    return;
+  }
+  case UBX_NAV_SOL: {
+    if (payloadLength != sizeof(UbxNavSol))
+      break;
+    const UbxNavSol *sol = (const UbxNavSol *)payload;
+    beginEpoch(sol->iTOW, fix, now);
+    epochFixOk = (sol->flags & UBX_SOL_FIX_OK) && sol->gpsFix >= 2 &&
+                 sol->gpsFix <= 4;
+    epochFix3D = sol->gpsFix == 3 || sol->gpsFix == 4;
+    fix.satellites = sol->numSV;
+    fix.satellitesValid = true;
+    epochSeen |= EPOCH_SOLUTION;
+    return;
+  }
+  case UBX_NAV_VELNED: {
+    if (payloadLength != sizeof(UbxNavVelned))
+      break;
+    const UbxNavVelned *vel = (const UbxNavVelned *)payload;
+    beginEpoch(vel->iTOW, fix, now);
+    fix.speedKmph = vel->gSpeed * 0.036; // cm/s to km/h
+    fix.courseDeg = vel->heading * 1e-5;
+    epochSeen |= EPOCH_VELOCITY;
+    return;
+  }
+  case UBX_NAV_TIMEUTC: {
+    if (payloadLength != sizeof(UbxNavTimeutc))
+      break;
+    const UbxNavTimeutc *utc = (const UbxNavTimeutc *)payload;
+    beginEpoch(utc->iTOW, fix, now);
+    if (utc->valid & UBX_TIMEUTC_VALID_UTC) {
+      fix.year = utc->year;
+      fix.month = utc->month;
+      fix.day = utc->day;
+      fix.hour = utc->hour;
+      fix.minute = utc->min;
+      fix.second = utc->sec;
+      fix.centisecond = utc->nano > 0 ? (uint8_t)(utc->nano / 10000000) : 0;
+      fix.dateValid = true;
+      fix.timeValid = true;
+    }
+    // Highest message ID: last of the epoch
+    commitEpoch(fix, now);
+    return;
+  }
+  }
+  framesIgnored++;
+}
@@ -0,0 +1,166 @@
+// FixJournal against the host flash stand-in (NOR semantics, 4 KB
+// sectors). Run with
+//   pio test -e test_host
+
+#include <string.h>
+#include <unity.h>
+
+#include "Arduino.h"
+#include "esp_partition.h"
+#include "fix_journal.h"
+
+#define TEST_SECTORS 4
+#define TEST_RECORDS_PER_SECTOR (SPI_FLASH_SEC_SIZE / sizeof(JournalRecord))
+
+static const esp_partition_t *partition;
+
+static GpsFix fixNumber(int n) {
+  GpsFix fix = {};
+  fix.latitude = 36.8 + n * 1e-5;
+  fix.longitude = 10.18;
+  fix.locationValid = true;
+  fix.satellites = 8;
+  return fix;
+}
+
+static void appendFixes(FixJournal &journal, int count) {
+  for (int i = 0; i < count; i++) {
+    TEST_ASSERT_TRUE(journal.append(fixNumber(i)));
+  }
+}
+
+// Replays the journal as drainJournal() does; returns how many records
+// came out in sequence order starting at firstSequence
+static uint32_t drain(FixJournal &journal, uint32_t firstSequence) {
+  uint32_t delivered = 0;
+  JournalRecord record;
+  while (journal.peek(record)) {
+    if (record.sequence != firstSequence + delivered ||
+        !journal.markSent(record))
+      break;
+    delivered++;
+  }
+  return delivered;
+}
+
+void setUp() {
+  if (!partition) {
+    hostflash::addPartition(JOURNAL_PARTITION_LABEL,
+                            TEST_SECTORS * SPI_FLASH_SEC_SIZE);
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         ESP_PARTITION_SUBTYPE_ANY,
+                                         JOURNAL_PARTITION_LABEL);
+  }
+  esp_partition_erase_range(partition, 0, partition->size);
+}
+
+void tearDown() {}
+
+static void test_drain_after_reboot() {
+  FixJournal journal;
+  TEST_ASSERT_TRUE(journal.begin());
+  appendFixes(journal, 5);
+  JournalRecord record;
+  TEST_ASSERT_TRUE(journal.peek(record));
+  TEST_ASSERT_TRUE(journal.markSent(record));
+
+  FixJournal rebooted;
+  TEST_ASSERT_TRUE(rebooted.begin());
+  TEST_ASSERT_EQUAL_UINT32(4, rebooted.getPending());
+  TEST_ASSERT_EQUAL_UINT32(4, drain(rebooted, 2));
+  TEST_ASSERT_EQUAL_UINT32(0, rebooted.getPending());
+}
+
+static void test_torn_write_then_drain() {
+  FixJournal journal;
+  TEST_ASSERT_TRUE(journal.begin());
+  appendFixes(journal, 10);
+
+  // Reset in the middle of the eleventh append: header written, the rest
+  // of the record still erased
+  JournalRecord torn;
+  memset(&torn, 0xFF, sizeof(torn));
+  torn.magic = JOURNAL_MAGIC;
+  torn.state = JOURNAL_STATE_PENDING;
+  torn.sequence = 11;
+  TEST_ASSERT_EQUAL(ESP_OK, esp_partition_write(partition,
+                                                10 * sizeof(JournalRecord),
+                                                &torn, 8));
+
+  // The rest of the first sector is left unused; appends go on in the next
+  FixJournal rebooted;
+  TEST_ASSERT_TRUE(rebooted.begin());
+  TEST_ASSERT_EQUAL_UINT32(10, rebooted.getPending());
+  TEST_ASSERT_EQUAL_UINT32(TEST_RECORDS_PER_SECTOR,
+                           rebooted.getCursor().headIndex);
+  appendFixes(rebooted, 3);
+  TEST_ASSERT_EQUAL_UINT32(13, rebooted.getPending());
+
+  // Every record comes out, in order, across the unused slots
+  TEST_ASSERT_EQUAL_UINT32(13, drain(rebooted, 1));
+  TEST_ASSERT_EQUAL_UINT32(0, rebooted.getPending());
+  TEST_ASSERT_EQUAL_UINT32(0, rebooted.getOverwritten());
+}
+
+static void test_torn_sector_reused_when_full() {
+  FixJournal journal;
+  TEST_ASSERT_TRUE(journal.begin());
+  appendFixes(journal, 10);
+  JournalRecord torn;
+  memset(&torn, 0xFF, sizeof(torn));
+  torn.magic = JOURNAL_MAGIC;
+  TEST_ASSERT_EQUAL(ESP_OK, esp_partition_write(partition,
+                                                10 * sizeof(JournalRecord),
+                                                &torn, 4));
+
+  // Offline long enough to wrap into the first sector again: its ten
+  // records are lost, the unused slots are not counted as records
+  FixJournal rebooted;
+  TEST_ASSERT_TRUE(rebooted.begin());
+  uint32_t appended = (TEST_SECTORS - 1) * TEST_RECORDS_PER_SECTOR + 1;
+  appendFixes(rebooted, appended);
+  TEST_ASSERT_EQUAL_UINT32(10, rebooted.getOverwritten());
+  TEST_ASSERT_EQUAL_UINT32(appended, rebooted.getPending());
+  TEST_ASSERT_EQUAL_UINT32(appended, drain(rebooted, 11));
+}
+
+static void test_peek_ahead_across_torn_slot() {
+  FixJournal journal;
+  TEST_ASSERT_TRUE(journal.begin());
+  appendFixes(journal, 10);
+  JournalRecord torn;
+  memset(&torn, 0xFF, sizeof(torn));
+  torn.magic = JOURNAL_MAGIC;
+  TEST_ASSERT_EQUAL(ESP_OK, esp_partition_write(partition,
+                                                10 * sizeof(JournalRecord),
+                                                &torn, 4));
+  FixJournal rebooted;
+  TEST_ASSERT_TRUE(rebooted.begin());
+  appendFixes(rebooted, 3);
+
+  // Sent ahead of the oldest record, confirmed later, in order
+  JournalRecord record;
+  for (uint32_t sequence = 1; sequence <= 13; sequence++) {
+    TEST_ASSERT_TRUE(rebooted.peek(sequence, record));
+    TEST_ASSERT_EQUAL_UINT32(sequence, record.sequence);
+  }
+  TEST_ASSERT_TRUE(!rebooted.peek(14, record));
+  TEST_ASSERT_EQUAL_UINT32(13, rebooted.getPending());
+
+  TEST_ASSERT_TRUE(rebooted.peek(record));
+  TEST_ASSERT_TRUE(rebooted.markSent(record));
+  TEST_ASSERT_TRUE(!rebooted.peek(1, record));
+  TEST_ASSERT_TRUE(rebooted.peek(12, record));
+  TEST_ASSERT_EQUAL_UINT32(12, record.sequence);
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_drain_after_reboot);
+  RUN_TEST(test_torn_write_then_drain);
+  RUN_TEST(test_torn_sector_reused_when_full);
+  RUN_TEST(test_peek_ahead_across_torn_slot);
+  return UNITY_END();
+}
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Decoder for GPSB binary location payloads (docs/BINARY_FORMAT.md).
+
+Library use:
+    from gpsb_decode import decode
+    fixes = decode(payload)  # list of dicts, oldest first
+
+Command line (raw payload file, or hex with --hex):
+    mosquitto_sub -t gps/location/bin -C 1 > msg.bin
+    python3 tools/gpsb_decode.py msg.bin
+    echo 01 02 ... | python3 tools/gpsb_decode.py --hex -
+"""
+
+import argparse
+import json
+import sys
+
+VERSION = 1
+UTC_EPOCH_OFFSET = 946684800  # 2000-01-01T00:00:00Z as Unix time
+
+
+class DecodeError(ValueError):
+    pass
+
+
+class _Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            if self.pos >= len(self.data):
+                raise DecodeError("truncated varint at offset %d" % self.pos)
+            byte = self.data[self.pos]
+            self.pos += 1
+            value |= (byte & 0x7F) << shift
+            if byte < 0x80:
+                return value
+            shift += 7
+            if shift > 63:
+                raise DecodeError("varint too long at offset %d" % self.pos)
+
+    def signed(self):
+        raw = self.varint()
+        return (raw >> 1) ^ -(raw & 1)
+
+
+def decode(payload):
+    """Decode one GPSB payload into a list of fix dicts."""
+    reader = _Reader(bytes(payload))
+    if not payload:
+        raise DecodeError("empty payload")
+    version = reader.data[0]
+    reader.pos = 1
+    if version != VERSION:
+        raise DecodeError("unsupported version %d" % version)
+
+    count = reader.varint()
+    timestamp = reader.varint()
+    base_utc = reader.varint()
+
+    lat = lon = alt = speed = course = sats = 0
+    fixes = []
+    for _ in range(count):
+        timestamp += reader.varint()
+        lat += reader.signed()
+        lon += reader.signed()
+        alt += reader.signed()
+        speed += reader.signed()
+        course = (course + reader.signed()) % 36000
+        sats += reader.signed()
+        fixes.append({
+            "latitude": lat / 1e7,
+            "longitude": lon / 1e7,
+            "altitude": alt / 10.0,
+            "speed": speed / 100.0,
+            "course": course / 100.0,
+            "satellites": sats,
+            "timestamp": timestamp,
+        })
+
+    if reader.pos != len(reader.data):
+        raise DecodeError("%d trailing bytes" % (len(reader.data) - reader.pos))
+
+    # Only the first fix carries wall-clock time; later ones are derived
+    # from the millis() offsets
+    if base_utc and fixes:
+        base_ms = fixes[0]["timestamp"]
+        for fix in fixes:
+            offset = (fix["timestamp"] - base_ms) / 1000.0
+            fix["utc"] = UTC_EPOCH_OFFSET + base_utc + offset
+    return fixes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="payload file, or - for stdin")
+    parser.add_argument("--hex", action="store_true",
+                        help="input is hex text instead of raw bytes")
+    args = parser.parse_args()
+
+    if args.input == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.input, "rb") as f:
+            data = f.read()
+    if args.hex:
+        data = bytes.fromhex(data.decode("ascii"))
+
+    try:
+        fixes = decode(data)
+    except DecodeError as e:
+        sys.exit("gpsb_decode: %s" % e)
+    json.dump(fixes, sys.stdout, indent=2)
+    print()
+
+
+if __name__ == "__main__":
+    main()
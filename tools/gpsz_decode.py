@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""Decoder for GPSZ compressed location payloads (docs/COMPRESSED_FORMAT.md).
+
+Library use:
+    from gpsz_decode import decode
+    text = decode(payload)  # the JSON batch, as bytes
+
+Command line (raw payload file, or hex with --hex):
+    mosquitto_sub -t gps/location/z -C 1 > msg.bin
+    python3 tools/gpsz_decode.py msg.bin
+    echo 03 0c ... | python3 tools/gpsz_decode.py --hex -
+"""
+
+import argparse
+import sys
+
+STORED = 0x01
+LZ = 0x02
+LZ_DICT1 = 0x03
+
+# Must match PAYLOAD_DICT1 in src/payload_codec.cpp byte for byte
+DICT1 = (
+    b'"satellites":10,"valid":true,"timestamp":1000000}'
+    b'{"latitude":0.000000,"longitude":0.000000,"altitude":0.00,'
+    b'"speed":0.00,"satellites":8,"valid":true,"timestamp":100000},'
+    b'[{"latitude":'
+)
+
+DICTIONARIES = {LZ: b"", LZ_DICT1: DICT1}
+
+
+class DecodeError(ValueError):
+    pass
+
+
+def decode(payload):
+    """Decode one GPSZ payload into the bytes that were compressed."""
+    data = bytes(payload)
+    if not data:
+        raise DecodeError("empty payload")
+    marker = data[0]
+    if marker == STORED:
+        return data[1:]
+    if marker not in DICTIONARIES:
+        raise DecodeError("unknown encoding 0x%02x" % marker)
+
+    # Matches may reach back into the dictionary, so decode after it
+    out = bytearray(DICTIONARIES[marker])
+    start = len(out)
+    pos = 1
+    while pos < len(data):
+        token = data[pos]
+        pos += 1
+        if token < 0x80:
+            run = token + 1
+            if pos + run > len(data):
+                raise DecodeError("truncated literals at offset %d" % pos)
+            out += data[pos:pos + run]
+            pos += run
+            continue
+
+        if pos >= len(data):
+            raise DecodeError("truncated match at offset %d" % pos)
+        offset = (((token & 0x07) << 8) | data[pos]) + 1
+        pos += 1
+        length = ((token >> 3) & 0x0F) + 3
+        if length == 18:
+            if pos >= len(data):
+                raise DecodeError("truncated match at offset %d" % pos)
+            length += data[pos]
+            pos += 1
+        if offset > len(out):
+            raise DecodeError("match before the start at offset %d" % pos)
+        for _ in range(length):  # May overlap the bytes it produces
+            out.append(out[-offset])
+    return bytes(out[start:])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="payload file, or - for stdin")
+    parser.add_argument("--hex", action="store_true",
+                        help="input is hex text instead of raw bytes")
+    args = parser.parse_args()
+
+    if args.input == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.input, "rb") as f:
+            data = f.read()
+    if args.hex:
+        data = bytes.fromhex(data.decode("ascii"))
+
+    try:
+        text = decode(data)
+    except DecodeError as e:
+        sys.exit("gpsz_decode: %s" % e)
+    sys.stdout.buffer.write(text)
+    print()
+
+
+if __name__ == "__main__":
+    main()